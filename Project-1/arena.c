@@ -0,0 +1,82 @@
+/******************************************************************************
+ * Implementação da arena de strings (ver arena.h).
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+
+int arenaInit(StringArena* arena, size_t maxBytes) {
+    arena->maxChunks = (maxBytes + ARENA_CHUNK_SIZE - 1) >> ARENA_CHUNK_SHIFT;
+    arena->chunkCount = 0;
+    arena->attachedChunks = 0;
+    arena->used = 0;
+    arena->live = 0;
+    arena->chunks = calloc(arena->maxChunks, sizeof(char*));
+    return arena->chunks != NULL ? 0 : -1;
+}
+
+uint64_t arenaAppend(StringArena* arena, const void* data, size_t length) {
+    if (length > ARENA_CHUNK_SIZE) {
+        return ARENA_INVALID;
+    }
+
+    // Não cabe no bloco atual: o resto dele fica sem uso
+    if (arena->chunkCount == 0 || arena->used + length > ARENA_CHUNK_SIZE) {
+        if (arena->chunkCount == arena->maxChunks) {
+            return ARENA_INVALID;
+        }
+        arena->chunks[arena->chunkCount] = malloc(ARENA_CHUNK_SIZE);
+        if (arena->chunks[arena->chunkCount] == NULL) {
+            return ARENA_INVALID;
+        }
+        arena->chunkCount++;
+        arena->used = 0;
+    }
+
+    uint64_t position = ((uint64_t)(arena->chunkCount - 1) << ARENA_CHUNK_SHIFT) | arena->used;
+    memcpy(arena->chunks[arena->chunkCount - 1] + arena->used, data, length);
+    arena->used += length;
+    arena->live += length;
+    return position;
+}
+
+int arenaAttach(StringArena* arena, char* image, size_t length, size_t live) {
+    size_t chunks = (length + ARENA_CHUNK_SIZE - 1) >> ARENA_CHUNK_SHIFT;
+    if (chunks > arena->maxChunks) {
+        return -1;
+    }
+    for (size_t i = 0; i < chunks; i++) {
+        arena->chunks[i] = image + (i << ARENA_CHUNK_SHIFT);
+    }
+    arena->chunkCount = chunks;
+    arena->attachedChunks = chunks;
+    // O último bloco da imagem pode terminar antes de ARENA_CHUNK_SIZE: o
+    // próximo acréscimo começa um bloco novo
+    arena->used = ARENA_CHUNK_SIZE;
+    arena->live = live;
+    return 0;
+}
+
+void arenaDiscard(StringArena* arena, size_t length) {
+    arena->live -= length;
+}
+
+size_t arenaAllocated(const StringArena* arena) {
+    return arena->chunkCount << ARENA_CHUNK_SHIFT;
+}
+
+void arenaFree(StringArena* arena) {
+    for (size_t i = arena->attachedChunks; i < arena->chunkCount; i++) {
+        free(arena->chunks[i]);
+    }
+    free(arena->chunks);
+    arena->chunks = NULL;
+    arena->chunkCount = 0;
+    arena->attachedChunks = 0;
+    arena->used = 0;
+    arena->live = 0;
+}
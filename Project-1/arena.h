@@ -0,0 +1,69 @@
+/******************************************************************************
+ * Arena de strings só de acréscimos.
+ * - Os bytes ficam em blocos de 2^ARENA_CHUNK_SHIFT bytes, alocados conforme
+ *   a arena cresce; cada acréscimo é contíguo e nunca cruza dois blocos.
+ * - Um acréscimo é identificado pela sua posição (64 bits: bloco e
+ *   deslocamento), que continua válida enquanto a arena existir: os blocos
+ *   nunca se movem e o diretório de blocos é alocado uma única vez.
+ * - Nada é liberado individualmente; quem substitui ou descarta uma string
+ *   só contabiliza os bytes perdidos (arenaDiscard). Por isso um leitor
+ *   pode continuar lendo uma posição antiga sem lock.
+ * - A arena pode começar com os blocos de uma imagem em memória externa
+ *   (arenaAttach), como um arquivo mapeado; os acréscimos seguintes vão
+ *   para blocos novos.
+ ******************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define ARENA_CHUNK_SHIFT 20            // Blocos de 1 MiB
+#define ARENA_CHUNK_SIZE ((size_t)1 << ARENA_CHUNK_SHIFT)
+#define ARENA_INVALID UINT64_MAX        // Posição devolvida em caso de erro
+
+
+typedef struct {
+    char** chunks;          // Diretório de blocos
+    size_t chunkCount;      // Blocos alocados
+    size_t attachedChunks;  // Primeiros blocos, da imagem (não são liberados)
+    size_t maxChunks;       // Tamanho do diretório
+    size_t used;            // Bytes ocupados no último bloco
+    size_t live;            // Bytes acrescentados e não descartados
+} StringArena;
+
+
+/* Inicializa a arena vazia para até maxBytes bytes (retorna -1 se faltar
+ * memória) */
+int arenaInit(StringArena* arena, size_t maxBytes);
+
+/* Copia length bytes (no máximo ARENA_CHUNK_SIZE) para o fim da arena e
+ * retorna sua posição (ARENA_INVALID se a arena estiver cheia ou faltar
+ * memória) */
+uint64_t arenaAppend(StringArena* arena, const void* data, size_t length);
+
+/* Endereço dos bytes na posição dada */
+static inline const char* arenaAt(const StringArena* arena, uint64_t position) {
+    return arena->chunks[position >> ARENA_CHUNK_SHIFT] + (position & (ARENA_CHUNK_SIZE - 1));
+}
+
+/* Usa como primeiros blocos da arena vazia os da imagem de length bytes:
+ * blocos consecutivos de ARENA_CHUNK_SIZE bytes (o último pode ser menor),
+ * com live bytes em uso. A imagem deve continuar mapeada enquanto a arena
+ * existir. (retorna -1 se não couber na arena) */
+int arenaAttach(StringArena* arena, char* image, size_t length, size_t live);
+
+/* Contabiliza length bytes que deixaram de ser usados */
+void arenaDiscard(StringArena* arena, size_t length);
+
+/* Bytes alocados pela arena (blocos inteiros) */
+size_t arenaAllocated(const StringArena* arena);
+
+/* Libera todos os blocos e o diretório */
+void arenaFree(StringArena* arena);
+
+
+#endif
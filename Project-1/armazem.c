@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Implementação do vetor segmentado (ver armazem.h).
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "armazem.h"
+
+
+/* Cabeçalho de uma página, nos STORE_PAGE_HEADER_SIZE bytes antes dos
+ * elementos (mantém o alinhamento) */
+typedef struct {
+    int refs;       // Vetor e snapshots que usam a página
+    int attached;   // Página de uma imagem externa: não é liberada
+} PageHeader;
+
+
+/* Funções auxiliares internas */
+static PageHeader* pageHeader(char* page) {
+    return (PageHeader*)(page - STORE_PAGE_HEADER_SIZE);
+}
+
+/* Aloca uma página com uma referência (retorna NULL se faltar memória) */
+static char* allocPage(const PagedStore* store) {
+    char* block = malloc(storePageStride(store));
+    if (block == NULL) {
+        return NULL;
+    }
+    ((PageHeader*)block)->refs = 1;
+    ((PageHeader*)block)->attached = 0;
+    return block + STORE_PAGE_HEADER_SIZE;
+}
+
+/* Solta uma referência, liberando a página se era a última */
+static void releasePage(char* page) {
+    if (__atomic_sub_fetch(&pageHeader(page)->refs, 1, __ATOMIC_ACQ_REL) == 0 &&
+        !pageHeader(page)->attached) {
+        free(pageHeader(page));
+    }
+}
+
+/* Garante que a página não é compartilhada com snapshots, copiando-a se
+ * for (retorna -1 se faltar memória) */
+static int ownPage(PagedStore* store, size_t page) {
+    char* shared = store->pages[page];
+
+    // Só snapshots criados antes somam referências, e eles não podem ser
+    // criados durante uma escrita; um snapshot liberado agora no máximo
+    // causa uma cópia desnecessária
+    if (__atomic_load_n(&pageHeader(shared)->refs, __ATOMIC_ACQUIRE) == 1) {
+        return 0;
+    }
+
+    char* copy = allocPage(store);
+    if (copy == NULL) {
+        return -1;
+    }
+    memcpy(copy, shared, store->elementSize << store->pageShift);
+    store->pages[page] = copy;
+    releasePage(shared);
+    return 0;
+}
+
+
+/* Funções públicas */
+int storeInit(PagedStore* store, size_t elementSize, unsigned pageShift, size_t maxElements) {
+    size_t pageElements = (size_t)1 << pageShift;
+
+    store->elementSize = elementSize;
+    store->pageShift = pageShift;
+    store->maxPages = (maxElements + pageElements - 1) / pageElements;
+    store->pageCount = 0;
+    store->count = 0;
+    store->pages = calloc(store->maxPages, sizeof(char*));
+    return store->pages != NULL ? 0 : -1;
+}
+
+void* storeAtForWrite(PagedStore* store, size_t index) {
+    if (ownPage(store, index >> store->pageShift) < 0) {
+        return NULL;
+    }
+    return storeAt(store, index);
+}
+
+void* storePush(PagedStore* store) {
+    size_t page = store->count >> store->pageShift;
+    if (page >= store->maxPages) {
+        return NULL;
+    }
+
+    // A próxima posição começa uma página nova
+    if (page == store->pageCount) {
+        store->pages[page] = allocPage(store);
+        if (store->pages[page] == NULL) {
+            return NULL;
+        }
+        store->pageCount++;
+    }
+
+    void* element = storeAtForWrite(store, store->count);
+    if (element != NULL) {
+        store->count++;
+    }
+    return element;
+}
+
+int storeSnapshot(PagedStore* out, const PagedStore* src) {
+    size_t usedPages = (src->count + ((size_t)1 << src->pageShift) - 1) >> src->pageShift;
+
+    *out = *src;
+    out->maxPages = usedPages;
+    out->pageCount = usedPages;
+    out->pages = malloc(sizeof(char*) * (usedPages > 0 ? usedPages : 1));
+    if (out->pages == NULL) {
+        out->pageCount = 0;
+        out->count = 0;
+        return -1;
+    }
+    for (size_t i = 0; i < usedPages; i++) {
+        out->pages[i] = src->pages[i];
+        __atomic_add_fetch(&pageHeader(out->pages[i])->refs, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+int storeAttach(PagedStore* store, char* image, size_t count) {
+    size_t pages = (count + ((size_t)1 << store->pageShift) - 1) >> store->pageShift;
+    if (pages > store->maxPages) {
+        return -1;
+    }
+    for (size_t i = 0; i < pages; i++) {
+        char* page = image + i * storePageStride(store) + STORE_PAGE_HEADER_SIZE;
+        pageHeader(page)->refs = 1;
+        pageHeader(page)->attached = 1;
+        store->pages[i] = page;
+    }
+    store->pageCount = pages;
+    store->count = count;
+    return 0;
+}
+
+void storePop(PagedStore* store) {
+    if (store->count > 0) {
+        store->count--;
+    }
+}
+
+void storeFree(PagedStore* store) {
+    for (size_t i = 0; i < store->pageCount; i++) {
+        releasePage(store->pages[i]);
+    }
+    free(store->pages);
+    store->pages = NULL;
+    store->pageCount = 0;
+    store->count = 0;
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Vetor segmentado que cresce sem mover seus elementos, com snapshots.
+ * - Os elementos ficam em páginas de tamanho fixo (2^pageShift elementos),
+ *   alocadas conforme o vetor cresce; a posição i está na página
+ *   i >> pageShift, deslocamento i & (tamanho da página - 1).
+ * - O diretório de páginas é alocado uma única vez, com o máximo de páginas,
+ *   então crescer nunca realoca nem copia: ponteiros para elementos
+ *   continuam válidos enquanto o elemento existir.
+ * - Remover o último elemento não devolve a página; ela é reaproveitada
+ *   pelas próximas inserções.
+ * - Snapshots (storeSnapshot) compartilham as páginas do vetor, com um
+ *   contador de referências por página: criar um custa uma referência por
+ *   página, sem copiar elementos. Quem altera o vetor pede a posição com
+ *   storeAtForWrite, que copia a página antes se algum snapshot ainda a
+ *   usa (cópia na escrita). A versão antiga da página é liberada quando o
+ *   último snapshot que a usa é liberado.
+ * - Um vetor pode começar com as páginas de uma imagem em memória externa
+ *   (storeAttach), como um arquivo mapeado: os elementos são usados onde
+ *   estão, sem cópia, e essas páginas nunca são liberadas pelo vetor.
+ ******************************************************************************/
+
+#ifndef ARMAZEM_H
+#define ARMAZEM_H
+
+
+#include <stddef.h>
+
+
+#define STORE_PAGE_HEADER_SIZE 64       // Bytes antes dos elementos de cada página
+
+
+typedef struct {
+    char** pages;           // Diretório de páginas (NULL: não alocada)
+    size_t pageCount;       // Páginas alocadas
+    size_t maxPages;        // Tamanho do diretório
+    size_t elementSize;     // Bytes por elemento
+    unsigned pageShift;     // log2 dos elementos por página
+    size_t count;           // Elementos no vetor
+} PagedStore;
+
+
+/* Inicializa o vetor vazio para até maxElements elementos de elementSize
+ * bytes, em páginas de 2^pageShift elementos (retorna -1 se faltar
+ * memória) */
+int storeInit(PagedStore* store, size_t elementSize, unsigned pageShift, size_t maxElements);
+
+/* Endereço do elemento na posição index (index < count), só para leitura
+ * se o vetor tiver snapshots */
+static inline void* storeAt(const PagedStore* store, size_t index) {
+    size_t mask = ((size_t)1 << store->pageShift) - 1;
+    return store->pages[index >> store->pageShift] + (index & mask) * store->elementSize;
+}
+
+/* Endereço do elemento na posição index para alteração, copiando antes a
+ * página se um snapshot a usa (retorna NULL se faltar memória) */
+void* storeAtForWrite(PagedStore* store, size_t index);
+
+/* Acrescenta um elemento ao fim e retorna seu endereço, para ser preenchido
+ * (retorna NULL se o vetor estiver cheio ou faltar memória) */
+void* storePush(PagedStore* store);
+
+/* Cria em out um snapshot só de leitura dos count primeiros elementos,
+ * compartilhando as páginas (retorna -1 se faltar memória). Deve ser
+ * liberado com storeFree; pode ser lido e liberado sem o lock do vetor. */
+int storeSnapshot(PagedStore* out, const PagedStore* src);
+
+/* Bytes de uma página em uma imagem: cabeçalho e elementos */
+static inline size_t storePageStride(const PagedStore* store) {
+    return STORE_PAGE_HEADER_SIZE + (store->elementSize << store->pageShift);
+}
+
+/* Usa como páginas do vetor vazio as da imagem, que guarda count elementos
+ * em páginas consecutivas de storePageStride bytes (a última completa),
+ * cada uma começando por STORE_PAGE_HEADER_SIZE bytes reservados. A imagem
+ * deve continuar mapeada e gravável enquanto o vetor existir. (retorna -1
+ * se count não couber no vetor) */
+int storeAttach(PagedStore* store, char* image, size_t count);
+
+/* Remove o último elemento */
+void storePop(PagedStore* store);
+
+/* Libera o vetor ou snapshot: cada página é liberada quando ninguém mais a
+ * usa */
+void storeFree(PagedStore* store);
+
+
+#endif
@@ -0,0 +1,323 @@
+/******************************************************************************
+ * Benchmark de transporte do servidor de filmes.
+ * - Abre várias conexões, envia uma requisição em cada uma, espera todas as
+ *   respostas e repete (laço fechado), medindo vazão e latência.
+ * - Usado para comparar os modos do servidor (threads, epoll e uring) com a
+ *   mesma carga; veja benchmark_transportes.sh.
+ * - Cada requisição é um frame do protocolo binário (protocolo.h) com a
+ *   opção dada por -o (padrão 4) e os campos dados por -f, em ordem.
+ * - Com -p N, cada rodada envia N requisições seguidas por conexão
+ *   (pipelining, IDs 0 a N-1) e espera as N respostas, em qualquer ordem.
+ * - Compilação:
+ *      gcc -O2 -o benchmark benchmark.c conexao.c protocolo.c -lpthread
+ * - Execução:
+ *      ./benchmark <IP_do_servidor> <porta> [-c conexões] [-t threads]
+ *                  [-d segundos] [-p profundidade] [-o opção] [-f campo]...
+ * - Exemplo de uso:
+ *      ./benchmark 127.0.0.1 8000 -c 256 -t 4 -d 10
+ *      ./benchmark 127.0.0.1 8000 -o 6 -f 1 -p 32
+ ******************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "conexao.h"
+#include "protocolo.h"
+
+
+#define BUFFER_SIZE 65536           // Tamanho do buffer de recepção
+#define MAX_SAMPLES 4000000         // Latências guardadas por thread
+#define MAX_DEPTH 256               // Maior profundidade de pipelining
+
+
+/* Parâmetros do benchmark */
+typedef struct {
+    const char* serverIp;
+    int port;
+    int connections;    // Total de conexões
+    int threads;        // Threads geradoras de carga
+    int seconds;        // Duração da medição
+    int depth;          // Requisições em voo por conexão
+    int option;         // Opção enviada a cada requisição
+    const char* fields[FRAME_MAX_FIELDS];
+    int fieldCount;
+    char request[BUFFER_SIZE];  // Frames de uma rodada (depth requisições), montados uma vez
+    size_t requestLength;
+} BenchConfig;
+
+/* Estado e resultados de cada thread */
+typedef struct {
+    pthread_t thread;
+    int firstConnection;    // Índice da primeira conexão da thread
+    int connectionCount;    // Conexões atendidas pela thread
+    long requests;          // Requisições concluídas
+    long errors;            // Conexões perdidas
+    double* latencies;      // Latências em microssegundos
+    long sampleCount;
+} BenchThread;
+
+
+BenchConfig config;
+int* sockets;               // Sockets de todas as conexões
+volatile int running = 1;   // Zerado ao fim da medição
+
+
+/* Tempo monotônico em microssegundos */
+double nowMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Recebe uma resposta inteira, descartando o texto (retorna o ID da
+ * requisição ou -1 se a conexão cair) */
+long readResponse(int sock, char* buffer) {
+    FrameHeader header;
+
+    // Uma listagem longa chega em vários frames; só o último conta
+    do {
+        char headerBytes[FRAME_HEADER_SIZE];
+        size_t received = 0;
+        while (received < FRAME_HEADER_SIZE) {
+            ssize_t bytesRead = recv(sock, headerBytes + received, FRAME_HEADER_SIZE - received, 0);
+            if (bytesRead <= 0) {
+                return -1;
+            }
+            received += bytesRead;
+        }
+
+        decodeFrameHeader(headerBytes, &header);
+        size_t remaining = header.length;
+        while (remaining > 0) {
+            ssize_t bytesRead = recv(sock, buffer, remaining < BUFFER_SIZE ? remaining : BUFFER_SIZE, 0);
+            if (bytesRead <= 0) {
+                return -1;
+            }
+            remaining -= bytesRead;
+        }
+    } while (header.flags & FRAME_FLAG_MORE);
+    return header.requestId;
+}
+
+/* Fecha uma conexão que falhou */
+void dropConnection(BenchThread* bench, int* socks, struct pollfd* fds, int i) {
+    close(socks[i]);
+    socks[i] = -1;
+    fds[i].fd = -1;
+    bench->errors++;
+}
+
+/* Laço de uma thread: envia depth requisições por conexão e espera todas as
+ * respostas antes da próxima rodada */
+void* benchLoop(void* arg) {
+    BenchThread* bench = arg;
+    int count = bench->connectionCount;
+    int* socks = sockets + bench->firstConnection;
+    struct pollfd* fds = calloc(count, sizeof(struct pollfd));
+    double* sentAt = calloc(count, sizeof(double));
+    int* pending = calloc(count, sizeof(int));
+    char* buffer = malloc(BUFFER_SIZE);
+
+    while (running) {
+        // Envia as requisições da rodada em cada conexão ativa
+        int waiting = 0;
+        for (int i = 0; i < count; i++) {
+            fds[i].fd = socks[i];
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+            if (socks[i] < 0) {
+                continue;
+            }
+            sentAt[i] = nowMicros();
+            if (send(socks[i], config.request, config.requestLength, MSG_NOSIGNAL) < 0) {
+                dropConnection(bench, socks, fds, i);
+                continue;
+            }
+            pending[i] = config.depth;
+            waiting++;
+        }
+        if (waiting == 0) {
+            break;
+        }
+
+        // Espera todas as respostas de cada uma, em qualquer ordem
+        while (waiting > 0) {
+            if (poll(fds, count, 1000) <= 0) {
+                continue;
+            }
+            for (int i = 0; i < count; i++) {
+                if (fds[i].fd < 0 || fds[i].revents == 0) {
+                    continue;
+                }
+                long requestId = readResponse(fds[i].fd, buffer);
+                if (requestId < 0 || requestId >= config.depth) {
+                    dropConnection(bench, socks, fds, i);
+                    waiting--;
+                    continue;
+                }
+                bench->requests++;
+                if (bench->sampleCount < MAX_SAMPLES) {
+                    bench->latencies[bench->sampleCount++] = nowMicros() - sentAt[i];
+                }
+                if (--pending[i] == 0) {
+                    fds[i].fd = -1;
+                    waiting--;
+                }
+            }
+        }
+    }
+
+    free(buffer);
+    free(pending);
+    free(sentAt);
+    free(fds);
+    return NULL;
+}
+
+/* Comparação para qsort */
+int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentil (0 a 100) de um vetor ordenado */
+double percentile(const double* sorted, long count, double p) {
+    if (count == 0) {
+        return 0;
+    }
+    long index = (long)(p / 100.0 * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+
+/* Função principal do benchmark */
+void printUsage(const char* program) {
+    printf("Uso: %s <IP_do_servidor> <porta> [-c conexões] [-t threads] [-d segundos]"
+           " [-p profundidade] [-o opção] [-f campo]...\n", program);
+}
+
+int main(int argc, char* argv[]) {
+    config.connections = 64;
+    config.threads = 4;
+    config.seconds = 10;
+    config.depth = 1;
+    config.option = 4;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:d:p:o:f:")) != -1) {
+        switch (opt) {
+            case 'c': config.connections = atoi(optarg); break;
+            case 't': config.threads = atoi(optarg); break;
+            case 'd': config.seconds = atoi(optarg); break;
+            case 'p': config.depth = atoi(optarg); break;
+            case 'o': config.option = atoi(optarg); break;
+            case 'f':
+                if (config.fieldCount < FRAME_MAX_FIELDS) {
+                    config.fields[config.fieldCount++] = optarg;
+                }
+                break;
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (argc - optind < 2 || config.option <= 0 || config.option > 255 ||
+        config.depth < 1 || config.depth > MAX_DEPTH) {
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Uma rodada: depth frames seguidos, com IDs 0 a depth-1
+    for (int i = 0; i < config.depth; i++) {
+        size_t length = encodeRequest(config.request + config.requestLength,
+                                      sizeof(config.request) - config.requestLength,
+                                      config.option, i, config.fields, config.fieldCount);
+        if (length == 0) {
+            fprintf(stderr, "Requisições grandes demais para a profundidade pedida.\n");
+            exit(EXIT_FAILURE);
+        }
+        config.requestLength += length;
+    }
+    config.serverIp = argv[optind];
+    config.port = atoi(argv[optind + 1]);
+    if (config.threads > config.connections) {
+        config.threads = config.connections;
+    }
+
+    // Abre todas as conexões antes de começar a medir
+    sockets = malloc(sizeof(int) * config.connections);
+    for (int i = 0; i < config.connections; i++) {
+        sockets[i] = connectToServer(config.serverIp, config.port);
+        if (sockets[i] < 0) {
+            perror("Erro na conexão");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Divide as conexões entre as threads
+    BenchThread* threads = calloc(config.threads, sizeof(BenchThread));
+    int next = 0;
+    for (int i = 0; i < config.threads; i++) {
+        threads[i].firstConnection = next;
+        threads[i].connectionCount = config.connections / config.threads +
+                                     (i < config.connections % config.threads);
+        threads[i].latencies = malloc(sizeof(double) * MAX_SAMPLES);
+        next += threads[i].connectionCount;
+    }
+
+    double start = nowMicros();
+    for (int i = 0; i < config.threads; i++) {
+        pthread_create(&threads[i].thread, NULL, benchLoop, &threads[i]);
+    }
+    sleep(config.seconds);
+    running = 0;
+    for (int i = 0; i < config.threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    double elapsed = (nowMicros() - start) / 1e6;
+
+    // Junta os resultados de todas as threads
+    long requests = 0, errors = 0, samples = 0;
+    for (int i = 0; i < config.threads; i++) {
+        requests += threads[i].requests;
+        errors += threads[i].errors;
+        samples += threads[i].sampleCount;
+    }
+    double* all = malloc(sizeof(double) * (samples > 0 ? samples : 1));
+    long offset = 0;
+    for (int i = 0; i < config.threads; i++) {
+        memcpy(all + offset, threads[i].latencies, sizeof(double) * threads[i].sampleCount);
+        offset += threads[i].sampleCount;
+        free(threads[i].latencies);
+    }
+    qsort(all, samples, sizeof(double), compareDoubles);
+
+    printf("conexões=%d threads=%d profundidade=%d opção=%d duração=%.1fs\n",
+           config.connections, config.threads, config.depth, config.option, elapsed);
+    printf("requisições=%ld erros=%ld vazão=%.0f req/s\n", requests, errors, requests / elapsed);
+    printf("latência (us): p50=%.1f p99=%.1f p999=%.1f máx=%.1f\n",
+           percentile(all, samples, 50), percentile(all, samples, 99),
+           percentile(all, samples, 99.9), samples > 0 ? all[samples - 1] : 0);
+
+    // Encerra as conexões com a opção 0
+    char closeFrame[FRAME_HEADER_SIZE];
+    encodeFrameHeader(closeFrame, 0, 0, 0, 0);
+    for (int i = 0; i < config.connections; i++) {
+        if (sockets[i] >= 0) {
+            send(sockets[i], closeFrame, sizeof(closeFrame), MSG_NOSIGNAL);
+            close(sockets[i]);
+        }
+    }
+    free(all);
+    free(threads);
+    free(sockets);
+    return 0;
+}
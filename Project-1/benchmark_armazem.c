@@ -0,0 +1,155 @@
+/******************************************************************************
+ * Benchmark do armazenamento de filmes em memória.
+ * - Para cada tamanho de catálogo, insere N filmes no vetor segmentado
+ *   (armazem.c), na arena de strings (arena.c) e no índice de IDs
+ *   (indice.c), como o servidor faz no cadastro, e depois busca N IDs
+ *   aleatórios, lendo o título do filme encontrado. Por fim percorre o
+ *   catálogo inteiro, como a listagem de títulos.
+ * - Mostra a vazão de cada etapa e a memória das páginas e da arena.
+ * - O registro tem o mesmo formato do MovieRecord do servidor.
+ * - Compilação:
+ *      gcc -O2 -o benchmark_armazem benchmark_armazem.c arena.c armazem.c indice.c
+ * - Execução:
+ *      ./benchmark_armazem [quantidade de filmes]...
+ * - Exemplo de uso:
+ *      ./benchmark_armazem
+ *      ./benchmark_armazem 1000 1000000 10000000
+ ******************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "arena.h"
+#include "armazem.h"
+#include "indice.h"
+
+
+#define PAGE_SHIFT 10               // Mesmo tamanho de página do servidor
+#define MAX_RECORDS (1 << 27)       // Mesmo diretório de páginas do servidor
+#define MAX_STRING_BYTES ((size_t)1 << 36)  // Mesma arena do servidor
+
+
+/* Mesmo formato do MovieRecord do servidor */
+typedef struct {
+    int id;
+    int year;
+    uint64_t genreMask;
+    uint64_t strings;
+    uint8_t titleLength;
+    uint8_t directorLength;
+    uint8_t genresLength;
+} MovieRecord;
+
+
+/* Segundos desde uma origem fixa */
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Gerador pseudoaleatório xorshift64 */
+uint64_t nextRandom(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Mede inserções, buscas e percurso em um catálogo de count filmes
+ * (retorna -1 se faltar memória) */
+int runBenchmark(size_t count) {
+    PagedStore store;
+    StringArena arena;
+    IdIndex index;
+    if (storeInit(&store, sizeof(MovieRecord), PAGE_SHIFT, MAX_RECORDS) < 0 ||
+        arenaInit(&arena, MAX_STRING_BYTES) < 0 ||
+        indexInit(&index, 1024) < 0) {
+        return -1;
+    }
+
+    // Inserções: IDs sequenciais, como os gerados pelo servidor
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        // "título\0diretor\0gêneros\0", como o servidor guarda na arena
+        const char rest[] = "Diretor\0ação;drama";
+        char strings[64];
+        int titleLength = snprintf(strings, sizeof(strings), "Filme %zu", i + 1);
+        memcpy(strings + titleLength + 1, rest, sizeof(rest));
+
+        MovieRecord* record = storePush(&store);
+        uint64_t position = arenaAppend(&arena, strings, titleLength + 1 + sizeof(rest));
+        if (record == NULL || position == ARENA_INVALID ||
+            indexPut(&index, (int)i + 1, (int)i) < 0) {
+            storeFree(&store);
+            arenaFree(&arena);
+            indexFree(&index);
+            return -1;
+        }
+        record->id = (int)i + 1;
+        record->year = 1900 + (int)(i % 125);
+        record->genreMask = 3;
+        record->strings = position;
+        record->titleLength = (uint8_t)titleLength;
+        record->directorLength = 7;
+        record->genresLength = (uint8_t)strlen(rest + 8);
+    }
+    double insertSeconds = now() - start;
+
+    // Buscas: IDs aleatórios, lendo o título de cada filme encontrado
+    uint64_t state = 88172645463325252ull;
+    long checksum = 0;
+    start = now();
+    for (size_t i = 0; i < count; i++) {
+        int id = (int)(nextRandom(&state) % count) + 1;
+        const MovieRecord* record = storeAt(&store, (size_t)indexFind(&index, id));
+        checksum += record->year + arenaAt(&arena, record->strings)[record->titleLength - 1];
+    }
+    double lookupSeconds = now() - start;
+
+    // Percurso: ID e título de todos os filmes, em ordem
+    start = now();
+    for (size_t i = 0; i < count; i++) {
+        const MovieRecord* record = storeAt(&store, i);
+        checksum += record->id + arenaAt(&arena, record->strings)[0];
+    }
+    double scanSeconds = now() - start;
+
+    printf("filmes=%zu insercoes/s=%.0f buscas/s=%.0f percurso/s=%.0f "
+           "registros_MiB=%.1f strings_MiB=%.1f (soma %ld)\n",
+           count,
+           count / insertSeconds,
+           count / lookupSeconds,
+           count / scanSeconds,
+           store.pageCount * (sizeof(MovieRecord) << PAGE_SHIFT) / (1024.0 * 1024.0),
+           arenaAllocated(&arena) / (1024.0 * 1024.0),
+           checksum);
+
+    storeFree(&store);
+    arenaFree(&arena);
+    indexFree(&index);
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    size_t defaults[] = { 1000, 1000000, 10000000 };
+
+    int runs = argc > 1 ? argc - 1 : 3;
+    for (int i = 0; i < runs; i++) {
+        size_t count = argc > 1 ? strtoull(argv[i + 1], NULL, 10) : defaults[i];
+        if (count == 0 || count > MAX_RECORDS) {
+            printf("Quantidade inválida: %zu\n", count);
+            continue;
+        }
+        if (runBenchmark(count) < 0) {
+            printf("Memória insuficiente para %zu filmes.\n", count);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,287 @@
+/******************************************************************************
+ * Microbenchmark das funções de armazenamento e consulta do servidor.
+ * - Inclui servidor.c sem o main dele (SERVIDOR_SEM_MAIN): mede as
+ *   próprias funções do servidor, com os mesmos tipos e globais, e não
+ *   cópias que podem divergir.
+ * - Para cada tamanho de catálogo, gera um CSV sintético (títulos, alguns
+ *   com vírgula e portanto entre aspas, até mil diretores e de 1 a 3 de 8
+ *   gêneros por filme) e mede:
+ *      loadMoviesFromCSV   - importação do CSV, com uma thread por CPU;
+ *      saveMoviesToCSV     - exportação do catálogo (inclui o fsync);
+ *      findMovieIndexById  - buscas de IDs sorteados entre os cadastrados;
+ *      generateNewId       - próximo ID a gerar;
+ *      listMovieById       - texto da opção 6 de um ID sorteado;
+ *      listAllMoviesIds    - opção 4 inteira, frame a frame (por filme);
+ *      listAllMoviesInfo   - opção 5 inteira, frame a frame (por filme);
+ *      listMoviesByGenre   - opção 7 de "drama" inteira (por filme listado).
+ *   As listagens são geradas como no servidor, mas sem enviar e sem
+ *   guardar no cache, para cada repetição gerar o texto de novo.
+ * - Cada medida é repetida até somar MIN_SECONDS segundos.
+ * - Saída em CSV, uma linha por medida, para comparar execuções:
+ *      benchmark,filmes,operacoes,segundos,ns_por_operacao
+ *   As mensagens do próprio servidor (ex.: "Carregados N filmes") vão para
+ *   stderr.
+ * - Compilação:
+ *      gcc -O2 -o benchmark_servidor benchmark_servidor.c arena.c armazem.c bitmap.c cache.c csv.c estatisticas.c generos.c histograma.c imagem.c indice.c pool.c protocolo.c wal.c -lpthread
+ * - Execução:
+ *      ./benchmark_servidor [-d diretório_dos_CSVs] [quantidade de filmes]...
+ * - Exemplo de uso:
+ *      ./benchmark_servidor
+ *      ./benchmark_servidor -d /tmp 1000 1000000 10000000 > resultados.csv
+ ******************************************************************************/
+
+
+#define SERVIDOR_SEM_MAIN
+#include "servidor.c"
+
+
+#define MIN_SECONDS 0.5             // Tempo mínimo de cada medida
+#define LOOKUPS (1 << 20)           // Buscas por repetição de findMovieIndexById
+#define NEW_IDS (1 << 24)           // Chamadas por repetição de generateNewId
+#define LOOKUP_TEXTS (1 << 16)      // Textos por repetição de listMovieById
+#define BENCHMARK_GENRE "drama"     // Gênero listado na opção 7
+
+
+/* Gêneros sorteados para os filmes sintéticos */
+const char* syntheticGenres[] = { "drama", "ação", "comédia", "terror", "romance", "ficção",
+                                  "documentário", "animação" };
+
+FILE* results;                  // Resultados (stdout original)
+char csvPath[PATH_MAX];         // CSV sintético importado
+char savePath[PATH_MAX];        // CSV exportado por saveMoviesToCSV
+size_t catalogSize;             // Filmes do catálogo medido
+int cpuCount;
+volatile long sink;             // Resultados consumidos, para não serem descartados
+
+
+/* Gerador pseudoaleatório xorshift64 */
+uint64_t benchmarkRandom(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Escreve o CSV sintético de count filmes em csvPath (retorna -1 em caso
+ * de erro) */
+int writeSyntheticCsv(size_t count) {
+    FILE* file = fopen(csvPath, "w");
+    if (file == NULL) {
+        perror("Erro ao criar o CSV sintético");
+        return -1;
+    }
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    fprintf(file, CSV_NEXT_ID_PREFIX "%zu\n", count + 1);
+    for (size_t i = 1; i <= count; i++) {
+        // Um título em 16 tem vírgula e vai entre aspas
+        if (i % 16 == 0) {
+            fprintf(file, "%zu,\"Filme %zu, parte 2\",", i, i);
+        } else {
+            fprintf(file, "%zu,Filme %zu,", i, i);
+        }
+        fprintf(file, "Diretor %zu,%zu,", i % 1000, 1950 + i % 70);
+        int genres = 1 + (int)(benchmarkRandom(&state) % 3);
+        int first = (int)(benchmarkRandom(&state) % 8);
+        for (int g = 0; g < genres; g++) {
+            fprintf(file, g > 0 ? ";%s" : "%s", syntheticGenres[(first + g * 3) % 8]);
+        }
+        putc('\n', file);
+    }
+    if (fclose(file) != 0) {
+        perror("Erro ao gravar o CSV sintético");
+        return -1;
+    }
+    return 0;
+}
+
+/* Cria as estruturas do catálogo vazias */
+void initCatalog() {
+    if (storeInit(&movieList, sizeof(MovieRecord), MOVIE_PAGE_SHIFT, MAX_MOVIES) < 0 ||
+        arenaInit(&movieStrings, MAX_STRING_BYTES) < 0 ||
+        indexInit(&movieIndex, INITIAL_INDEX_SIZE) < 0 || genreIndexInit(&genreIndex) < 0) {
+        perror("Erro ao criar o catálogo");
+        exit(EXIT_FAILURE);
+    }
+    bitmapInit(&movieIds);
+    movieCount = 0;
+    nextMovieId = 1;
+}
+
+/* Descarta o catálogo carregado */
+void freeCatalog() {
+    storeFree(&movieList);
+    arenaFree(&movieStrings);
+    indexFree(&movieIndex);
+    genreIndexFree(&genreIndex);
+    bitmapFree(&movieIds);
+}
+
+/* Gera a listagem inteira de uma opção (4, 5 ou 7), frame a frame, como o
+ * servidor (retorna os filmes listados) */
+size_t generateListing(int option) {
+    Request request;
+    memset(&request, 0, sizeof(request));
+    request.option = option;
+    if (option == 7) {
+        strcpy(request.fields[0], BENCHMARK_GENRE);
+    }
+
+    char response[RESPONSE_SIZE];
+    ResponseStream* stream = openResponseStream(&request, response);
+    if (stream == NULL) {
+        return 0;
+    }
+    stream->cacheKey[0] = '\0';
+    size_t bytes = 0;
+    size_t length;
+    while ((length = nextStreamFrame(stream)) > 0) {
+        bytes += length;
+    }
+    size_t listed = option == 7 ? bitmapCardinality(&stream->matches) : stream->snapshot.count;
+    sink += (long)bytes;
+    closeResponseStream(stream);
+    return listed;
+}
+
+
+/* Descarta o catálogo antes de importá-lo de novo (fora da medida) */
+void resetCatalog() {
+    freeCatalog();
+    initCatalog();
+}
+
+
+/* Medidas: cada uma executa uma repetição e retorna as operações feitas */
+size_t runLoad() {
+    loadMoviesFromCSV(csvPath, cpuCount);
+    return 1;
+}
+
+size_t runSave() {
+    sink += saveMoviesToCSV(savePath, &movieList, nextMovieId);
+    return 1;
+}
+
+size_t runFind() {
+    uint64_t state = 88172645463325252ull;
+    long found = 0;
+    for (int i = 0; i < LOOKUPS; i++) {
+        found += findMovieIndexById((int)(benchmarkRandom(&state) % catalogSize) + 1);
+    }
+    sink += found;
+    return LOOKUPS;
+}
+
+size_t runNewId() {
+    for (int i = 0; i < NEW_IDS; i++) {
+        sink += generateNewId();
+    }
+    return NEW_IDS;
+}
+
+size_t runLookupText() {
+    uint64_t state = 88172645463325252ull;
+    char response[RESPONSE_SIZE];
+    for (int i = 0; i < LOOKUP_TEXTS; i++) {
+        sink += listMovieById((int)(benchmarkRandom(&state) % catalogSize) + 1, response);
+    }
+    return LOOKUP_TEXTS;
+}
+
+size_t runListIds() {
+    return generateListing(4);
+}
+
+size_t runListInfo() {
+    return generateListing(5);
+}
+
+size_t runListGenre() {
+    return generateListing(7);
+}
+
+/* Repete run até somar MIN_SECONDS (ao menos uma vez) e escreve a linha do
+ * resultado. prepare (se não NULL) executa antes de cada repetição, fora
+ * do tempo medido. */
+void measure(const char* name, size_t (*run)(), void (*prepare)()) {
+    double elapsed = 0;
+    size_t operations = 0;
+    while (elapsed < MIN_SECONDS) {
+        if (prepare != NULL) {
+            prepare();
+        }
+        uint64_t start = statsNow();
+        operations += run();
+        elapsed += (statsNow() - start) / 1e9;
+    }
+    fprintf(results, "%s,%zu,%zu,%.6f,%.1f\n", name, catalogSize, operations, elapsed,
+            operations > 0 ? elapsed * 1e9 / operations : 0);
+    fflush(results);
+}
+
+/* Mede todas as funções em um catálogo de count filmes */
+void runBenchmarks(size_t count) {
+    catalogSize = count;
+    if (writeSyntheticCsv(count) < 0) {
+        exit(EXIT_FAILURE);
+    }
+    measure("loadMoviesFromCSV", runLoad, resetCatalog);
+    unlink(csvPath);
+    if ((size_t)movieCount != count) {
+        fprintf(stderr, "Esperados %zu filmes, carregados %d.\n", count, movieCount);
+        exit(EXIT_FAILURE);
+    }
+
+    measure("saveMoviesToCSV", runSave, NULL);
+    unlink(savePath);
+    measure("findMovieIndexById", runFind, NULL);
+    measure("generateNewId", runNewId, NULL);
+    measure("listMovieById", runLookupText, NULL);
+    measure("listAllMoviesIds", runListIds, NULL);
+    measure("listAllMoviesInfo", runListInfo, NULL);
+    measure("listMoviesByGenre", runListGenre, NULL);
+}
+
+
+int main(int argc, char* argv[]) {
+    const char* directory = "/tmp";
+    int opt;
+    while ((opt = getopt(argc, argv, "d:")) != -1) {
+        if (opt != 'd') {
+            fprintf(stderr, "Uso: %s [-d diretório_dos_CSVs] [quantidade de filmes]...\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        directory = optarg;
+    }
+    snprintf(csvPath, sizeof(csvPath), "%s/benchmark_servidor_%d.csv", directory, (int)getpid());
+    snprintf(savePath, sizeof(savePath), "%s/benchmark_servidor_%d_salvo.csv", directory, (int)getpid());
+
+    // Só os resultados ficam no stdout
+    results = fdopen(dup(STDOUT_FILENO), "w");
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_rwlock_init(&movieLock, NULL);
+    statsInit(&serverStats);
+    initCatalog();
+
+    fprintf(results, "benchmark,filmes,operacoes,segundos,ns_por_operacao\n");
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            size_t count = strtoul(argv[i], NULL, 10);
+            if (count > 0) {
+                runBenchmarks(count);
+            }
+        }
+    } else {
+        size_t sizes[] = { 1000, 10000, 100000, 1000000 };
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            runBenchmarks(sizes[i]);
+        }
+    }
+
+    freeCatalog();
+    fclose(results);
+    return 0;
+}
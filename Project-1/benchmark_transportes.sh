@@ -0,0 +1,35 @@
+#!/bin/sh
+###############################################################################
+# Compara os modos de atendimento do servidor (threads, epoll e uring) com a
+# mesma carga do benchmark.
+# - Execução (a partir de Project-1):
+#      ./benchmark_transportes.sh [porta] [conexões] [segundos]
+# - Exemplo de uso:
+#      ./benchmark_transportes.sh 8000 512 10
+###############################################################################
+
+PORT=${1:-8000}
+CONNECTIONS=${2:-256}
+SECONDS_PER_RUN=${3:-10}
+THREADS=$(nproc)
+
+gcc -O2 -o servidor servidor.c arena.c armazem.c bitmap.c cache.c csv.c estatisticas.c generos.c histograma.c imagem.c indice.c pool.c protocolo.c wal.c -lpthread || exit 1
+gcc -O2 -o benchmark benchmark.c conexao.c protocolo.c -lpthread || exit 1
+
+# Cada servidor roda em um diretório temporário para não tocar no catálogo (imagem e log)
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+for MODE in threads epoll uring; do
+    # Porta nova a cada modo: a anterior pode ainda estar em TIME_WAIT
+    (cd "$WORKDIR" && exec "$OLDPWD/servidor" "$PORT" -m "$MODE" > servidor.log) &
+    SERVER_PID=$!
+    sleep 1
+
+    echo "=== modo $MODE ==="
+    ./benchmark 127.0.0.1 "$PORT" -c "$CONNECTIONS" -t "$THREADS" -d "$SECONDS_PER_RUN"
+
+    kill "$SERVER_PID"
+    wait "$SERVER_PID" 2>/dev/null
+    PORT=$((PORT + 1))
+done
@@ -0,0 +1,615 @@
+/******************************************************************************
+ * Implementação do conjunto compactado no estilo Roaring (ver bitmap.h).
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitmap.h"
+
+
+/* Funções auxiliares dos contêineres */
+static void containerFree(BitmapContainer* container) {
+    free(container->values);
+    free(container->words);
+    container->values = NULL;
+    container->words = NULL;
+}
+
+static int isDense(const BitmapContainer* container) {
+    return container->words != NULL;
+}
+
+static int testBit(const uint64_t* words, uint16_t low) {
+    return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+static int countBits(const uint64_t* words) {
+    int count = 0;
+    for (int i = 0; i < BITMAP_WORDS; i++) {
+        count += __builtin_popcountll(words[i]);
+    }
+    return count;
+}
+
+/* Posição de low no vetor do contêiner esparso, ou onde entraria
+ * (codificada como -(posição) - 1) */
+static int searchValues(const BitmapContainer* container, uint16_t low) {
+    int first = 0, last = container->cardinality - 1;
+    while (first <= last) {
+        int middle = (first + last) / 2;
+        if (container->values[middle] < low) {
+            first = middle + 1;
+        } else if (container->values[middle] > low) {
+            last = middle - 1;
+        } else {
+            return middle;
+        }
+    }
+    return -first - 1;
+}
+
+/* Converte um contêiner esparso em denso */
+static int makeDense(BitmapContainer* container) {
+    uint64_t* words = calloc(BITMAP_WORDS, sizeof(uint64_t));
+    if (words == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < container->cardinality; i++) {
+        uint16_t low = container->values[i];
+        words[low >> 6] |= 1ull << (low & 63);
+    }
+    free(container->values);
+    container->values = NULL;
+    container->capacity = 0;
+    container->words = words;
+    return 0;
+}
+
+/* Converte um contêiner denso em esparso */
+static int makeSparse(BitmapContainer* container) {
+    int capacity = container->cardinality > 0 ? container->cardinality : 1;
+    uint16_t* values = malloc(sizeof(uint16_t) * capacity);
+    if (values == NULL) {
+        return -1;
+    }
+    int count = 0;
+    for (int i = 0; i < BITMAP_WORDS; i++) {
+        uint64_t word = container->words[i];
+        while (word != 0) {
+            values[count++] = (uint16_t)(i * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+    free(container->words);
+    container->words = NULL;
+    container->values = values;
+    container->capacity = capacity;
+    return 0;
+}
+
+/* Ajusta a representação de um contêiner recém-calculado ao seu tamanho */
+static int normalize(BitmapContainer* container) {
+    if (isDense(container) && container->cardinality <= BITMAP_ARRAY_MAX) {
+        return makeSparse(container);
+    }
+    if (!isDense(container) && container->cardinality > BITMAP_ARRAY_MAX) {
+        return makeDense(container);
+    }
+    return 0;
+}
+
+/* Adiciona low ao contêiner (retorna 1 se entrou, 0 se já estava, -1 se
+ * faltar memória) */
+static int containerAdd(BitmapContainer* container, uint16_t low) {
+    if (isDense(container)) {
+        uint64_t bit = 1ull << (low & 63);
+        if (container->words[low >> 6] & bit) {
+            return 0;
+        }
+        container->words[low >> 6] |= bit;
+        container->cardinality++;
+        return 1;
+    }
+
+    int position = searchValues(container, low);
+    if (position >= 0) {
+        return 0;
+    }
+    position = -position - 1;
+
+    if (container->cardinality == BITMAP_ARRAY_MAX) {
+        // Vetor cheio: passa a mapa de bits
+        if (makeDense(container) < 0) {
+            return -1;
+        }
+        return containerAdd(container, low);
+    }
+    if (container->cardinality == container->capacity) {
+        int capacity = container->capacity > 0 ? container->capacity * 2 : 4;
+        if (capacity > BITMAP_ARRAY_MAX) {
+            capacity = BITMAP_ARRAY_MAX;
+        }
+        uint16_t* values = realloc(container->values, sizeof(uint16_t) * capacity);
+        if (values == NULL) {
+            return -1;
+        }
+        container->values = values;
+        container->capacity = capacity;
+    }
+    memmove(container->values + position + 1, container->values + position,
+            sizeof(uint16_t) * (container->cardinality - position));
+    container->values[position] = low;
+    container->cardinality++;
+    return 1;
+}
+
+/* Remove low do contêiner (retorna 1 se estava nele) */
+static int containerRemove(BitmapContainer* container, uint16_t low) {
+    if (isDense(container)) {
+        uint64_t bit = 1ull << (low & 63);
+        if (!(container->words[low >> 6] & bit)) {
+            return 0;
+        }
+        container->words[low >> 6] &= ~bit;
+        container->cardinality--;
+        // Volta a vetor quando couber (falta de memória mantém o mapa)
+        if (container->cardinality <= BITMAP_ARRAY_MAX) {
+            makeSparse(container);
+        }
+        return 1;
+    }
+
+    int position = searchValues(container, low);
+    if (position < 0) {
+        return 0;
+    }
+    memmove(container->values + position, container->values + position + 1,
+            sizeof(uint16_t) * (container->cardinality - position - 1));
+    container->cardinality--;
+    return 1;
+}
+
+static int containerContains(const BitmapContainer* container, uint16_t low) {
+    if (isDense(container)) {
+        return testBit(container->words, low);
+    }
+    return searchValues(container, low) >= 0;
+}
+
+static int containerCopy(BitmapContainer* out, const BitmapContainer* src) {
+    *out = *src;
+    out->values = NULL;
+    out->words = NULL;
+    if (isDense(src)) {
+        out->words = malloc(sizeof(uint64_t) * BITMAP_WORDS);
+        if (out->words == NULL) {
+            return -1;
+        }
+        memcpy(out->words, src->words, sizeof(uint64_t) * BITMAP_WORDS);
+    } else {
+        out->capacity = src->cardinality > 0 ? src->cardinality : 1;
+        out->values = malloc(sizeof(uint16_t) * out->capacity);
+        if (out->values == NULL) {
+            return -1;
+        }
+        memcpy(out->values, src->values, sizeof(uint16_t) * src->cardinality);
+    }
+    return 0;
+}
+
+/* Interseção de dois contêineres com a mesma chave */
+static int containerAnd(BitmapContainer* out, const BitmapContainer* a, const BitmapContainer* b) {
+    memset(out, 0, sizeof(*out));
+    out->key = a->key;
+
+    if (isDense(a) && isDense(b)) {
+        out->words = malloc(sizeof(uint64_t) * BITMAP_WORDS);
+        if (out->words == NULL) {
+            return -1;
+        }
+        for (int i = 0; i < BITMAP_WORDS; i++) {
+            out->words[i] = a->words[i] & b->words[i];
+        }
+        out->cardinality = countBits(out->words);
+        return normalize(out);
+    }
+
+    // Ao menos um lado é esparso: o resultado cabe no menor vetor
+    if (isDense(a)) {
+        const BitmapContainer* swap = a;
+        a = b;
+        b = swap;
+    }
+    out->capacity = a->cardinality > 0 ? a->cardinality : 1;
+    out->values = malloc(sizeof(uint16_t) * out->capacity);
+    if (out->values == NULL) {
+        return -1;
+    }
+
+    if (isDense(b)) {
+        for (int i = 0; i < a->cardinality; i++) {
+            if (testBit(b->words, a->values[i])) {
+                out->values[out->cardinality++] = a->values[i];
+            }
+        }
+    } else {
+        int i = 0, j = 0;
+        while (i < a->cardinality && j < b->cardinality) {
+            if (a->values[i] < b->values[j]) {
+                i++;
+            } else if (a->values[i] > b->values[j]) {
+                j++;
+            } else {
+                out->values[out->cardinality++] = a->values[i];
+                i++;
+                j++;
+            }
+        }
+    }
+    return 0;
+}
+
+/* União de dois contêineres com a mesma chave */
+static int containerOr(BitmapContainer* out, const BitmapContainer* a, const BitmapContainer* b) {
+    memset(out, 0, sizeof(*out));
+    out->key = a->key;
+
+    if (!isDense(a) && !isDense(b)) {
+        out->capacity = a->cardinality + b->cardinality;
+        out->values = malloc(sizeof(uint16_t) * (out->capacity > 0 ? out->capacity : 1));
+        if (out->values == NULL) {
+            return -1;
+        }
+        int i = 0, j = 0;
+        while (i < a->cardinality || j < b->cardinality) {
+            if (j == b->cardinality || (i < a->cardinality && a->values[i] < b->values[j])) {
+                out->values[out->cardinality++] = a->values[i++];
+            } else if (i == a->cardinality || b->values[j] < a->values[i]) {
+                out->values[out->cardinality++] = b->values[j++];
+            } else {
+                out->values[out->cardinality++] = a->values[i];
+                i++;
+                j++;
+            }
+        }
+        return normalize(out);
+    }
+
+    // Ao menos um lado é denso: o resultado é denso
+    if (!isDense(a)) {
+        const BitmapContainer* swap = a;
+        a = b;
+        b = swap;
+    }
+    out->words = malloc(sizeof(uint64_t) * BITMAP_WORDS);
+    if (out->words == NULL) {
+        return -1;
+    }
+    if (isDense(b)) {
+        for (int i = 0; i < BITMAP_WORDS; i++) {
+            out->words[i] = a->words[i] | b->words[i];
+        }
+    } else {
+        memcpy(out->words, a->words, sizeof(uint64_t) * BITMAP_WORDS);
+        for (int i = 0; i < b->cardinality; i++) {
+            out->words[b->values[i] >> 6] |= 1ull << (b->values[i] & 63);
+        }
+    }
+    out->cardinality = countBits(out->words);
+    return 0;
+}
+
+
+/* Funções auxiliares do conjunto */
+/* Posição do contêiner com a chave, ou onde entraria (codificada como
+ * -(posição) - 1) */
+static int searchContainer(const Bitmap* bitmap, uint16_t key) {
+    int first = 0, last = bitmap->count - 1;
+    while (first <= last) {
+        int middle = (first + last) / 2;
+        if (bitmap->containers[middle].key < key) {
+            first = middle + 1;
+        } else if (bitmap->containers[middle].key > key) {
+            last = middle - 1;
+        } else {
+            return middle;
+        }
+    }
+    return -first - 1;
+}
+
+/* Insere o contêiner na posição dada, assumindo sua memória (retorna -1 se
+ * faltar memória) */
+static int insertContainer(Bitmap* bitmap, int position, const BitmapContainer* container) {
+    if (bitmap->count == bitmap->capacity) {
+        int capacity = bitmap->capacity > 0 ? bitmap->capacity * 2 : 4;
+        BitmapContainer* containers = realloc(bitmap->containers, sizeof(BitmapContainer) * capacity);
+        if (containers == NULL) {
+            return -1;
+        }
+        bitmap->containers = containers;
+        bitmap->capacity = capacity;
+    }
+    memmove(bitmap->containers + position + 1, bitmap->containers + position,
+            sizeof(BitmapContainer) * (bitmap->count - position));
+    bitmap->containers[position] = *container;
+    bitmap->count++;
+    return 0;
+}
+
+/* Acrescenta um contêiner calculado ao fim de out (contêineres vazios são
+ * descartados) */
+static int appendResult(Bitmap* out, BitmapContainer* container) {
+    if (container->cardinality == 0) {
+        containerFree(container);
+        return 0;
+    }
+    if (insertContainer(out, out->count, container) < 0) {
+        containerFree(container);
+        return -1;
+    }
+    return 0;
+}
+
+
+/* Funções públicas */
+void bitmapInit(Bitmap* bitmap) {
+    memset(bitmap, 0, sizeof(*bitmap));
+}
+
+void bitmapFree(Bitmap* bitmap) {
+    for (int i = 0; i < bitmap->count; i++) {
+        containerFree(&bitmap->containers[i]);
+    }
+    free(bitmap->containers);
+    bitmapInit(bitmap);
+}
+
+int bitmapAdd(Bitmap* bitmap, uint32_t value) {
+    uint16_t key = (uint16_t)(value >> 16);
+    int position = searchContainer(bitmap, key);
+    if (position < 0) {
+        BitmapContainer container;
+        memset(&container, 0, sizeof(container));
+        container.key = key;
+        position = -position - 1;
+        if (insertContainer(bitmap, position, &container) < 0) {
+            return -1;
+        }
+    }
+
+    BitmapContainer* container = &bitmap->containers[position];
+    if (containerAdd(container, (uint16_t)value) < 0) {
+        if (container->cardinality == 0) {
+            bitmapRemove(bitmap, value); // descarta o contêiner vazio
+        }
+        return -1;
+    }
+    return 0;
+}
+
+void bitmapRemove(Bitmap* bitmap, uint32_t value) {
+    int position = searchContainer(bitmap, (uint16_t)(value >> 16));
+    if (position < 0) {
+        return;
+    }
+
+    BitmapContainer* container = &bitmap->containers[position];
+    containerRemove(container, (uint16_t)value);
+    if (container->cardinality == 0) {
+        containerFree(container);
+        memmove(bitmap->containers + position, bitmap->containers + position + 1,
+                sizeof(BitmapContainer) * (bitmap->count - position - 1));
+        bitmap->count--;
+    }
+}
+
+int bitmapContains(const Bitmap* bitmap, uint32_t value) {
+    int position = searchContainer(bitmap, (uint16_t)(value >> 16));
+    return position >= 0 && containerContains(&bitmap->containers[position], (uint16_t)value);
+}
+
+size_t bitmapCardinality(const Bitmap* bitmap) {
+    size_t total = 0;
+    for (int i = 0; i < bitmap->count; i++) {
+        total += bitmap->containers[i].cardinality;
+    }
+    return total;
+}
+
+int bitmapCopy(Bitmap* out, const Bitmap* src) {
+    for (int i = 0; i < src->count; i++) {
+        BitmapContainer container;
+        if (containerCopy(&container, &src->containers[i]) < 0 ||
+            appendResult(out, &container) < 0) {
+            bitmapFree(out);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bitmapAnd(Bitmap* out, const Bitmap* a, const Bitmap* b) {
+    int i = 0, j = 0;
+    while (i < a->count && j < b->count) {
+        const BitmapContainer* left = &a->containers[i];
+        const BitmapContainer* right = &b->containers[j];
+        if (left->key < right->key) {
+            i++;
+        } else if (left->key > right->key) {
+            j++;
+        } else {
+            BitmapContainer container;
+            if (containerAnd(&container, left, right) < 0 || appendResult(out, &container) < 0) {
+                containerFree(&container);
+                bitmapFree(out);
+                return -1;
+            }
+            i++;
+            j++;
+        }
+    }
+    return 0;
+}
+
+int bitmapOr(Bitmap* out, const Bitmap* a, const Bitmap* b) {
+    int i = 0, j = 0;
+    while (i < a->count || j < b->count) {
+        BitmapContainer container;
+        int result;
+        if (j == b->count || (i < a->count && a->containers[i].key < b->containers[j].key)) {
+            result = containerCopy(&container, &a->containers[i++]);
+        } else if (i == a->count || b->containers[j].key < a->containers[i].key) {
+            result = containerCopy(&container, &b->containers[j++]);
+        } else {
+            result = containerOr(&container, &a->containers[i++], &b->containers[j++]);
+        }
+        if (result < 0 || appendResult(out, &container) < 0) {
+            containerFree(&container);
+            bitmapFree(out);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bitmapForEach(const Bitmap* bitmap, BitmapVisitFn fn, void* arg) {
+    return bitmapForEachFrom(bitmap, 0, fn, arg);
+}
+
+int bitmapForEachFrom(const Bitmap* bitmap, uint32_t start, BitmapVisitFn fn, void* arg) {
+    uint16_t startKey = (uint16_t)(start >> 16);
+    int first = searchContainer(bitmap, startKey);
+    if (first < 0) {
+        first = -first - 1;
+    }
+
+    for (int i = first; i < bitmap->count; i++) {
+        const BitmapContainer* container = &bitmap->containers[i];
+        uint32_t high = (uint32_t)container->key << 16;
+        // Só o contêiner de start começa no meio
+        uint16_t low = container->key == startKey ? (uint16_t)start : 0;
+
+        if (isDense(container)) {
+            for (int w = low / 64; w < BITMAP_WORDS; w++) {
+                uint64_t word = container->words[w];
+                if (w == low / 64) {
+                    word &= ~0ull << (low % 64);
+                }
+                while (word != 0) {
+                    if (fn(high | (uint32_t)(w * 64 + __builtin_ctzll(word)), arg)) {
+                        return 1;
+                    }
+                    word &= word - 1;
+                }
+            }
+        } else {
+            int v = searchValues(container, low);
+            for (v = v < 0 ? -v - 1 : v; v < container->cardinality; v++) {
+                if (fn(high | container->values[v], arg)) {
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/* Cabeçalho de um contêiner serializado */
+typedef struct {
+    uint16_t key;
+    uint16_t dense;         // 1: seguem BITMAP_WORDS palavras; 0: cardinality valores
+    uint32_t cardinality;
+} SerializedContainer;
+
+size_t bitmapSerializedSize(const Bitmap* bitmap) {
+    size_t size = sizeof(uint32_t);
+    for (int i = 0; i < bitmap->count; i++) {
+        const BitmapContainer* container = &bitmap->containers[i];
+        size += sizeof(SerializedContainer);
+        size += isDense(container) ? sizeof(uint64_t) * BITMAP_WORDS
+                                   : sizeof(uint16_t) * container->cardinality;
+    }
+    return size;
+}
+
+void bitmapSerialize(const Bitmap* bitmap, char* out) {
+    uint32_t count = (uint32_t)bitmap->count;
+    memcpy(out, &count, sizeof(count));
+    out += sizeof(count);
+
+    for (int i = 0; i < bitmap->count; i++) {
+        const BitmapContainer* container = &bitmap->containers[i];
+        SerializedContainer header = { container->key, (uint16_t)isDense(container),
+                                       (uint32_t)container->cardinality };
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        if (isDense(container)) {
+            memcpy(out, container->words, sizeof(uint64_t) * BITMAP_WORDS);
+            out += sizeof(uint64_t) * BITMAP_WORDS;
+        } else {
+            memcpy(out, container->values, sizeof(uint16_t) * container->cardinality);
+            out += sizeof(uint16_t) * container->cardinality;
+        }
+    }
+}
+
+int bitmapDeserialize(Bitmap* out, const char* data, size_t length) {
+    uint32_t count;
+    if (length < sizeof(count)) {
+        return -1;
+    }
+    memcpy(&count, data, sizeof(count));
+    size_t offset = sizeof(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        SerializedContainer header;
+        if (length - offset < sizeof(header)) {
+            bitmapFree(out);
+            return -1;
+        }
+        memcpy(&header, data + offset, sizeof(header));
+        offset += sizeof(header);
+
+        // Os contêineres vêm em ordem de chave, cada um na representação
+        // que sua cardinalidade exige
+        size_t bytes = header.dense ? sizeof(uint64_t) * BITMAP_WORDS
+                                    : sizeof(uint16_t) * header.cardinality;
+        if ((out->count > 0 && header.key <= out->containers[out->count - 1].key) ||
+            header.cardinality == 0 || header.cardinality > 65536 ||
+            header.dense != (header.cardinality > BITMAP_ARRAY_MAX) || length - offset < bytes) {
+            bitmapFree(out);
+            return -1;
+        }
+
+        BitmapContainer container;
+        memset(&container, 0, sizeof(container));
+        container.key = header.key;
+        container.cardinality = (int)header.cardinality;
+        if (header.dense) {
+            container.words = malloc(bytes);
+        } else {
+            container.capacity = container.cardinality;
+            container.values = malloc(bytes);
+        }
+        if (container.words == NULL && container.values == NULL) {
+            bitmapFree(out);
+            return -1;
+        }
+        memcpy(header.dense ? (void*)container.words : (void*)container.values, data + offset, bytes);
+        offset += bytes;
+        if ((header.dense && countBits(container.words) != container.cardinality) ||
+            insertContainer(out, out->count, &container) < 0) {
+            containerFree(&container);
+            bitmapFree(out);
+            return -1;
+        }
+    }
+    if (offset != length) {
+        bitmapFree(out);
+        return -1;
+    }
+    return 0;
+}
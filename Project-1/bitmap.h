@@ -0,0 +1,97 @@
+/******************************************************************************
+ * Conjunto compactado de inteiros de 32 bits no estilo Roaring.
+ * - Os valores são divididos pelos 16 bits altos em contêineres, mantidos em
+ *   ordem; cada contêiner guarda os 16 bits baixos de até 65536 valores.
+ * - Contêiner esparso (até BITMAP_ARRAY_MAX valores): vetor ordenado de
+ *   uint16_t. Contêiner denso: mapa de 65536 bits. A troca acontece nos
+ *   dois sentidos conforme a cardinalidade cruza o limite, então cada
+ *   contêiner ocupa no máximo 8 KiB.
+ * - Interseção e união trabalham contêiner a contêiner, escolhendo o
+ *   algoritmo pelo tipo dos dois lados (intercalação de vetores, E/OU de
+ *   palavras de 64 bits ou consulta de bits).
+ ******************************************************************************/
+
+#ifndef BITMAP_H
+#define BITMAP_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define BITMAP_ARRAY_MAX 4096           // Maior contêiner esparso
+#define BITMAP_WORDS 1024               // Palavras de um contêiner denso
+
+
+/* Contêiner dos valores com os mesmos 16 bits altos */
+typedef struct {
+    uint16_t key;           // 16 bits altos dos valores
+    int cardinality;        // Valores no contêiner
+    int capacity;           // Capacidade de values (contêiner esparso)
+    uint16_t* values;       // Esparso: 16 bits baixos, em ordem (ou NULL)
+    uint64_t* words;        // Denso: mapa de bits (ou NULL)
+} BitmapContainer;
+
+typedef struct {
+    BitmapContainer* containers;    // Em ordem de key
+    int count;
+    int capacity;
+} Bitmap;
+
+/* Função chamada para cada valor do conjunto, em ordem crescente; retornar
+ * diferente de 0 interrompe o percurso */
+typedef int (*BitmapVisitFn)(uint32_t value, void* arg);
+
+
+/* Inicializa um conjunto vazio (sem alocar memória) */
+void bitmapInit(Bitmap* bitmap);
+
+/* Libera a memória do conjunto, deixando-o vazio */
+void bitmapFree(Bitmap* bitmap);
+
+/* Adiciona um valor (retorna -1 se faltar memória) */
+int bitmapAdd(Bitmap* bitmap, uint32_t value);
+
+/* Remove um valor, se estiver no conjunto */
+void bitmapRemove(Bitmap* bitmap, uint32_t value);
+
+/* Retorna 1 se o valor está no conjunto */
+int bitmapContains(const Bitmap* bitmap, uint32_t value);
+
+/* Quantidade de valores no conjunto */
+size_t bitmapCardinality(const Bitmap* bitmap);
+
+/* Copia o conjunto src para out, que deve estar vazio (retorna -1 se faltar
+ * memória) */
+int bitmapCopy(Bitmap* out, const Bitmap* src);
+
+/* Interseção de a e b em out, que deve estar vazio (retorna -1 se faltar
+ * memória) */
+int bitmapAnd(Bitmap* out, const Bitmap* a, const Bitmap* b);
+
+/* União de a e b em out, que deve estar vazio (retorna -1 se faltar
+ * memória) */
+int bitmapOr(Bitmap* out, const Bitmap* a, const Bitmap* b);
+
+/* Percorre os valores em ordem crescente (retorna 1 se o percurso foi
+ * interrompido por fn) */
+int bitmapForEach(const Bitmap* bitmap, BitmapVisitFn fn, void* arg);
+
+/* Como bitmapForEach, mas só pelos valores maiores ou iguais a start (para
+ * retomar um percurso interrompido) */
+int bitmapForEachFrom(const Bitmap* bitmap, uint32_t start, BitmapVisitFn fn, void* arg);
+
+/* Bytes que bitmapSerialize grava para o conjunto */
+size_t bitmapSerializedSize(const Bitmap* bitmap);
+
+/* Grava o conjunto em out (bitmapSerializedSize bytes): quantidade de
+ * contêineres e, para cada um, chave, tipo, cardinalidade e os valores ou
+ * o mapa de bits, na ordem de bytes da máquina */
+void bitmapSerialize(const Bitmap* bitmap, char* out);
+
+/* Lê em out, que deve estar vazio, um conjunto gravado por bitmapSerialize
+ * (retorna -1 se os dados estiverem malformados ou faltar memória) */
+int bitmapDeserialize(Bitmap* out, const char* data, size_t length);
+
+
+#endif
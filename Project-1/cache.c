@@ -0,0 +1,218 @@
+/******************************************************************************
+ * Implementação do cache de respostas pré-renderizadas (ver cache.h).
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cache.h"
+
+
+/* Hash FNV-1a da chave */
+static size_t hashKey(const char* key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = key; *c != '\0'; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ull;
+    }
+    return (size_t)hash & (CACHE_BUCKETS - 1);
+}
+
+/* Cria um texto com uma referência e os dados dados */
+static CachedText* newText(const char* data, size_t length, size_t capacity) {
+    CachedText* text = malloc(sizeof(CachedText));
+    if (text == NULL) {
+        return NULL;
+    }
+    text->data = malloc(capacity > 0 ? capacity : 1);
+    if (text->data == NULL) {
+        free(text);
+        return NULL;
+    }
+    memcpy(text->data, data, length);
+    text->refs = 1;
+    text->length = length;
+    text->capacity = capacity;
+    return text;
+}
+
+/* Ponteiro para o elo que aponta a entrada da chave (ou para o NULL do fim
+ * do balde). Deve ser chamada com cache->lock. */
+static CacheEntry** findEntry(ResponseCache* cache, const char* key) {
+    CacheEntry** link = &cache->buckets[hashKey(key)];
+    while (*link != NULL && strcmp((*link)->key, key) != 0) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/* Tira a entrada apontada por link do cache. Deve ser chamada com
+ * cache->lock. */
+static void dropEntry(ResponseCache* cache, CacheEntry** link) {
+    CacheEntry* entry = *link;
+    *link = entry->next;
+    cache->entryCount--;
+    cache->bytes -= entry->text->capacity;
+    cacheRelease(entry->text);
+    free(entry->key);
+    free(entry);
+}
+
+/* Esvazia baldes em rodízio até sobrar espaço para mais uma entrada de
+ * extra bytes. Deve ser chamada com cache->lock. */
+static void makeRoom(ResponseCache* cache, size_t extra) {
+    while (cache->entryCount > 0 &&
+           (cache->entryCount + 1 > cache->maxEntries || cache->bytes + extra > cache->maxBytes)) {
+        CacheEntry** bucket = &cache->buckets[cache->clockHand];
+        cache->clockHand = (cache->clockHand + 1) & (CACHE_BUCKETS - 1);
+        while (*bucket != NULL) {
+            dropEntry(cache, bucket);
+        }
+    }
+}
+
+
+/* Funções públicas */
+int cacheInit(ResponseCache* cache, size_t maxEntries, size_t maxBytes) {
+    memset(cache, 0, sizeof(*cache));
+    cache->maxEntries = maxEntries;
+    cache->maxBytes = maxBytes;
+    return pthread_mutex_init(&cache->lock, NULL) == 0 ? 0 : -1;
+}
+
+CachedText* cacheAcquire(ResponseCache* cache, const char* key, size_t* length) {
+    pthread_mutex_lock(&cache->lock);
+    CacheEntry* entry = *findEntry(cache, key);
+    CachedText* text = NULL;
+    if (entry != NULL) {
+        text = entry->text;
+        cacheRetain(text);
+        *length = text->length;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return text;
+}
+
+void cacheRetain(CachedText* text) {
+    __atomic_add_fetch(&text->refs, 1, __ATOMIC_RELAXED);
+}
+
+void cacheRelease(CachedText* text) {
+    if (__atomic_sub_fetch(&text->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(text->data);
+        free(text);
+    }
+}
+
+uint64_t cacheGeneration(ResponseCache* cache) {
+    pthread_mutex_lock(&cache->lock);
+    uint64_t generation = cache->generation;
+    pthread_mutex_unlock(&cache->lock);
+    return generation;
+}
+
+int cacheStore(ResponseCache* cache, const char* key, const char* data, size_t length, uint64_t generation) {
+    if (length > cache->maxBytes) {
+        return -1;
+    }
+
+    // O texto e a chave são copiados fora do lock
+    CachedText* text = newText(data, length, length);
+    CacheEntry* entry = malloc(sizeof(CacheEntry));
+    char* entryKey = strdup(key);
+    if (text == NULL || entry == NULL || entryKey == NULL) {
+        if (text != NULL) {
+            cacheRelease(text);
+        }
+        free(entry);
+        free(entryKey);
+        return -1;
+    }
+    entry->key = entryKey;
+    entry->text = text;
+
+    pthread_mutex_lock(&cache->lock);
+    if (cache->generation != generation) {
+        // O catálogo mudou enquanto a resposta era montada
+        pthread_mutex_unlock(&cache->lock);
+        cacheRelease(text);
+        free(entry);
+        free(entryKey);
+        return -1;
+    }
+    CacheEntry** link = findEntry(cache, key);
+    if (*link != NULL) {
+        dropEntry(cache, link);
+    }
+    makeRoom(cache, text->capacity);
+
+    CacheEntry** bucket = &cache->buckets[hashKey(key)];
+    entry->next = *bucket;
+    *bucket = entry;
+    cache->entryCount++;
+    cache->bytes += text->capacity;
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+void cacheAppend(ResponseCache* cache, const char* key, const char* data, size_t length) {
+    pthread_mutex_lock(&cache->lock);
+    cache->generation++;
+
+    CacheEntry** link = findEntry(cache, key);
+    CacheEntry* entry = *link;
+    if (entry == NULL) {
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    CachedText* text = entry->text;
+    if (text->length + length <= text->capacity) {
+        // Escreve depois dos bytes publicados, que ninguém altera
+        memcpy(text->data + text->length, data, length);
+        text->length += length;
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+
+    // Sem espaço: um texto novo com o dobro da capacidade substitui o
+    // antigo, que continua válido para quem ainda o envia
+    size_t capacity = text->capacity * 2;
+    while (capacity < text->length + length) {
+        capacity *= 2;
+    }
+    CachedText* grown = cache->bytes - text->capacity + capacity <= cache->maxBytes
+                        ? newText(text->data, text->length, capacity)
+                        : NULL;
+    if (grown == NULL) {
+        dropEntry(cache, link);
+        pthread_mutex_unlock(&cache->lock);
+        return;
+    }
+    memcpy(grown->data + grown->length, data, length);
+    grown->length += length;
+    cache->bytes += grown->capacity - text->capacity;
+    entry->text = grown;
+    cacheRelease(text);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cacheInvalidate(ResponseCache* cache, const char* key) {
+    pthread_mutex_lock(&cache->lock);
+    cache->generation++;
+    CacheEntry** link = findEntry(cache, key);
+    if (*link != NULL) {
+        dropEntry(cache, link);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cacheFree(ResponseCache* cache) {
+    for (size_t i = 0; i < CACHE_BUCKETS; i++) {
+        while (cache->buckets[i] != NULL) {
+            dropEntry(cache, &cache->buckets[i]);
+        }
+    }
+    pthread_mutex_destroy(&cache->lock);
+}
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Cache de respostas pré-renderizadas, indexado por uma chave de texto.
+ * - Cada texto tem contagem de referências: quem o obtém do cache pode
+ *   enviá-lo direto ao socket, sem cópia e sem lock, mesmo que a entrada
+ *   seja invalidada ou trocada no meio do envio.
+ * - Um texto em cache só cresce: acrescentar ao fim (cacheAppend) escreve
+ *   depois dos bytes já publicados, então quem guardou o tamanho antigo
+ *   continua lendo um prefixo estável.
+ * - Toda mudança incrementa a geração do cache. Uma resposta montada fora
+ *   do lock do catálogo só é guardada se a geração não mudou desde que foi
+ *   começada, o que evita guardar uma resposta já desatualizada.
+ * - Limites de entradas e de bytes; acima deles, entradas são descartadas
+ *   em rodízio pelos baldes da tabela.
+ ******************************************************************************/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define CACHE_BUCKETS 1024              // Baldes da tabela (potência de 2)
+
+/* Texto de uma resposta, imutável nos bytes [0, length) */
+typedef struct {
+    int refs;               // Referências: a entrada do cache + envios
+    size_t length;          // Bytes publicados
+    size_t capacity;        // Bytes alocados em data
+    char* data;
+} CachedText;
+
+typedef struct CacheEntry {
+    char* key;
+    CachedText* text;
+    struct CacheEntry* next;    // Próxima entrada do mesmo balde
+} CacheEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    CacheEntry* buckets[CACHE_BUCKETS];
+    size_t entryCount;
+    size_t bytes;               // Soma das capacidades dos textos
+    size_t maxEntries;
+    size_t maxBytes;
+    size_t clockHand;           // Próximo balde a esvaziar quando cheio
+    uint64_t generation;        // Muda a cada alteração do cache
+} ResponseCache;
+
+
+/* Inicializa um cache vazio com os limites dados (retorna -1 em caso de
+ * erro) */
+int cacheInit(ResponseCache* cache, size_t maxEntries, size_t maxBytes);
+
+/* Obtém uma referência ao texto da chave e, em *length, seu tamanho atual
+ * (retorna NULL se a chave não está no cache). A referência deve ser
+ * devolvida com cacheRelease. */
+CachedText* cacheAcquire(ResponseCache* cache, const char* key, size_t* length);
+
+/* Obtém mais uma referência a um texto já obtido */
+void cacheRetain(CachedText* text);
+
+/* Devolve uma referência; a última libera o texto */
+void cacheRelease(CachedText* text);
+
+/* Geração atual do cache */
+uint64_t cacheGeneration(ResponseCache* cache);
+
+/* Guarda uma cópia do texto na chave, se a geração ainda for generation
+ * e o texto couber nos limites (retorna -1 se não guardou) */
+int cacheStore(ResponseCache* cache, const char* key, const char* data, size_t length, uint64_t generation);
+
+/* Acrescenta dados ao fim do texto da chave, se ela estiver no cache
+ * (se faltar memória, a entrada é descartada) */
+void cacheAppend(ResponseCache* cache, const char* key, const char* data, size_t length);
+
+/* Descarta a entrada da chave, se existir */
+void cacheInvalidate(ResponseCache* cache, const char* key);
+
+/* Libera o cache (os textos ainda referenciados continuam válidos) */
+void cacheFree(ResponseCache* cache);
+
+
+#endif
@@ -0,0 +1,533 @@
+/******************************************************************************
+ * Gerador de carga do servidor de filmes.
+ * - Abre várias conexões (conexao.c), divididas entre threads, e envia
+ *   durante um tempo fixo requisições de uma mistura de opções (1 a 7),
+ *   sorteadas pelos pesos dados em -m.
+ * - Laço aberto (com -r): as requisições de cada conexão saem nos instantes
+ *   previstos pela taxa, sem esperar as respostas anteriores (pipelining).
+ *   Cada frame recebido é associado à sua requisição pelo ID: as respostas
+ *   podem chegar fora de ordem e os frames de uma listagem intercalados com
+ *   respostas curtas, e uma requisição só termina no seu último frame. A latência é
+ *   medida a partir do instante previsto, não do envio, então um atraso do
+ *   servidor ou do próprio gerador entra nela (correção da omissão
+ *   coordenada).
+ * - Laço fechado (-F, ou sem -r): cada conexão espera a resposta antes de
+ *   enviar a próxima. Com -r, as requisições são espaçadas pela taxa e as
+ *   amostras que deixaram de ser enviadas durante uma resposta lenta são
+ *   completadas no histograma; sem -r, envia o mais rápido possível.
+ * - Filmes usados: a opção 6 consulta IDs sorteados de 1 a -i; as opções 2
+ *   e 3 usam filmes cadastrados pela própria conexão (opção 1), para não
+ *   alterar o catálogo original, e viram cadastros enquanto não há nenhum.
+ * - Relatório: vazão e, por opção e no total, latências p50, p99, p999 e
+ *   máxima (histograma.c), com e sem a correção.
+ * - Compilação:
+ *      gcc -O2 -o carga carga.c conexao.c histograma.c protocolo.c -lpthread
+ * - Execução:
+ *      ./carga <IP_do_servidor> <porta> [-c conexões] [-t threads]
+ *              [-d segundos] [-r requisições_por_segundo] [-F]
+ *              [-m opção:peso,...] [-i maior_ID] [-g gênero]
+ * - Exemplo de uso:
+ *      ./carga 127.0.0.1 8000 -c 64 -t 4 -r 20000 -d 30
+ *      ./carga 127.0.0.1 8000 -F -m 6:90,1:5,3:5 -i 100000
+ ******************************************************************************/
+
+
+#define _GNU_SOURCE // ppoll
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "conexao.h"
+#include "histograma.h"
+#include "protocolo.h"
+
+
+#define MAX_OPTION 7                // Opções do menu sorteadas
+#define MAX_IN_FLIGHT 1024          // Requisições sem resposta por conexão (laço aberto)
+#define MAX_OWNED 1024              // Filmes cadastrados lembrados por conexão
+#define REQUEST_SIZE 1024           // Maior frame de requisição montado
+#define RECV_BUFFER_SIZE 65536      // Bytes lidos de uma conexão por vez
+#define MAX_RESPONSE_FRAME (16 * 1024 * 1024)   // Maior payload de resposta aceito
+#define POLL_NANOS 100000000ull     // Maior espera de uma thread (confere o fim)
+#define DEFAULT_MIX "6:60,7:10,4:2,5:2,1:14,2:6,3:6"
+
+
+/* Parâmetros da carga */
+typedef struct {
+    const char* serverIp;
+    int port;
+    int connections;            // Total de conexões
+    int threads;                // Threads geradoras de carga
+    int seconds;                // Duração da medição
+    double rate;                // Requisições por segundo, no total (0: sem taxa)
+    int closedLoop;             // Espera cada resposta antes da próxima
+    int weights[MAX_OPTION + 1];    // Peso de cada opção na mistura
+    int totalWeight;
+    int maxId;                  // Maior ID consultado na opção 6
+    const char* genre;          // Gênero das opções 1 e 7
+    uint64_t interval;          // Nanossegundos entre requisições de uma conexão
+} LoadConfig;
+
+/* Requisição enviada e ainda sem resposta */
+typedef struct {
+    uint64_t intendedAt;    // Instante previsto do envio
+    uint64_t sentAt;        // Instante do envio
+    uint32_t requestId;
+    int option;             // 0: posição livre
+    char* text;             // Texto recebido até aqui (só no cadastro)
+    size_t textLength;
+} InFlight;
+
+/* Estado de cada conexão */
+typedef struct {
+    int sock;
+    FrameParser parser;             // Respostas recebidas e ainda incompletas
+    uint32_t nextRequestId;
+    uint64_t nextAt;                // Instante previsto da próxima requisição
+    InFlight inFlight[MAX_IN_FLIGHT];   // Pela posição requestId % MAX_IN_FLIGHT
+    int pending;                    // Requisições sem resposta
+    int owned[MAX_OWNED];           // Filmes cadastrados por esta conexão
+    int ownedCount;
+} LoadConnection;
+
+/* Estado e resultados de cada thread */
+typedef struct {
+    pthread_t thread;
+    int index;
+    LoadConnection* connections;
+    int connectionCount;
+    uint64_t random;                // Estado do sorteio (xorshift)
+    long requests;                  // Respostas recebidas
+    long errors;                    // Conexões perdidas
+    Histogram latency[MAX_OPTION + 1];  // Por opção, com a correção
+    Histogram uncorrected;          // Todas as opções, do envio à resposta
+} LoadThread;
+
+
+LoadConfig config;
+volatile int running = 1;   // Zerado ao fim da medição
+
+
+/* Tempo monotônico em nanossegundos */
+uint64_t nowNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Próximo número do sorteio da thread (xorshift64*) */
+uint64_t nextRandom(LoadThread* load) {
+    load->random ^= load->random >> 12;
+    load->random ^= load->random << 25;
+    load->random ^= load->random >> 27;
+    return load->random * 0x2545F4914F6CDD1Dull;
+}
+
+/* Lê a mistura de opções "opção:peso,..." (retorna -1 se inválida) */
+int parseMix(const char* mix) {
+    memset(config.weights, 0, sizeof(config.weights));
+    config.totalWeight = 0;
+    char* copy = strdup(mix);
+    for (char* item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+        int option, weight;
+        if (sscanf(item, "%d:%d", &option, &weight) != 2 || option < 1 || option > MAX_OPTION ||
+            weight < 0) {
+            free(copy);
+            return -1;
+        }
+        config.weights[option] += weight;
+        config.totalWeight += weight;
+    }
+    free(copy);
+    return config.totalWeight > 0 ? 0 : -1;
+}
+
+/* Sorteia a opção da próxima requisição pelos pesos da mistura */
+int chooseOption(LoadThread* load) {
+    int ticket = (int)(nextRandom(load) % (uint64_t)config.totalWeight);
+    for (int option = 1; option <= MAX_OPTION; option++) {
+        ticket -= config.weights[option];
+        if (ticket < 0) {
+            return option;
+        }
+    }
+    return MAX_OPTION;
+}
+
+/* Esquece as requisições sem resposta da conexão */
+void clearInFlight(LoadConnection* conn) {
+    for (int i = 0; i < MAX_IN_FLIGHT; i++) {
+        free(conn->inFlight[i].text);
+        conn->inFlight[i].text = NULL;
+        conn->inFlight[i].textLength = 0;
+        conn->inFlight[i].option = 0;
+    }
+    conn->pending = 0;
+}
+
+/* Diz se a próxima requisição pode sair: no máximo limit sem resposta, e a
+ * posição do seu ID livre (uma resposta muito atrasada ainda pode ocupá-la) */
+int canSend(const LoadConnection* conn, int limit) {
+    return conn->pending < limit && conn->inFlight[conn->nextRequestId % MAX_IN_FLIGHT].option == 0;
+}
+
+/* Fecha uma conexão que falhou */
+void dropConnection(LoadThread* load, LoadConnection* conn) {
+    close(conn->sock);
+    conn->sock = -1;
+    frameParserFree(&conn->parser);
+    clearInFlight(conn);
+    load->errors++;
+}
+
+/* Monta e envia a próxima requisição da conexão, prevista para intendedAt
+ * (retorna -1 se a conexão caiu) */
+int sendNext(LoadThread* load, LoadConnection* conn, uint64_t intendedAt) {
+    int option = chooseOption(load);
+    if ((option == 2 || option == 3) && conn->ownedCount == 0) {
+        option = 1;
+    }
+
+    char title[64], id[16];
+    const char* fields[FRAME_MAX_FIELDS];
+    int fieldCount = 0;
+    switch (option) {
+        case 1:
+            snprintf(title, sizeof(title), "Carga %d-%u", load->index, conn->nextRequestId);
+            fields[0] = title;
+            fields[1] = "Gerador";
+            fields[2] = "2024";
+            fields[3] = config.genre;
+            fieldCount = 4;
+            break;
+        case 2:
+            snprintf(id, sizeof(id), "%d", conn->owned[nextRandom(load) % (uint64_t)conn->ownedCount]);
+            fields[0] = id;
+            fields[1] = "carga";
+            fieldCount = 2;
+            break;
+        case 3:
+            snprintf(id, sizeof(id), "%d", conn->owned[--conn->ownedCount]);
+            fields[0] = id;
+            fieldCount = 1;
+            break;
+        case 6:
+            snprintf(id, sizeof(id), "%d", (int)(nextRandom(load) % (uint64_t)config.maxId) + 1);
+            fields[0] = id;
+            fieldCount = 1;
+            break;
+        case 7:
+            fields[0] = config.genre;
+            fieldCount = 1;
+            break;
+    }
+
+    char frame[REQUEST_SIZE];
+    uint32_t requestId = conn->nextRequestId++;
+    size_t length = encodeRequest(frame, sizeof(frame), option, requestId, fields, fieldCount);
+    InFlight* request = &conn->inFlight[requestId % MAX_IN_FLIGHT];
+    request->intendedAt = intendedAt;
+    request->sentAt = nowNanos();
+    request->requestId = requestId;
+    request->option = option;
+    conn->pending++;
+    if (length == 0 || sendAll(conn->sock, frame, length) < 0) {
+        dropConnection(load, conn);
+        return -1;
+    }
+    return 0;
+}
+
+/* Trata um frame de resposta completo; no último frame de uma requisição,
+ * registra sua latência (retorna -1 se o frame não corresponde a nenhuma
+ * requisição enviada) */
+int handleFrame(LoadThread* load, LoadConnection* conn, const FrameHeader* header, const char* payload) {
+    InFlight* request = &conn->inFlight[header->requestId % MAX_IN_FLIGHT];
+    if (request->option == 0 || request->requestId != header->requestId) {
+        return -1;
+    }
+
+    // Só o texto do cadastro é guardado (traz o ID); o dos outros é
+    // descartado
+    if (request->option == 1) {
+        char* grown = realloc(request->text, request->textLength + header->length + 1);
+        if (grown == NULL) {
+            return -1;
+        }
+        request->text = grown;
+        memcpy(grown + request->textLength, payload, header->length);
+        request->textLength += header->length;
+        grown[request->textLength] = '\0';
+    }
+    if (header->flags & FRAME_FLAG_MORE) {
+        return 0;
+    }
+    uint64_t now = nowNanos();
+
+    // Cadastro: o ID do filme novo fica para as opções 2 e 3
+    if (request->option == 1) {
+        const char* idText = request->text != NULL ? strstr(request->text, "ID: ") : NULL;
+        if (idText != NULL && conn->ownedCount < MAX_OWNED) {
+            conn->owned[conn->ownedCount++] = atoi(idText + 4);
+        }
+        free(request->text);
+        request->text = NULL;
+        request->textLength = 0;
+    }
+
+    Histogram* latency = &load->latency[request->option];
+    if (config.closedLoop) {
+        histogramRecordCorrected(latency, now - request->sentAt, config.interval);
+    } else {
+        histogramRecord(latency, now - request->intendedAt);
+    }
+    histogramRecord(&load->uncorrected, now - request->sentAt);
+    load->requests++;
+    request->option = 0;
+    conn->pending--;
+    return 0;
+}
+
+/* Lê o que estiver disponível na conexão, sem bloquear, e trata os frames
+ * completos; um frame grande chega aos poucos no parser, sem segurar as
+ * outras conexões da thread (retorna -1 se a conexão caiu) */
+int receiveAvailable(LoadThread* load, LoadConnection* conn, char* buffer) {
+    ssize_t bytesRead = recv(conn->sock, buffer, RECV_BUFFER_SIZE, MSG_DONTWAIT);
+    if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    if (bytesRead <= 0 || frameParserFeed(&conn->parser, buffer, bytesRead) < 0) {
+        dropConnection(load, conn);
+        return -1;
+    }
+
+    FrameHeader header;
+    const char* payload;
+    FrameStatus status;
+    while ((status = frameParserNext(&conn->parser, &header, &payload)) == FRAME_READY) {
+        if (handleFrame(load, conn, &header, payload) < 0) {
+            dropConnection(load, conn);
+            return -1;
+        }
+    }
+    if (status == FRAME_INVALID) {
+        dropConnection(load, conn);
+        return -1;
+    }
+    return 0;
+}
+
+/* Laço de uma thread: envia as requisições previstas de cada conexão e
+ * espera respostas até a próxima prevista */
+void* loadLoop(void* arg) {
+    LoadThread* load = arg;
+    struct pollfd* fds = calloc(load->connectionCount, sizeof(struct pollfd));
+    char* buffer = malloc(RECV_BUFFER_SIZE);
+
+    while (running) {
+        uint64_t now = nowNanos();
+        uint64_t wait = POLL_NANOS;
+        int active = 0;
+        for (int i = 0; i < load->connectionCount; i++) {
+            LoadConnection* conn = &load->connections[i];
+            fds[i].fd = conn->sock;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+            if (conn->sock < 0) {
+                continue;
+            }
+            active++;
+
+            // No laço aberto, envia todas as que já deviam ter saído; uma
+            // requisição retida sai depois, com o mesmo instante previsto
+            int limit = config.closedLoop ? 1 : MAX_IN_FLIGHT;
+            while (conn->sock >= 0 && canSend(conn, limit) && conn->nextAt <= now) {
+                uint64_t intendedAt = config.interval > 0 ? conn->nextAt : now;
+                if (sendNext(load, conn, intendedAt) < 0) {
+                    break;
+                }
+                conn->nextAt = config.closedLoop ? now + config.interval : conn->nextAt + config.interval;
+            }
+            if (conn->sock >= 0 && canSend(conn, limit) && conn->nextAt - now < wait) {
+                wait = conn->nextAt - now;
+            }
+            if (conn->pending == 0) {
+                fds[i].fd = -1;
+            }
+        }
+        if (active == 0) {
+            break;
+        }
+
+        struct timespec timeout = { (time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull) };
+        if (ppoll(fds, load->connectionCount, &timeout, NULL) <= 0) {
+            continue;
+        }
+        for (int i = 0; i < load->connectionCount; i++) {
+            if (fds[i].fd >= 0 && fds[i].revents != 0 && load->connections[i].sock >= 0) {
+                receiveAvailable(load, &load->connections[i], buffer);
+            }
+        }
+    }
+
+    free(buffer);
+    free(fds);
+    return NULL;
+}
+
+/* Imprime uma linha do relatório: latências em microssegundos */
+void printLatencies(const char* label, const Histogram* histogram) {
+    printf("%-7s %12llu %10.1f %10.1f %10.1f %10.1f\n", label, (unsigned long long)histogram->count,
+           histogramPercentile(histogram, 50) / 1e3, histogramPercentile(histogram, 99) / 1e3,
+           histogramPercentile(histogram, 99.9) / 1e3, histogram->max / 1e3);
+}
+
+
+/* Função principal do gerador de carga */
+void printUsage(const char* program) {
+    printf("Uso: %s <IP_do_servidor> <porta> [-c conexões] [-t threads] [-d segundos]\n"
+           "       [-r requisições_por_segundo] [-F] [-m opção:peso,...] [-i maior_ID] [-g gênero]\n",
+           program);
+}
+
+int main(int argc, char* argv[]) {
+    config.connections = 64;
+    config.threads = 4;
+    config.seconds = 10;
+    config.maxId = 1000;
+    config.genre = "drama";
+    const char* mix = DEFAULT_MIX;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:d:r:Fm:i:g:")) != -1) {
+        switch (opt) {
+            case 'c': config.connections = atoi(optarg); break;
+            case 't': config.threads = atoi(optarg); break;
+            case 'd': config.seconds = atoi(optarg); break;
+            case 'r': config.rate = atof(optarg); break;
+            case 'F': config.closedLoop = 1; break;
+            case 'm': mix = optarg; break;
+            case 'i': config.maxId = atoi(optarg); break;
+            case 'g': config.genre = optarg; break;
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (argc - optind < 2 || config.connections < 1 || config.threads < 1 || config.maxId < 1 ||
+        config.rate < 0 || parseMix(mix) < 0) {
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    config.serverIp = argv[optind];
+    config.port = atoi(argv[optind + 1]);
+    if (config.threads > config.connections) {
+        config.threads = config.connections;
+    }
+
+    // Sem taxa não há instantes previstos: o laço é fechado
+    if (config.rate == 0) {
+        config.closedLoop = 1;
+    } else {
+        config.interval = (uint64_t)(config.connections * 1e9 / config.rate);
+    }
+
+    // Abre todas as conexões antes de começar a medir
+    LoadConnection* connections = calloc(config.connections, sizeof(LoadConnection));
+    for (int i = 0; i < config.connections; i++) {
+        connections[i].sock = connectToServer(config.serverIp, config.port);
+        if (connections[i].sock < 0) {
+            perror("Erro na conexão");
+            exit(EXIT_FAILURE);
+        }
+        connections[i].nextRequestId = 1;
+        frameParserInit(&connections[i].parser);
+        connections[i].parser.maxLength = MAX_RESPONSE_FRAME;
+    }
+
+    // Divide as conexões entre as threads; a primeira requisição de cada
+    // conexão é defasada para a taxa total sair uniforme
+    LoadThread* threads = calloc(config.threads, sizeof(LoadThread));
+    uint64_t start = nowNanos();
+    int next = 0;
+    for (int i = 0; i < config.threads; i++) {
+        LoadThread* load = &threads[i];
+        load->index = i;
+        load->random = 0x9E3779B97F4A7C15ull * (i + 1);
+        load->connections = connections + next;
+        load->connectionCount = config.connections / config.threads + (i < config.connections % config.threads);
+        for (int j = 0; j < load->connectionCount; j++) {
+            load->connections[j].nextAt = start + (uint64_t)((next + j) * (config.interval / (double)config.connections));
+        }
+        for (int j = 0; j <= MAX_OPTION; j++) {
+            histogramInit(&load->latency[j]);
+        }
+        histogramInit(&load->uncorrected);
+        next += load->connectionCount;
+    }
+
+    for (int i = 0; i < config.threads; i++) {
+        pthread_create(&threads[i].thread, NULL, loadLoop, &threads[i]);
+    }
+    sleep(config.seconds);
+    running = 0;
+    for (int i = 0; i < config.threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    double elapsed = (nowNanos() - start) / 1e9;
+
+    // Junta os resultados de todas as threads
+    Histogram* byOption = calloc(MAX_OPTION + 1, sizeof(Histogram));
+    Histogram* total = calloc(1, sizeof(Histogram));
+    Histogram* uncorrected = calloc(1, sizeof(Histogram));
+    long requests = 0, errors = 0;
+    for (int i = 0; i < config.threads; i++) {
+        requests += threads[i].requests;
+        errors += threads[i].errors;
+        for (int j = 1; j <= MAX_OPTION; j++) {
+            histogramMerge(&byOption[j], &threads[i].latency[j]);
+            histogramMerge(total, &threads[i].latency[j]);
+        }
+        histogramMerge(uncorrected, &threads[i].uncorrected);
+    }
+
+    printf("laço=%s conexões=%d threads=%d taxa=%.0f req/s duração=%.1fs\n",
+           config.closedLoop ? "fechado" : "aberto", config.connections, config.threads,
+           config.rate, elapsed);
+    printf("requisições=%ld erros=%ld vazão=%.0f req/s\n", requests, errors, requests / elapsed);
+    printf("%-7s %12s %10s %10s %10s %10s\n", "opção", "amostras", "p50 (us)", "p99", "p999", "máx");
+    for (int j = 1; j <= MAX_OPTION; j++) {
+        if (byOption[j].count > 0) {
+            char label[8];
+            snprintf(label, sizeof(label), "%d", j);
+            printLatencies(label, &byOption[j]);
+        }
+    }
+    printLatencies("total", total);
+    printLatencies("s/corr.", uncorrected);
+
+    // Encerra as conexões com a opção 0
+    char closeFrame[FRAME_HEADER_SIZE];
+    encodeFrameHeader(closeFrame, 0, 0, 0, 0);
+    for (int i = 0; i < config.connections; i++) {
+        if (connections[i].sock >= 0) {
+            sendAll(connections[i].sock, closeFrame, sizeof(closeFrame));
+            close(connections[i].sock);
+        }
+        frameParserFree(&connections[i].parser);
+        clearInFlight(&connections[i]);
+    }
+    free(uncorrected);
+    free(total);
+    free(byOption);
+    free(threads);
+    free(connections);
+    return 0;
+}
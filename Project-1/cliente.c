@@ -1,8 +1,15 @@
 /******************************************************************************
  * Implementação de cliente TCP para consultar/cadastrar/remover informações de
  * filmes em um servidor.
+ * - Cada requisição é enviada em um único frame binário (protocolo.h) e a
+ *   resposta chega em outro frame, com o mesmo ID de requisição.
+ * - Na opção 6, vários IDs de filme podem ser dados de uma vez: as consultas
+ *   são enviadas em sequência sem esperar respostas (pipelining) e cada
+ *   resposta é associada à sua consulta pelo ID, na ordem em que chegar.
+ * - Nas listagens (4, 5 e 7), um tamanho de página faz o servidor enviar uma
+ *   página por vez; a próxima é pedida com o cursor do fim da anterior.
  * - Compilação:
- *      gcc -o cliente cliente.c
+ *      gcc -o cliente cliente.c conexao.c protocolo.c
  * - Execução:
  *      ./cliente <IP_do_servidor> <porta desejada>
  * - Exemplo de uso:
@@ -14,12 +21,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <arpa/inet.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
+
+#include "conexao.h"
+#include "protocolo.h"
 
 
 #define BUFFER_SIZE 1024    // Tamanho em bits do buffer para comunicação
+#define MAX_PIPELINE 128    // Máximo de consultas enviadas de uma vez na opção 6
+#define CURSOR_PREFIX "Próximo cursor: "   // Fim de uma página com mais filmes
+
+
+uint32_t nextRequestId = 1; // ID da próxima requisição enviada
 
 
 /* Função auxiliar para ler string do usuário */
@@ -34,6 +46,110 @@ void readLine(char* buffer, int size) {
 }
 
 
+/* Envia uma requisição com a opção e os campos dados em um único frame
+ * (retorna o ID da requisição ou 0 em caso de erro) */
+uint32_t sendRequest(int sock, int option, const char* const* fields, int fieldCount) {
+    char frame[BUFFER_SIZE];
+    uint32_t requestId = nextRequestId++;
+    size_t length = encodeRequest(frame, sizeof(frame), option, requestId, fields, fieldCount);
+    if (length == 0) {
+        printf("Requisição grande demais.\n");
+        return 0;
+    }
+    return sendAll(sock, frame, length) == 0 ? requestId : 0;
+}
+
+/* Recebe um frame de resposta e exibe seu texto */
+void printResponse(int sock) {
+    FrameHeader header;
+    char* text;
+    if (receiveResponse(sock, &header, &text) < 0) {
+        printf("Conexão com o servidor perdida.\n");
+        return;
+    }
+
+    printf("\n--- Resposta do Servidor ---\n%s\n", text);
+    free(text);
+}
+
+/* Consulta vários filmes de uma vez: envia todas as requisições e depois
+ * recebe as respostas, que podem chegar fora de ordem */
+void lookupMovies(int sock, char* idList) {
+    char* ids[MAX_PIPELINE];
+    uint32_t firstId = nextRequestId;
+    int sent = 0;
+
+    for (char* id = strtok(idList, " ,"); id != NULL && sent < MAX_PIPELINE; id = strtok(NULL, " ,")) {
+        const char* fields[] = { id };
+        if (sendRequest(sock, 6, fields, 1) == 0) {
+            break;
+        }
+        ids[sent++] = id;
+    }
+
+    for (int i = 0; i < sent; i++) {
+        FrameHeader header;
+        char* text;
+        if (receiveResponse(sock, &header, &text) < 0) {
+            printf("Conexão com o servidor perdida.\n");
+            return;
+        }
+
+        // O ID da resposta indica a qual consulta ela pertence
+        uint32_t index = header.requestId - firstId;
+        const char* movieId = index < (uint32_t)sent ? ids[index] : "?";
+        printf("\n--- Resposta do Servidor (filme %s) ---\n%s\n", movieId, text);
+        free(text);
+    }
+}
+
+/* Listagem das opções 4, 5 e 7 (genre NULL nas opções 4 e 5). Com tamanho
+ * de página, pede uma página por vez, devolvendo ao servidor o cursor que
+ * veio no fim da anterior. */
+void listMovies(int sock, int option, const char* genre) {
+    char pageSize[20];
+    char cursor[20] = "";
+    printf("Filmes por página (Enter para todos): ");
+    readLine(pageSize, sizeof(pageSize));
+
+    while (1) {
+        const char* fields[] = { genre, pageSize, cursor };
+        const char* const* sent = genre != NULL ? fields : fields + 1;
+        int fieldCount = pageSize[0] != '\0' ? 2 : 0;
+        if (genre != NULL) {
+            fieldCount++;
+        }
+        if (sendRequest(sock, option, sent, fieldCount) == 0) {
+            return;
+        }
+
+        FrameHeader header;
+        char* text;
+        if (receiveResponse(sock, &header, &text) < 0) {
+            printf("Conexão com o servidor perdida.\n");
+            return;
+        }
+        printf("\n--- Resposta do Servidor ---\n%s\n", text);
+
+        // Sem cursor no fim, a listagem acabou
+        const char* next = strstr(text, CURSOR_PREFIX);
+        if (next == NULL) {
+            free(text);
+            return;
+        }
+        snprintf(cursor, sizeof(cursor), "%d", atoi(next + strlen(CURSOR_PREFIX)));
+        free(text);
+
+        char answer[BUFFER_SIZE];
+        printf("Mostrar a próxima página? (s/n): ");
+        readLine(answer, sizeof(answer));
+        if (answer[0] != 's' && answer[0] != 'S') {
+            return;
+        }
+    }
+}
+
+
 /* Função principal do cliente */
 int main(int argc, char* argv[]) {
     if (argc < 3) {
@@ -45,28 +161,10 @@ int main(int argc, char* argv[]) {
     const char* serverIp = argv[1];
     int port = atoi(argv[2]);
 
-    // Cria socket
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        perror("Erro ao criar socket");
-        exit(EXIT_FAILURE);
-    }
-
-    // Configura endereço do servidor
-    struct sockaddr_in serverAddr;
-    memset(&serverAddr, 0, sizeof(serverAddr));
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_port = htons(port);
-    if (inet_pton(AF_INET, serverIp, &serverAddr.sin_addr) <= 0) {
-        perror("Endereço IP inválido");
-        close(sock);
-        exit(EXIT_FAILURE);
-    }
-
     // Conecta ao servidor
-    if (connect(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+    int sock = connectToServer(serverIp, port);
+    if (sock < 0) {
         perror("Erro na conexão");
-        close(sock);
         exit(EXIT_FAILURE);
     }
 
@@ -85,6 +183,7 @@ int main(int argc, char* argv[]) {
         printf("5. Listar informações de todos os filmes\n");
         printf("6. Listar informações de um filme específico\n");
         printf("7. Listar todos os filmes de um determinado gênero\n");
+        printf("8. Estatísticas do servidor\n");
         printf("0. Encerrar conexão\n");
         printf("Escolha uma opção: ");
 
@@ -93,11 +192,9 @@ int main(int argc, char* argv[]) {
         readLine(buffer, sizeof(buffer));
         int option = atoi(buffer);
 
-        // Envia a opção ao servidor
-        send(sock, buffer, strlen(buffer), 0);
-
         if (option == 0) {
-            // Sai do loop
+            // Avisa o servidor e sai do loop
+            sendRequest(sock, 0, NULL, 0);
             printf("Encerrando conexão com o servidor...\n");
             break;
         }
@@ -119,26 +216,10 @@ int main(int argc, char* argv[]) {
                 printf("Digite os gêneros (separados por ponto-e-vírgula e sem espaço): ");
                 readLine(genres, sizeof(genres));
 
-                // Envia título
-                send(sock, title, strlen(title), 0);
-                usleep(100000);
-
-                // Envia diretor
-                send(sock, director, strlen(director), 0);
-                usleep(100000);
-
-                // Envia ano
-                send(sock, yearStr, strlen(yearStr), 0);
-                usleep(100000);
-
-                // Envia gêneros
-                send(sock, genres, strlen(genres), 0);
-
-                // Recebe resposta
-                memset(buffer, 0, sizeof(buffer));
-                int bytesRead = recv(sock, buffer, sizeof(buffer), 0);
-                if (bytesRead > 0) {
-                    printf("\n--- Resposta do Servidor ---\n%s\n", buffer);
+                // Envia título, diretor, ano e gêneros em um único frame
+                const char* fields[] = { title, director, yearStr, genres };
+                if (sendRequest(sock, option, fields, 4) != 0) {
+                    printResponse(sock);
                 }
             } break;
 
@@ -152,18 +233,10 @@ int main(int argc, char* argv[]) {
                 printf("Digite o novo gênero a ser adicionado: ");
                 readLine(genre, sizeof(genre));
 
-                // Envia ID
-                send(sock, idStr, strlen(idStr), 0);
-                usleep(100000);
-
-                // Envia gênero
-                send(sock, genre, strlen(genre), 0);
-
-                // Recebe resposta
-                memset(buffer, 0, sizeof(buffer));
-                int bytesRead = recv(sock, buffer, sizeof(buffer), 0);
-                if (bytesRead > 0) {
-                    printf("\n--- Resposta do Servidor ---\n%s\n", buffer);
+                // Envia ID e gênero
+                const char* fields[] = { idStr, genre };
+                if (sendRequest(sock, option, fields, 2) != 0) {
+                    printResponse(sock);
                 }
             } break;
 
@@ -175,76 +248,53 @@ int main(int argc, char* argv[]) {
                 readLine(idStr, sizeof(idStr));
 
                 // Envia ID
-                send(sock, idStr, strlen(idStr), 0);
-
-                // Recebe resposta
-                memset(buffer, 0, sizeof(buffer));
-                int bytesRead = recv(sock, buffer, sizeof(buffer), 0);
-                if (bytesRead > 0) {
-                    printf("\n--- Resposta do Servidor ---\n%s\n", buffer);
+                const char* fields[] = { idStr };
+                if (sendRequest(sock, option, fields, 1) != 0) {
+                    printResponse(sock);
                 }
             } break;
 
-            case 4: {
+            case 4:
                 // (4) Listar todos os títulos de filmes com seus identificadores
-                // Recebe resposta
-                memset(buffer, 0, sizeof(buffer));
-                int bytesRead = recv(sock, buffer, sizeof(buffer), 0);
-                if (bytesRead > 0) {
-                    printf("\n--- Resposta do Servidor ---\n%s\n", buffer);
-                }
-            } break;
-
-            case 5: {
+            case 5:
                 // (5) Listar informações de todos os filmes
-                // Recebe resposta
-                memset(buffer, 0, sizeof(buffer));
-                int bytesRead = recv(sock, buffer, sizeof(buffer), 0);
-                if (bytesRead > 0) {
-                    printf("\n--- Resposta do Servidor ---\n%s\n", buffer);
-                }
-            } break;
+                listMovies(sock, option, NULL);
+                break;
 
             case 6: {
-                // (6) Listar informações de um filme específico
-                char idStr[20];
-                printf("Digite o ID do filme: ");
-                readLine(idStr, sizeof(idStr));
-
-                // Envia ID
-                send(sock, idStr, strlen(idStr), 0);
+                // (6) Listar informações de um ou mais filmes específicos
+                char idList[BUFFER_SIZE];
+                printf("Digite o ID do filme (ou vários, separados por espaço): ");
+                readLine(idList, sizeof(idList));
 
-                // Recebe resposta
-                memset(buffer, 0, sizeof(buffer));
-                int bytesRead = recv(sock, buffer, sizeof(buffer), 0);
-                if (bytesRead > 0) {
-                    printf("\n--- Resposta do Servidor ---\n%s\n", buffer);
-                }
+                // Envia todos os IDs sem esperar as respostas
+                lookupMovies(sock, idList);
             } break;
 
             case 7: {
                 // (7) Listar todos os filmes de um determinado gênero
                 char genre[100];
-                printf("Digite o gênero: ");
+                printf("Digite o gênero (combine com & para todos e | para qualquer um): ");
                 readLine(genre, sizeof(genre));
 
-                // Envia gênero
-                send(sock, genre, strlen(genre), 0);
+                // Envia gênero (e página, se pedida)
+                listMovies(sock, option, genre);
+            } break;
 
-                // Recebe resposta
-                memset(buffer, 0, sizeof(buffer));
-                int bytesRead = recv(sock, buffer, sizeof(buffer), 0);
-                if (bytesRead > 0) {
-                    printf("\n--- Resposta do Servidor ---\n%s\n", buffer);
+            case 8:
+                // (8) Estatísticas do servidor
+                if (sendRequest(sock, option, NULL, 0) != 0) {
+                    printResponse(sock);
                 }
-            } break;
+                break;
 
             default:
                 printf("Opção inválida!\n");
-                // Recebe possível resposta
-                memset(buffer, 0, sizeof(buffer));
-                recv(sock, buffer, sizeof(buffer), 0);
-                printf("Resposta do servidor: %s\n", buffer);
+                // Recebe a resposta do servidor para a opção inválida (o
+                // opcode tem um byte; 0 encerraria a conexão)
+                if (sendRequest(sock, option > 0 && option < 256 ? option : 255, NULL, 0) != 0) {
+                    printResponse(sock);
+                }
                 break;
         }
 
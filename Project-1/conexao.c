@@ -0,0 +1,123 @@
+/******************************************************************************
+ * Implementação da conexão de um cliente com o servidor (ver conexao.h).
+ ******************************************************************************/
+
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "conexao.h"
+
+
+#define DISCARD_SIZE 65536          // Buffer para descartar o texto de respostas
+
+
+/* Funções públicas */
+int connectToServer(const char* serverIp, int port) {
+    struct sockaddr_in serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(port);
+    if (inet_pton(AF_INET, serverIp, &serverAddr.sin_addr) <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+        int error = errno;
+        close(sock);
+        errno = error;
+        return -1;
+    }
+
+    // Requisições pequenas: não esperar o algoritmo de Nagle
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+}
+
+int sendAll(int sock, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(sock, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return -1;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+int recvAll(int sock, char* data, size_t length) {
+    while (length > 0) {
+        ssize_t bytesRead = recv(sock, data, length, 0);
+        if (bytesRead <= 0) {
+            return -1;
+        }
+        data += bytesRead;
+        length -= bytesRead;
+    }
+    return 0;
+}
+
+int discardBytes(int sock, size_t length) {
+    char discard[DISCARD_SIZE];
+    while (length > 0) {
+        size_t part = length < sizeof(discard) ? length : sizeof(discard);
+        if (recvAll(sock, discard, part) < 0) {
+            return -1;
+        }
+        length -= part;
+    }
+    return 0;
+}
+
+int receiveResponse(int sock, FrameHeader* header, char** text) {
+    char* result = NULL;
+    size_t length = 0;
+
+    // Listagens longas chegam em vários frames: junta até o último
+    do {
+        char headerBytes[FRAME_HEADER_SIZE];
+        if (recvAll(sock, headerBytes, sizeof(headerBytes)) < 0) {
+            free(result);
+            return -1;
+        }
+        decodeFrameHeader(headerBytes, header);
+
+        if (text == NULL) {
+            if (discardBytes(sock, header->length) < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        char* grown = realloc(result, length + header->length + 1);
+        if (grown == NULL) {
+            free(result);
+            return -1;
+        }
+        result = grown;
+        if (recvAll(sock, result + length, header->length) < 0) {
+            free(result);
+            return -1;
+        }
+        length += header->length;
+    } while (header->flags & FRAME_FLAG_MORE);
+
+    if (text != NULL) {
+        result[length] = '\0';
+        *text = result;
+    }
+    return 0;
+}
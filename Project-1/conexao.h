@@ -0,0 +1,37 @@
+/******************************************************************************
+ * Conexão de um cliente com o servidor de filmes.
+ * - Abre a conexão TCP e troca frames do protocolo binário (protocolo.h)
+ *   com envios e recepções completos, bloqueantes.
+ * - Usada pelo cliente interativo (cliente.c) e pelo gerador de carga
+ *   (carga.c), para os dois falarem com o servidor do mesmo jeito.
+ ******************************************************************************/
+
+#ifndef CONEXAO_H
+#define CONEXAO_H
+
+
+#include <stddef.h>
+
+#include "protocolo.h"
+
+
+/* Abre uma conexão TCP com o servidor, sem o atraso do algoritmo de Nagle
+ * (retorna -1 em caso de erro, com errno) */
+int connectToServer(const char* serverIp, int port);
+
+/* Envia todos os bytes de data (retorna -1 em caso de erro) */
+int sendAll(int sock, const char* data, size_t length);
+
+/* Recebe exatamente length bytes (retorna -1 se a conexão cair) */
+int recvAll(int sock, char* data, size_t length);
+
+/* Lê e descarta length bytes (retorna -1 se a conexão cair) */
+int discardBytes(int sock, size_t length);
+
+/* Recebe uma resposta, de um ou mais frames; o texto é alocado em *text e
+ * deve ser liberado por quem chama. Com text NULL, o texto é descartado.
+ * (retorna -1 se a conexão cair) */
+int receiveResponse(int sock, FrameHeader* header, char** text);
+
+
+#endif
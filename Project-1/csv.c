@@ -0,0 +1,215 @@
+/******************************************************************************
+ * Implementação da leitura e escrita de CSV (ver csv.h).
+ ******************************************************************************/
+
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "csv.h"
+
+
+/* Máscaras de um bloco: bit i ligado se o byte i é o caractere */
+typedef struct {
+    uint64_t quotes;
+    uint64_t separators;    // Vírgulas e quebras de linha
+} BlockMasks;
+
+static pthread_once_t classifyOnce = PTHREAD_ONCE_INIT;
+static int classifyAvx2 = 0;
+
+static void chooseClassifier() {
+#if defined(__x86_64__)
+    classifyAvx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+#if defined(__x86_64__)
+/* Classificação com SSE2, que todo x86-64 tem: 16 bytes por comparação */
+static BlockMasks classifySse2(const char* block) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    BlockMasks masks = { 0, 0 };
+    for (int i = 0; i < CSV_BLOCK_SIZE; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(block + i));
+        uint64_t quotes = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote));
+        uint64_t separators = (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, newline)));
+        masks.quotes |= quotes << i;
+        masks.separators |= separators << i;
+    }
+    return masks;
+}
+
+/* Classificação com AVX2: 32 bytes por comparação */
+__attribute__((target("avx2")))
+static BlockMasks classifyAvx2Block(const char* block) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    BlockMasks masks = { 0, 0 };
+    for (int i = 0; i < CSV_BLOCK_SIZE; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(block + i));
+        uint64_t quotes = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quote));
+        uint64_t separators = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, comma), _mm256_cmpeq_epi8(bytes, newline)));
+        masks.quotes |= quotes << i;
+        masks.separators |= separators << i;
+    }
+    return masks;
+}
+#else
+/* Classificação byte a byte, para processadores sem vetores */
+static BlockMasks classifyScalar(const char* block) {
+    BlockMasks masks = { 0, 0 };
+    for (int i = 0; i < CSV_BLOCK_SIZE; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        if (block[i] == '"') {
+            masks.quotes |= bit;
+        } else if (block[i] == ',' || block[i] == '\n') {
+            masks.separators |= bit;
+        }
+    }
+    return masks;
+}
+#endif
+
+/* Classifica o bloco que começa em blockStart, continuando o estado das
+ * aspas do bloco anterior. O último bloco, incompleto, é copiado para um
+ * bloco completado com zeros. */
+static void classifyBlock(CsvReader* reader, size_t blockStart) {
+    const char* block = reader->data + blockStart;
+    char padded[CSV_BLOCK_SIZE];
+    if (reader->length - blockStart < CSV_BLOCK_SIZE) {
+        memset(padded, 0, sizeof(padded));
+        memcpy(padded, block, reader->length - blockStart);
+        block = padded;
+    }
+
+    BlockMasks masks;
+#if defined(__x86_64__)
+    masks = classifyAvx2 ? classifyAvx2Block(block) : classifySse2(block);
+#else
+    masks = classifyScalar(block);
+#endif
+
+    // Cada aspas inverte o estado dos bytes seguintes: o XOR de prefixo liga
+    // os bits dos bytes depois de um número ímpar de aspas. Aspas duplicadas
+    // dentro de um campo invertem duas vezes e não mudam nada.
+    uint64_t inside = masks.quotes;
+    inside ^= inside << 1;
+    inside ^= inside << 2;
+    inside ^= inside << 4;
+    inside ^= inside << 8;
+    inside ^= inside << 16;
+    inside ^= inside << 32;
+    inside ^= reader->insideQuotes;
+    reader->insideQuotes = (uint64_t)((int64_t)inside >> 63);
+
+    reader->blockStart = blockStart;
+    reader->separators = masks.separators & ~inside;
+}
+
+/* Posição do primeiro separador fora de aspas a partir de from (ou o fim
+ * do texto). Os blocos são classificados em ordem, uma vez cada. */
+static size_t nextSeparator(CsvReader* reader, size_t from) {
+    while (1) {
+        // from pode estar em um bloco anterior, quando o campo cruza blocos
+        size_t offset = from > reader->blockStart ? from - reader->blockStart : 0;
+        if (offset < CSV_BLOCK_SIZE) {
+            uint64_t pending = reader->separators & (~(uint64_t)0 << offset);
+            if (pending != 0) {
+                return reader->blockStart + __builtin_ctzll(pending);
+            }
+        }
+        size_t next = reader->blockStart + CSV_BLOCK_SIZE;
+        if (next >= reader->length) {
+            return reader->length;
+        }
+        classifyBlock(reader, next);
+    }
+}
+
+/* Preenche um campo com os bytes [data, data + length) */
+static void setField(CsvField* field, const char* data, size_t length, int endsRecord) {
+    if (endsRecord && length > 0 && data[length - 1] == '\r') {
+        length--;
+    }
+    field->quoted = length >= 2 && data[0] == '"' && data[length - 1] == '"';
+    field->data = field->quoted ? data + 1 : data;
+    field->length = field->quoted ? length - 2 : length;
+}
+
+
+/* Funções públicas */
+void csvReaderInit(CsvReader* reader, const char* data, size_t length) {
+    pthread_once(&classifyOnce, chooseClassifier);
+    reader->data = data;
+    reader->length = length;
+    reader->position = 0;
+    reader->insideQuotes = 0;
+    reader->blockStart = 0;
+    reader->separators = 0;
+    if (length > 0) {
+        classifyBlock(reader, 0);
+    }
+}
+
+int csvNextRecord(CsvReader* reader, CsvField* fields, int maxFields) {
+    if (reader->position >= reader->length) {
+        return 0;
+    }
+
+    int count = 0;
+    size_t start = reader->position;
+    while (1) {
+        size_t end = nextSeparator(reader, start);
+        int endsRecord = end == reader->length || reader->data[end] == '\n';
+        if (count < maxFields) {
+            setField(&fields[count], reader->data + start, end - start, endsRecord);
+        }
+        count++;
+        if (endsRecord) {
+            reader->position = end < reader->length ? end + 1 : end;
+            return count;
+        }
+        start = end + 1;
+    }
+}
+
+size_t csvFieldCopy(const CsvField* field, char* out, size_t size) {
+    size_t copied = 0;
+    if (!field->quoted) {
+        copied = field->length < size - 1 ? field->length : size - 1;
+        memcpy(out, field->data, copied);
+    } else {
+        for (size_t i = 0; i < field->length && copied < size - 1; i++) {
+            out[copied++] = field->data[i];
+            if (field->data[i] == '"' && i + 1 < field->length && field->data[i + 1] == '"') {
+                i++;
+            }
+        }
+    }
+    out[copied] = '\0';
+    return copied;
+}
+
+void csvWriteField(FILE* file, const char* value) {
+    if (strpbrk(value, ",\"\r\n") == NULL) {
+        fputs(value, file);
+        return;
+    }
+    putc('"', file);
+    for (const char* c = value; *c != '\0'; c++) {
+        if (*c == '"') {
+            putc('"', file);
+        }
+        putc(*c, file);
+    }
+    putc('"', file);
+}
@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Leitura e escrita de CSV (RFC 4180).
+ * - O texto é classificado em blocos de 64 bytes: uma máscara de bits marca
+ *   as aspas, as vírgulas e as quebras de linha do bloco (AVX2 ou SSE2
+ *   quando o processador tem, laço escalar nos outros casos). O XOR de
+ *   prefixo da máscara de aspas dá os bytes entre aspas, e as vírgulas e
+ *   quebras de linha fora delas são os separadores. Os campos são
+ *   recortados seguindo os bits dos separadores, sem olhar os outros bytes.
+ * - Campos entre aspas podem conter vírgulas, quebras de linha e aspas
+ *   duplicadas (""); as aspas só são desfeitas ao copiar o campo. Um '\r'
+ *   antes da quebra de linha é ignorado. Como na RFC, aspas só podem
+ *   aparecer em campos entre aspas.
+ * - O leitor não copia nem altera o texto, que pode ser um arquivo mapeado.
+ ******************************************************************************/
+
+#ifndef CSV_H
+#define CSV_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+#define CSV_BLOCK_SIZE 64               // Bytes classificados por vez
+
+
+/* Campo de um registro, apontando para o texto lido */
+typedef struct {
+    const char* data;   // Bytes do campo, sem as aspas externas
+    size_t length;
+    int quoted;         // Estava entre aspas (pode ter aspas duplicadas)
+} CsvField;
+
+typedef struct {
+    const char* data;
+    size_t length;
+    size_t position;        // Início do próximo registro
+    size_t blockStart;      // Início do bloco classificado
+    uint64_t separators;    // Separadores fora de aspas do bloco
+    uint64_t insideQuotes;  // Todos os bits 1 se o bloco seguinte começa entre aspas
+} CsvReader;
+
+
+/* Começa a ler os length bytes de data, que devem existir enquanto o
+ * leitor e seus campos forem usados */
+void csvReaderInit(CsvReader* reader, const char* data, size_t length);
+
+/* Lê o próximo registro, guardando até maxFields campos em fields. Retorna
+ * o número de campos do registro (mesmo se maior que maxFields) ou 0 no
+ * fim do texto. */
+int csvNextRecord(CsvReader* reader, CsvField* fields, int maxFields);
+
+/* Copia o valor do campo para out, desfazendo as aspas duplicadas e
+ * cortando em size - 1 bytes, seguido de '\0'. Retorna os bytes copiados. */
+size_t csvFieldCopy(const CsvField* field, char* out, size_t size);
+
+/* Escreve value como campo: entre aspas, com as aspas internas duplicadas,
+ * se tiver vírgula, aspas ou quebra de linha */
+void csvWriteField(FILE* file, const char* value);
+
+
+#endif
@@ -0,0 +1,172 @@
+/******************************************************************************
+ * Implementação das estatísticas de atendimento (ver estatisticas.h).
+ ******************************************************************************/
+
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "estatisticas.h"
+
+
+/* Nome de cada opção no texto das estatísticas */
+static const char* optionNames[STATS_LOCK_HOLDERS] = {
+    "inválida", "cadastro", "gênero", "remoção", "títulos", "filmes", "consulta", "por gênero",
+    "estatísticas", "compactação"
+};
+
+
+/* Estatísticas da opção (opcodes desconhecidos ficam na posição 0) */
+static OptionStats* optionStats(ServerStats* stats, int option) {
+    return &stats->options[option >= 1 && option <= STATS_MAX_OPTION ? option : 0];
+}
+
+/* Uso do lock pela opção ou pela compactação */
+static LockStats* lockStats(ServerStats* stats, int holder) {
+    return &stats->locks[holder >= 1 && holder < STATS_LOCK_HOLDERS ? holder : 0];
+}
+
+/* Acrescenta texto formatado em out a partir de *length, sem passar de size */
+static void appendText(char* out, size_t size, size_t* length, const char* format, ...) {
+    if (*length + 1 >= size) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(out + *length, size - *length, format, args);
+    va_end(args);
+    if (written > 0) {
+        *length += (size_t)written < size - *length ? (size_t)written : size - *length - 1;
+    }
+}
+
+/* Acrescenta "p50/p99/p999/máx" de um histograma, em microssegundos */
+static void appendLatencies(char* out, size_t size, size_t* length, const Histogram* histogram) {
+    appendText(out, size, length, " %8.1f/%.1f/%.1f/%.1f", histogramPercentile(histogram, 50) / 1e3,
+               histogramPercentile(histogram, 99) / 1e3, histogramPercentile(histogram, 99.9) / 1e3,
+               histogram->max / 1e3);
+}
+
+
+/* Funções públicas */
+uint64_t statsNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void statsInit(ServerStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->startedAt = statsNow();
+}
+
+void statsRecordRequest(ServerStats* stats, int option, const RequestTiming* timing,
+                        uint64_t bytesIn, uint64_t bytesOut, int failed) {
+    OptionStats* entry = optionStats(stats, option);
+    __atomic_add_fetch(&entry->requests, 1, __ATOMIC_RELAXED);
+    if (failed) {
+        __atomic_add_fetch(&entry->errors, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&entry->bytesIn, bytesIn, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&entry->bytesOut, bytesOut, __ATOMIC_RELAXED);
+    histogramRecordShared(&entry->queueing, timing->queueing);
+    histogramRecordShared(&entry->lockWait, timing->lockWait);
+    histogramRecordShared(&entry->execution, timing->execution);
+}
+
+void statsRecordLock(ServerStats* stats, int holder, int write, uint64_t wait, uint64_t hold) {
+    LockStats* entry = lockStats(stats, holder);
+    __atomic_add_fetch(write ? &entry->writes : &entry->reads, 1, __ATOMIC_RELAXED);
+    histogramRecordShared(&entry->wait, wait);
+    histogramRecordShared(&entry->hold, hold);
+}
+
+void statsRecordBlocked(ServerStats* stats, int writer, uint64_t wait) {
+    LockStats* entry = lockStats(stats, writer);
+    __atomic_add_fetch(&entry->blockedCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&entry->blockedNanos, wait, __ATOMIC_RELAXED);
+}
+
+void statsCountInvalidFrame(ServerStats* stats) {
+    __atomic_add_fetch(&stats->invalidFrames, 1, __ATOMIC_RELAXED);
+}
+
+size_t statsFormat(const ServerStats* stats, char* out, size_t size) {
+    size_t length = 0;
+    out[0] = '\0';
+    appendText(out, size, &length, "Estatísticas do servidor (há %.1f s):\n",
+               (statsNow() - stats->startedAt) / 1e9);
+    appendText(out, size, &length, "opção  requisições      erros      recebidos       enviados\n");
+    for (int option = 0; option <= STATS_MAX_OPTION; option++) {
+        const OptionStats* entry = &stats->options[option];
+        uint64_t requests = __atomic_load_n(&entry->requests, __ATOMIC_RELAXED);
+        if (requests == 0) {
+            continue;
+        }
+        appendText(out, size, &length, "%5d  %11llu %10llu %14llu %14llu  %s\n", option,
+                   (unsigned long long)requests,
+                   (unsigned long long)__atomic_load_n(&entry->errors, __ATOMIC_RELAXED),
+                   (unsigned long long)__atomic_load_n(&entry->bytesIn, __ATOMIC_RELAXED),
+                   (unsigned long long)__atomic_load_n(&entry->bytesOut, __ATOMIC_RELAXED),
+                   optionNames[option]);
+    }
+
+    // Os histogramas são copiados antes de calcular os percentis, pois
+    // continuam recebendo valores
+    Histogram* copies = malloc(3 * sizeof(Histogram));
+    if (copies != NULL) {
+        appendText(out, size, &length, "Latências em us (p50/p99/p999/máx):\n");
+        appendText(out, size, &length, "opção  fila | lock | execução\n");
+        for (int option = 0; option <= STATS_MAX_OPTION; option++) {
+            const OptionStats* entry = &stats->options[option];
+            if (__atomic_load_n(&entry->requests, __ATOMIC_RELAXED) == 0) {
+                continue;
+            }
+            histogramInit(&copies[0]);
+            histogramInit(&copies[1]);
+            histogramInit(&copies[2]);
+            histogramMerge(&copies[0], &entry->queueing);
+            histogramMerge(&copies[1], &entry->lockWait);
+            histogramMerge(&copies[2], &entry->execution);
+            appendText(out, size, &length, "%5d ", option);
+            appendLatencies(out, size, &length, &copies[0]);
+            appendText(out, size, &length, " |");
+            appendLatencies(out, size, &length, &copies[1]);
+            appendText(out, size, &length, " |");
+            appendLatencies(out, size, &length, &copies[2]);
+            appendText(out, size, &length, "\n");
+        }
+
+        appendText(out, size, &length, "Lock do catálogo, por dona (us: espera | com o lock; causou: "
+                                       "esperas de outros durante a escrita):\n");
+        appendText(out, size, &length, "opção  leituras/escritas  espera | com o lock | causou\n");
+        for (int holder = 0; holder < STATS_LOCK_HOLDERS; holder++) {
+            const LockStats* entry = &stats->locks[holder];
+            uint64_t reads = __atomic_load_n(&entry->reads, __ATOMIC_RELAXED);
+            uint64_t writes = __atomic_load_n(&entry->writes, __ATOMIC_RELAXED);
+            uint64_t blocked = __atomic_load_n(&entry->blockedCount, __ATOMIC_RELAXED);
+            if (reads + writes + blocked == 0) {
+                continue;
+            }
+            histogramInit(&copies[0]);
+            histogramInit(&copies[1]);
+            histogramMerge(&copies[0], &entry->wait);
+            histogramMerge(&copies[1], &entry->hold);
+            appendText(out, size, &length, "%5d  %8llu/%-8llu", holder, (unsigned long long)reads,
+                       (unsigned long long)writes);
+            appendLatencies(out, size, &length, &copies[0]);
+            appendText(out, size, &length, " |");
+            appendLatencies(out, size, &length, &copies[1]);
+            appendText(out, size, &length, " | %llu em %.1f ms  %s\n", (unsigned long long)blocked,
+                       __atomic_load_n(&entry->blockedNanos, __ATOMIC_RELAXED) / 1e6, optionNames[holder]);
+        }
+        free(copies);
+    }
+
+    appendText(out, size, &length, "Frames inválidos: %llu\n",
+               (unsigned long long)__atomic_load_n(&stats->invalidFrames, __ATOMIC_RELAXED));
+    return length;
+}
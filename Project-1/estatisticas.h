@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Estatísticas de atendimento do servidor, por opção (opcode).
+ * - Para cada opção: requisições, erros, bytes recebidos e enviados e
+ *   histogramas de latência (histograma.c) de três etapas:
+ *      fila      - da chegada do frame completo até o início da execução
+ *                  (espera no pool de workers ou atrás de outras requisições
+ *                  da mesma conexão);
+ *      lock      - espera pelo lock do catálogo;
+ *      execução  - o resto do tempo executando (sem a espera pelo lock e
+ *                  sem a espera do log chegar ao disco); numa listagem, a
+ *                  soma da geração de todas as suas partes.
+ * - Lock do catálogo: cada aquisição registra, para a opção que o tomou (ou
+ *   a compactação), o modo, a espera e o tempo com o lock. A espera de quem
+ *   encontrou o lock de escrita tomado é somada também a quem o tinha, o
+ *   que mostra qual operação causa as paradas das outras.
+ * - Registrar é atômico e sem lock: workers e threads de eventos gravam nas
+ *   mesmas estatísticas.
+ * - Opcodes fora de 1 a STATS_MAX_OPTION contam juntos como "inválida".
+ ******************************************************************************/
+
+#ifndef ESTATISTICAS_H
+#define ESTATISTICAS_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "histograma.h"
+
+
+#define STATS_MAX_OPTION 8              // Maior opção do protocolo (estatísticas)
+#define STATS_COMPACTION (STATS_MAX_OPTION + 1) // Dona do lock na compactação do log
+#define STATS_LOCK_HOLDERS (STATS_MAX_OPTION + 2)
+
+
+/* Tempos de uma requisição, em nanossegundos */
+typedef struct {
+    uint64_t queueing;      // Na fila, antes de executar
+    uint64_t lockWait;      // Esperando o lock do catálogo
+    uint64_t execution;     // Executando, sem a espera pelo lock
+} RequestTiming;
+
+/* Estatísticas de uma opção */
+typedef struct {
+    uint64_t requests;
+    uint64_t errors;        // Respostas de erro ou listagens interrompidas
+    uint64_t bytesIn;       // Frames de requisição recebidos
+    uint64_t bytesOut;      // Frames de resposta gerados
+    Histogram queueing;
+    Histogram lockWait;
+    Histogram execution;
+} OptionStats;
+
+/* Uso do lock do catálogo por uma opção */
+typedef struct {
+    uint64_t reads;         // Aquisições do lock de leitura
+    uint64_t writes;        // Aquisições do lock de escrita
+    uint64_t blockedCount;  // Aquisições de outros que esperaram esta escrita
+    uint64_t blockedNanos;  // Soma das esperas dessas aquisições
+    Histogram wait;         // Espera até obter o lock
+    Histogram hold;         // Tempo com o lock
+} LockStats;
+
+typedef struct {
+    OptionStats options[STATS_MAX_OPTION + 1];  // Pela opção; 0: inválidas
+    LockStats locks[STATS_LOCK_HOLDERS];        // Pela opção ou STATS_COMPACTION
+    uint64_t invalidFrames; // Frames malformados (a conexão é encerrada)
+    uint64_t startedAt;     // Início da contagem (statsNow)
+} ServerStats;
+
+
+/* Tempo monotônico em nanossegundos */
+uint64_t statsNow();
+
+/* Zera as estatísticas e começa a contagem */
+void statsInit(ServerStats* stats);
+
+/* Registra uma requisição atendida */
+void statsRecordRequest(ServerStats* stats, int option, const RequestTiming* timing,
+                        uint64_t bytesIn, uint64_t bytesOut, int failed);
+
+/* Registra uma aquisição do lock do catálogo pela opção holder, que
+ * esperou wait e ficou com o lock por hold nanossegundos */
+void statsRecordLock(ServerStats* stats, int holder, int write, uint64_t wait, uint64_t hold);
+
+/* Soma a espera de uma aquisição que encontrou o lock de escrita com a
+ * opção writer */
+void statsRecordBlocked(ServerStats* stats, int writer, uint64_t wait);
+
+/* Conta um frame malformado */
+void statsCountInvalidFrame(ServerStats* stats);
+
+/* Escreve as estatísticas em texto em out, com no máximo size bytes
+ * contando o '\0' (retorna o tamanho do texto) */
+size_t statsFormat(const ServerStats* stats, char* out, size_t size);
+
+
+#endif
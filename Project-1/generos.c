@@ -0,0 +1,246 @@
+/******************************************************************************
+ * Implementação do índice invertido de gêneros (ver generos.h).
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "generos.h"
+
+
+/* Hash FNV-1a do nome */
+static size_t hashName(const char* name, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 1099511628211ull;
+    }
+    return (size_t)hash;
+}
+
+/* Posição do nome na tabela de hash, ou da posição vazia onde entraria */
+static size_t probeName(const GenreIndex* index, const char* name, size_t length) {
+    size_t mask = index->tableCapacity - 1;
+    size_t position = hashName(name, length) & mask;
+    while (index->table[position] >= 0) {
+        const char* existing = index->names[index->table[position]];
+        if (strncmp(existing, name, length) == 0 && existing[length] == '\0') {
+            break;
+        }
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+/* Dobra a tabela de hash de nomes */
+static int growTable(GenreIndex* index) {
+    size_t capacity = index->tableCapacity * 2;
+    int* table = malloc(sizeof(int) * capacity);
+    if (table == NULL) {
+        return -1;
+    }
+    free(index->table);
+    index->table = table;
+    index->tableCapacity = capacity;
+    memset(table, -1, sizeof(int) * capacity);
+    for (int id = 0; id < index->count; id++) {
+        const char* name = index->names[id];
+        index->table[probeName(index, name, strlen(name))] = id;
+    }
+    return 0;
+}
+
+/* Remove espaços nas pontas de [*start, *start + *length) */
+static void trim(const char** start, size_t* length) {
+    while (*length > 0 && (**start == ' ' || **start == '\t')) {
+        (*start)++;
+        (*length)--;
+    }
+    while (*length > 0 && ((*start)[*length - 1] == ' ' || (*start)[*length - 1] == '\t')) {
+        (*length)--;
+    }
+}
+
+/* Calcula em out a interseção dos gêneros de um termo "a&b&c" */
+static int queryTerm(const GenreIndex* index, const char* term, size_t termLength, Bitmap* out) {
+    int first = 1;
+    const char* end = term + termLength;
+    while (term <= end) {
+        const char* separator = memchr(term, '&', end - term);
+        if (separator == NULL) {
+            separator = end;
+        }
+        const char* name = term;
+        size_t length = separator - term;
+        trim(&name, &length);
+        term = separator + 1;
+
+        int id = length > 0 ? genreFind(index, name, length) : -1;
+        if (id < 0) {
+            // Gênero desconhecido: a interseção é vazia
+            bitmapFree(out);
+            return 0;
+        }
+
+        Bitmap result;
+        bitmapInit(&result);
+        int status = first ? bitmapCopy(&result, &index->movies[id])
+                           : bitmapAnd(&result, out, &index->movies[id]);
+        bitmapFree(out);
+        if (status < 0) {
+            return -1;
+        }
+        *out = result;
+        first = 0;
+    }
+    return 0;
+}
+
+
+/* Funções públicas */
+int genreIndexInit(GenreIndex* index) {
+    memset(index, 0, sizeof(*index));
+    index->tableCapacity = 64;
+    index->table = malloc(sizeof(int) * index->tableCapacity);
+    if (index->table == NULL) {
+        return -1;
+    }
+    memset(index->table, -1, sizeof(int) * index->tableCapacity);
+    return 0;
+}
+
+int genreFind(const GenreIndex* index, const char* name, size_t length) {
+    return index->table[probeName(index, name, length)];
+}
+
+int genreIntern(GenreIndex* index, const char* name, size_t length) {
+    size_t position = probeName(index, name, length);
+    if (index->table[position] >= 0) {
+        return index->table[position];
+    }
+
+    // Mantém a tabela de hash no máximo metade cheia
+    if ((size_t)(index->count + 1) * 2 > index->tableCapacity) {
+        if (growTable(index) < 0) {
+            return -1;
+        }
+        position = probeName(index, name, length);
+    }
+    if (index->count == index->capacity) {
+        int capacity = index->capacity > 0 ? index->capacity * 2 : 16;
+        char** names = realloc(index->names, sizeof(char*) * capacity);
+        if (names == NULL) {
+            return -1;
+        }
+        index->names = names;
+        Bitmap* movies = realloc(index->movies, sizeof(Bitmap) * capacity);
+        if (movies == NULL) {
+            return -1;
+        }
+        index->movies = movies;
+        index->capacity = capacity;
+    }
+
+    char* copy = malloc(length + 1);
+    if (copy == NULL) {
+        return -1;
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+
+    int id = index->count++;
+    index->names[id] = copy;
+    bitmapInit(&index->movies[id]);
+    index->table[position] = id;
+    return id;
+}
+
+int genreIndexAddMovie(GenreIndex* index, int movieId, const char* genres) {
+    while (*genres != '\0') {
+        const char* separator = strchr(genres, GENRE_SEPARATOR);
+        size_t length = separator != NULL ? (size_t)(separator - genres) : strlen(genres);
+        if (length > 0) {
+            int id = genreIntern(index, genres, length);
+            if (id < 0 || bitmapAdd(&index->movies[id], (uint32_t)movieId) < 0) {
+                return -1;
+            }
+        }
+        genres += length + (separator != NULL);
+    }
+    return 0;
+}
+
+void genreIndexRemoveMovie(GenreIndex* index, int movieId, const char* genres) {
+    while (*genres != '\0') {
+        const char* separator = strchr(genres, GENRE_SEPARATOR);
+        size_t length = separator != NULL ? (size_t)(separator - genres) : strlen(genres);
+        int id = length > 0 ? genreFind(index, genres, length) : -1;
+        if (id >= 0) {
+            bitmapRemove(&index->movies[id], (uint32_t)movieId);
+        }
+        genres += length + (separator != NULL);
+    }
+}
+
+uint64_t genreIndexMask(const GenreIndex* index, const char* genres) {
+    uint64_t mask = 0;
+    while (*genres != '\0') {
+        const char* separator = strchr(genres, GENRE_SEPARATOR);
+        size_t length = separator != NULL ? (size_t)(separator - genres) : strlen(genres);
+        int id = length > 0 ? genreFind(index, genres, length) : -1;
+        if (id >= 0 && id < GENRE_MASK_BITS) {
+            mask |= (uint64_t)1 << id;
+        }
+        genres += length + (separator != NULL);
+    }
+    return mask;
+}
+
+int genreListContains(const char* genres, const char* genre, size_t length) {
+    while (*genres != '\0') {
+        const char* separator = strchr(genres, GENRE_SEPARATOR);
+        size_t itemLength = separator != NULL ? (size_t)(separator - genres) : strlen(genres);
+        if (itemLength == length && strncmp(genres, genre, length) == 0) {
+            return 1;
+        }
+        genres += itemLength + (separator != NULL);
+    }
+    return 0;
+}
+
+int genreIndexQuery(const GenreIndex* index, const char* expression, Bitmap* out) {
+    // União dos termos separados por '|'
+    const char* end = expression + strlen(expression);
+    while (expression <= end) {
+        const char* separator = memchr(expression, '|', end - expression);
+        if (separator == NULL) {
+            separator = end;
+        }
+
+        Bitmap term, result;
+        bitmapInit(&term);
+        bitmapInit(&result);
+        if (queryTerm(index, expression, separator - expression, &term) < 0 ||
+            bitmapOr(&result, out, &term) < 0) {
+            bitmapFree(&term);
+            return -1;
+        }
+        bitmapFree(&term);
+        bitmapFree(out);
+        *out = result;
+        expression = separator + 1;
+    }
+    return 0;
+}
+
+void genreIndexFree(GenreIndex* index) {
+    for (int id = 0; id < index->count; id++) {
+        free(index->names[id]);
+        bitmapFree(&index->movies[id]);
+    }
+    free(index->names);
+    free(index->movies);
+    free(index->table);
+    memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+ * Índice invertido de gêneros.
+ * - Cada nome de gênero é internado uma única vez e ganha um ID inteiro; o
+ *   gênero guarda o conjunto (bitmap.h) dos IDs dos filmes que o têm.
+ * - A comparação é exata, por gênero inteiro: "ação" não encontra filmes
+ *   que só têm "ação-policial".
+ * - Consultas combinam gêneros com '&' (todos) e '|' (qualquer um); '&' tem
+ *   precedência, então "ação&drama|comédia" é (ação E drama) OU comédia.
+ ******************************************************************************/
+
+#ifndef GENEROS_H
+#define GENEROS_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitmap.h"
+
+
+#define GENRE_SEPARATOR ';'     // Separador de gêneros na string de um filme
+#define GENRE_MASK_BITS 64      // Gêneros com ID abaixo disso cabem em uma máscara
+
+
+typedef struct {
+    char** names;           // Nome de cada gênero, pelo ID
+    Bitmap* movies;         // IDs dos filmes de cada gênero, pelo ID
+    int count;              // Gêneros internados
+    int capacity;
+    int* table;             // Tabela de hash de nomes -> ID do gênero (-1: vazia)
+    size_t tableCapacity;   // Potência de 2
+} GenreIndex;
+
+
+/* Inicializa o índice vazio (retorna -1 se faltar memória) */
+int genreIndexInit(GenreIndex* index);
+
+/* ID do gênero com o nome dado (-1 se não existir) */
+int genreFind(const GenreIndex* index, const char* name, size_t length);
+
+/* ID do gênero com o nome dado, internando-o se for novo (retorna -1 se
+ * faltar memória) */
+int genreIntern(GenreIndex* index, const char* name, size_t length);
+
+/* Adiciona o filme aos gêneros da string genres ("ação;drama") (retorna -1
+ * se faltar memória) */
+int genreIndexAddMovie(GenreIndex* index, int movieId, const char* genres);
+
+/* Remove o filme dos gêneros da string genres */
+void genreIndexRemoveMovie(GenreIndex* index, int movieId, const char* genres);
+
+/* Máscara com o bit g ligado para cada gênero de ID g < GENRE_MASK_BITS da
+ * string genres (os gêneros devem já estar internados) */
+uint64_t genreIndexMask(const GenreIndex* index, const char* genres);
+
+/* Retorna 1 se a string genres contém exatamente o gênero dado */
+int genreListContains(const char* genres, const char* genre, size_t length);
+
+/* Calcula em out (vazio) os IDs dos filmes que atendem à expressão (retorna
+ * -1 se faltar memória) */
+int genreIndexQuery(const GenreIndex* index, const char* expression, Bitmap* out);
+
+/* Libera a memória do índice */
+void genreIndexFree(GenreIndex* index);
+
+
+#endif
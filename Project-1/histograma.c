@@ -0,0 +1,114 @@
+/******************************************************************************
+ * Implementação do histograma de latências (ver histograma.h).
+ ******************************************************************************/
+
+
+#include <string.h>
+
+#include "histograma.h"
+
+
+#define EXACT_LIMIT ((uint64_t)1 << HISTOGRAM_SUB_BITS)
+#define HALF_SUB ((uint64_t)1 << (HISTOGRAM_SUB_BITS - 1))
+#define MAX_VALUE (((uint64_t)1 << HISTOGRAM_MAX_BITS) - 1)
+
+
+/* Faixa de um valor: abaixo de EXACT_LIMIT, o próprio valor; acima, os
+ * HISTOGRAM_SUB_BITS bits mais altos dizem a faixa dentro da potência de 2 */
+static int bucketOf(uint64_t value) {
+    if (value > MAX_VALUE) {
+        value = MAX_VALUE;
+    }
+    if (value < EXACT_LIMIT) {
+        return (int)value;
+    }
+    int shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BITS - 1);
+    uint64_t sub = value >> shift;     // Entre HALF_SUB e EXACT_LIMIT - 1
+    return (int)(EXACT_LIMIT + (uint64_t)(shift - 1) * HALF_SUB + (sub - HALF_SUB));
+}
+
+/* Maior valor contado na faixa */
+static uint64_t bucketHighest(int bucket) {
+    if ((uint64_t)bucket < EXACT_LIMIT) {
+        return (uint64_t)bucket;
+    }
+    uint64_t offset = (uint64_t)bucket - EXACT_LIMIT;
+    int shift = (int)(offset / HALF_SUB) + 1;
+    uint64_t sub = HALF_SUB + offset % HALF_SUB;
+    return ((sub + 1) << shift) - 1;
+}
+
+
+/* Funções públicas */
+void histogramInit(Histogram* histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+void histogramRecord(Histogram* histogram, uint64_t value) {
+    histogram->counts[bucketOf(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+void histogramRecordShared(Histogram* histogram, uint64_t value) {
+    __atomic_add_fetch(&histogram->counts[bucketOf(value)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&histogram->sum, value, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while (value > max &&
+           !__atomic_compare_exchange_n(&histogram->max, &max, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void histogramRecordCorrected(Histogram* histogram, uint64_t value, uint64_t interval) {
+    histogramRecord(histogram, value);
+    if (interval == 0) {
+        return;
+    }
+    for (uint64_t missing = value; missing > interval; ) {
+        missing -= interval;
+        histogramRecord(histogram, missing);
+    }
+}
+
+void histogramMerge(Histogram* into, const Histogram* from) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        into->counts[i] += __atomic_load_n(&from->counts[i], __ATOMIC_RELAXED);
+    }
+    into->count += __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+    into->sum += __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+    if (max > into->max) {
+        into->max = max;
+    }
+}
+
+uint64_t histogramPercentile(const Histogram* histogram, double p) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    // Posição do percentil entre os valores em ordem, contando de 1
+    uint64_t rank = (uint64_t)(p / 100.0 * histogram->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > histogram->count) {
+        rank = histogram->count;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            uint64_t highest = bucketHighest(i);
+            return highest < histogram->max ? highest : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double histogramMean(const Histogram* histogram) {
+    return histogram->count > 0 ? (double)histogram->sum / histogram->count : 0;
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+ * Histograma de latências no estilo HDR, com erro relativo limitado.
+ * - Valores até 2^HISTOGRAM_SUB_BITS são contados exatamente. Acima disso,
+ *   cada potência de 2 é dividida em 2^(HISTOGRAM_SUB_BITS - 1) faixas
+ *   iguais: um valor é contado na sua faixa e os percentis saem com erro
+ *   menor que 1/2^(HISTOGRAM_SUB_BITS - 1) (1,6%), de 1 a 2^40 - 1.
+ * - O tamanho é fixo (sem alocação) e registrar é um índice calculado com
+ *   um clz: cabe no caminho de cada requisição. histogramRecord não é
+ *   atômica; histogramRecordShared pode ser chamada por várias threads.
+ * - Correção de omissão coordenada: histogramRecordCorrected completa as
+ *   amostras que um gerador em laço fechado deixou de enviar enquanto
+ *   esperava uma resposta lenta.
+ ******************************************************************************/
+
+#ifndef HISTOGRAMA_H
+#define HISTOGRAMA_H
+
+
+#include <stdint.h>
+
+
+#define HISTOGRAM_SUB_BITS 7            // Faixas exatas: 2^7 valores
+#define HISTOGRAM_MAX_BITS 40           // Maior valor contado: 2^40 - 1
+#define HISTOGRAM_BUCKETS ((1 << HISTOGRAM_SUB_BITS) + \
+                           (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS) * (1 << (HISTOGRAM_SUB_BITS - 1)))
+
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t count;         // Valores registrados
+    uint64_t sum;           // Soma dos valores, para a média
+    uint64_t max;
+} Histogram;
+
+
+/* Zera o histograma */
+void histogramInit(Histogram* histogram);
+
+/* Registra um valor (valores acima do limite contam como o limite) */
+void histogramRecord(Histogram* histogram, uint64_t value);
+
+/* Registra um valor em um histograma usado por várias threads */
+void histogramRecordShared(Histogram* histogram, uint64_t value);
+
+/* Registra um valor medido em laço fechado com intervalo esperado entre
+ * requisições: se value passou do intervalo, registra também value -
+ * interval, value - 2 * interval, ..., as latências que as requisições não
+ * enviadas durante a espera teriam visto */
+void histogramRecordCorrected(Histogram* histogram, uint64_t value, uint64_t interval);
+
+/* Soma os valores de from em into */
+void histogramMerge(Histogram* into, const Histogram* from);
+
+/* Valor do percentil p (0 a 100): o maior valor da faixa em que ele cai,
+ * limitado ao máximo registrado (0 se vazio) */
+uint64_t histogramPercentile(const Histogram* histogram, double p);
+
+/* Média dos valores registrados (0 se vazio) */
+double histogramMean(const Histogram* histogram);
+
+
+#endif
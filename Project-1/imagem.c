@@ -0,0 +1,303 @@
+/******************************************************************************
+ * Implementação do arquivo de imagem binária (ver imagem.h).
+ ******************************************************************************/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "imagem.h"
+
+
+#define IMAGE_MAGIC "MC833IMG"          // Primeiros bytes do arquivo
+#define IMAGE_BYTE_ORDER 0x01020304u    // Lido ao contrário em outra ordem de bytes
+#define ZERO_BLOCK 4096                 // Bytes zerados gravados por vez
+
+
+/* Cabeçalho no início do arquivo */
+typedef struct {
+    char magic[8];
+    uint32_t format;        // IMAGE_VERSION
+    uint32_t byteOrder;     // IMAGE_BYTE_ORDER na ordem de quem gravou
+    uint32_t version;       // Versão do conteúdo, de quem usa a imagem
+    uint32_t sectionCount;
+    uint32_t headerCrc;     // CRC-32C do cabeçalho com este campo zerado
+    uint32_t reserved;
+    ImageSection sections[IMAGE_MAX_SECTIONS];
+} ImageHeader;
+
+struct ImageWriter {
+    FILE* file;
+    char* path;             // Caminho final da imagem
+    char* tempPath;         // Arquivo gravado até o commit
+    uint64_t offset;        // Bytes gravados no arquivo
+    ImageHeader header;
+    int failed;             // Alguma gravação falhou
+};
+
+
+/* CRC-32C (polinômio de Castagnoli refletido, 0x82F63B78). Com SSE4.2 usa
+ * a instrução crc32, que processa 8 bytes por vez: conferir a imagem
+ * inteira na inicialização custa pouco perto de lê-la do disco. */
+static uint32_t crcTable[256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+static int crcHardware = 0;
+
+static void buildCrcTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+        }
+        crcTable[i] = crc;
+    }
+#if defined(__x86_64__)
+    crcHardware = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crcUpdateHardware(uint32_t crc, const unsigned char* bytes, size_t length) {
+    uint64_t wide = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        wide = __builtin_ia32_crc32di(wide, word);
+        bytes += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)wide;
+    while (length > 0) {
+        crc = __builtin_ia32_crc32qi(crc, *bytes++);
+        length--;
+    }
+    return crc;
+}
+#endif
+
+/* Continua o cálculo de um CRC-32C (comece com crc = 0) */
+static uint32_t crcUpdate(uint32_t crc, const void* data, size_t length) {
+    pthread_once(&crcTableOnce, buildCrcTable);
+    const unsigned char* bytes = data;
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (crcHardware) {
+        return ~crcUpdateHardware(crc, bytes, length);
+    }
+#endif
+    for (size_t i = 0; i < length; i++) {
+        crc = crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* CRC do cabeçalho, calculado com o campo do próprio CRC zerado */
+static uint32_t headerCrc(const ImageHeader* header) {
+    ImageHeader copy = *header;
+    copy.headerCrc = 0;
+    return crcUpdate(0, &copy, sizeof(copy));
+}
+
+/* Grava bytes no arquivo, sem contar para nenhuma seção */
+static int writeRaw(ImageWriter* writer, const void* data, size_t length) {
+    if (writer->failed || fwrite(data, 1, length, writer->file) != length) {
+        writer->failed = 1;
+        return -1;
+    }
+    writer->offset += length;
+    return 0;
+}
+
+/* Grava zeros até o arquivo chegar a um múltiplo de IMAGE_ALIGN */
+static int padToAlignment(ImageWriter* writer) {
+    static const char zeros[IMAGE_ALIGN];
+    size_t padding = (IMAGE_ALIGN - writer->offset % IMAGE_ALIGN) % IMAGE_ALIGN;
+    return writeRaw(writer, zeros, padding);
+}
+
+/* Libera a memória de quem grava (o arquivo já deve estar fechado) */
+static void freeWriter(ImageWriter* writer) {
+    free(writer->path);
+    free(writer->tempPath);
+    free(writer);
+}
+
+
+/* Funções públicas */
+ImageWriter* imageCreate(const char* path, uint32_t version) {
+    ImageWriter* writer = calloc(1, sizeof(ImageWriter));
+    if (writer == NULL) {
+        return NULL;
+    }
+    size_t length = strlen(path);
+    writer->path = strdup(path);
+    writer->tempPath = malloc(length + sizeof(".tmp"));
+    if (writer->path == NULL || writer->tempPath == NULL) {
+        freeWriter(writer);
+        return NULL;
+    }
+    snprintf(writer->tempPath, length + sizeof(".tmp"), "%s.tmp", path);
+    writer->file = fopen(writer->tempPath, "w");
+    if (writer->file == NULL) {
+        freeWriter(writer);
+        return NULL;
+    }
+
+    memcpy(writer->header.magic, IMAGE_MAGIC, sizeof(writer->header.magic));
+    writer->header.format = IMAGE_VERSION;
+    writer->header.byteOrder = IMAGE_BYTE_ORDER;
+    writer->header.version = version;
+
+    // O cabeçalho só é gravado no commit; até lá o espaço fica zerado
+    if (padToAlignment(writer) < 0 || imageWriteZeros(writer, IMAGE_ALIGN) < 0) {
+        imageAbort(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int imageBeginSection(ImageWriter* writer, uint32_t type) {
+    ImageHeader* header = &writer->header;
+    if (header->sectionCount == IMAGE_MAX_SECTIONS || padToAlignment(writer) < 0) {
+        writer->failed = 1;
+        return -1;
+    }
+    ImageSection* section = &header->sections[header->sectionCount++];
+    section->type = type;
+    section->crc = 0;
+    section->offset = writer->offset;
+    section->length = 0;
+    return 0;
+}
+
+int imageWrite(ImageWriter* writer, const void* data, size_t length) {
+    if (writeRaw(writer, data, length) < 0) {
+        return -1;
+    }
+    if (writer->header.sectionCount > 0) {
+        ImageSection* section = &writer->header.sections[writer->header.sectionCount - 1];
+        section->crc = crcUpdate(section->crc, data, length);
+        section->length += length;
+    }
+    return 0;
+}
+
+int imageWriteZeros(ImageWriter* writer, size_t length) {
+    static const char zeros[ZERO_BLOCK];
+    while (length > 0) {
+        size_t block = length < ZERO_BLOCK ? length : ZERO_BLOCK;
+        if (imageWrite(writer, zeros, block) < 0) {
+            return -1;
+        }
+        length -= block;
+    }
+    return 0;
+}
+
+uint64_t imageSectionLength(const ImageWriter* writer) {
+    if (writer->header.sectionCount == 0) {
+        return 0;
+    }
+    return writer->header.sections[writer->header.sectionCount - 1].length;
+}
+
+int imageCommit(ImageWriter* writer) {
+    ImageHeader* header = &writer->header;
+    header->headerCrc = headerCrc(header);
+    int failed = writer->failed || padToAlignment(writer) < 0 ||
+                 fseek(writer->file, 0, SEEK_SET) != 0 ||
+                 fwrite(header, sizeof(*header), 1, writer->file) != 1 ||
+                 fflush(writer->file) != 0 || fsync(fileno(writer->file)) < 0;
+    if (fclose(writer->file) != 0) {
+        failed = 1;
+    }
+    if (failed || rename(writer->tempPath, writer->path) < 0) {
+        unlink(writer->tempPath);
+        freeWriter(writer);
+        return -1;
+    }
+    freeWriter(writer);
+    return 0;
+}
+
+void imageAbort(ImageWriter* writer) {
+    fclose(writer->file);
+    unlink(writer->tempPath);
+    freeWriter(writer);
+}
+
+int imageOpen(MappedImage* image, const char* path) {
+    memset(image, 0, sizeof(*image));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        return -1;
+    }
+    if ((size_t)info.st_size < sizeof(ImageHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // MAP_PRIVATE: as escritas de quem usa a imagem nunca chegam ao arquivo
+    size_t size = (size_t)info.st_size;
+    char* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    madvise(base, size, MADV_WILLNEED);
+
+    ImageHeader header;
+    memcpy(&header, base, sizeof(header));
+    int valid = memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) == 0 &&
+                header.format == IMAGE_VERSION && header.byteOrder == IMAGE_BYTE_ORDER &&
+                header.sectionCount <= IMAGE_MAX_SECTIONS && header.headerCrc == headerCrc(&header);
+    for (uint32_t i = 0; valid && i < header.sectionCount; i++) {
+        const ImageSection* section = &header.sections[i];
+        valid = section->offset % IMAGE_ALIGN == 0 && section->offset <= size &&
+                section->length <= size - section->offset &&
+                crcUpdate(0, base + section->offset, section->length) == section->crc;
+    }
+    if (!valid) {
+        munmap(base, size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    image->base = base;
+    image->size = size;
+    image->version = header.version;
+    image->sectionCount = (int)header.sectionCount;
+    memcpy(image->sections, header.sections, sizeof(ImageSection) * header.sectionCount);
+    return 0;
+}
+
+void* imageSection(const MappedImage* image, uint32_t type, size_t* length) {
+    for (int i = 0; i < image->sectionCount; i++) {
+        if (image->sections[i].type == type) {
+            *length = image->sections[i].length;
+            return image->base + image->sections[i].offset;
+        }
+    }
+    return NULL;
+}
+
+void imageClose(MappedImage* image) {
+    if (image->base != NULL) {
+        munmap(image->base, image->size);
+    }
+    memset(image, 0, sizeof(*image));
+}
@@ -0,0 +1,88 @@
+/******************************************************************************
+ * Arquivo de imagem binária, mapeado em memória e usado sem conversão.
+ * - O arquivo tem um cabeçalho (magic, versão, marca da ordem de bytes e
+ *   tabela de seções) e seções identificadas por um tipo inteiro, cada uma
+ *   começando em um múltiplo de IMAGE_ALIGN bytes. Quem grava decide o
+ *   conteúdo das seções, na representação da própria máquina.
+ * - Cada seção tem seu CRC-32C, e o cabeçalho tem o seu. imageOpen confere
+ *   tudo antes de devolver a imagem: um arquivo truncado, corrompido, de
+ *   outra versão ou de outra ordem de bytes é recusado.
+ * - A gravação vai para um arquivo temporário ao lado, que é sincronizado
+ *   e renomeado por cima do antigo em imageCommit: uma queda no meio não
+ *   deixa uma imagem pela metade.
+ * - A leitura mapeia o arquivo com MAP_PRIVATE e escrita: quem usa a
+ *   imagem pode alterar suas páginas, que o kernel copia na primeira
+ *   escrita sem tocar no arquivo.
+ ******************************************************************************/
+
+#ifndef IMAGEM_H
+#define IMAGEM_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define IMAGE_VERSION 1                 // Versão do formato do arquivo
+#define IMAGE_ALIGN 4096                // Alinhamento de cada seção no arquivo
+#define IMAGE_MAX_SECTIONS 16           // Seções de uma imagem
+
+
+/* Seção da imagem */
+typedef struct {
+    uint32_t type;      // Tipo, definido por quem usa a imagem
+    uint32_t crc;       // CRC-32C dos bytes da seção
+    uint64_t offset;    // Início no arquivo (múltiplo de IMAGE_ALIGN)
+    uint64_t length;    // Bytes da seção
+} ImageSection;
+
+/* Imagem aberta para leitura */
+typedef struct {
+    char* base;                 // Arquivo mapeado
+    size_t size;
+    uint32_t version;           // Versão de quem usa a imagem
+    int sectionCount;
+    ImageSection sections[IMAGE_MAX_SECTIONS];
+} MappedImage;
+
+typedef struct ImageWriter ImageWriter;
+
+
+/* Começa a gravar uma imagem em path, com a versão do conteúdo dada por
+ * quem a usa (retorna NULL em caso de erro) */
+ImageWriter* imageCreate(const char* path, uint32_t version);
+
+/* Começa uma seção nova do tipo dado, encerrando a anterior (retorna -1 em
+ * caso de erro ou se já houver IMAGE_MAX_SECTIONS seções) */
+int imageBeginSection(ImageWriter* writer, uint32_t type);
+
+/* Acrescenta bytes à seção atual (retorna -1 em caso de erro) */
+int imageWrite(ImageWriter* writer, const void* data, size_t length);
+
+/* Acrescenta length bytes zerados à seção atual (retorna -1 em caso de
+ * erro) */
+int imageWriteZeros(ImageWriter* writer, size_t length);
+
+/* Bytes já gravados na seção atual */
+uint64_t imageSectionLength(const ImageWriter* writer);
+
+/* Encerra a última seção, grava o cabeçalho, sincroniza e coloca a imagem
+ * no lugar da anterior. Libera writer. (retorna -1 em caso de erro) */
+int imageCommit(ImageWriter* writer);
+
+/* Descarta uma gravação não concluída e libera writer */
+void imageAbort(ImageWriter* writer);
+
+/* Mapeia e confere a imagem em path. Retorna -1 com errno ENOENT se o
+ * arquivo não existe, ou EINVAL se ele não é uma imagem válida. */
+int imageOpen(MappedImage* image, const char* path);
+
+/* Endereço da seção do tipo dado e, em *length, seu tamanho (retorna NULL
+ * se a imagem não tem a seção) */
+void* imageSection(const MappedImage* image, uint32_t type, size_t* length);
+
+/* Desfaz o mapeamento: nada da imagem pode ser usado depois */
+void imageClose(MappedImage* image);
+
+
+#endif
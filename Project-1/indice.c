@@ -0,0 +1,142 @@
+/******************************************************************************
+ * Implementação do índice de hash de IDs (ver indice.h).
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "indice.h"
+
+
+/* Posição inicial de um ID: hash multiplicativo (Fibonacci), que espalha
+ * IDs sequenciais pela tabela */
+static size_t homeSlot(const IdIndex* index, int id) {
+    uint64_t hash = (uint64_t)(uint32_t)id * 0x9E3779B97F4A7C15ull;
+    return (size_t)(hash >> 32) & (index->capacity - 1);
+}
+
+/* Posição da entrada do ID, ou da posição vazia onde ele entraria */
+static size_t probe(const IdIndex* index, int id) {
+    size_t mask = index->capacity - 1;
+    size_t position = homeSlot(index, id);
+    while (index->entries[position].id != 0 && index->entries[position].id != id) {
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+/* Realoca a tabela com a nova capacidade e reinsere as entradas */
+static int resize(IdIndex* index, size_t capacity) {
+    IndexEntry* old = index->entries;
+    size_t oldCapacity = index->capacity;
+
+    IndexEntry* entries = calloc(capacity, sizeof(IndexEntry));
+    if (entries == NULL) {
+        return -1;
+    }
+    index->entries = entries;
+    index->capacity = capacity;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].id != 0) {
+            index->entries[probe(index, old[i].id)] = old[i];
+        }
+    }
+    if (!index->attached) {
+        free(old);
+    }
+    index->attached = 0;
+    return 0;
+}
+
+
+/* Funções públicas */
+int indexInit(IdIndex* index, size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    index->entries = calloc(capacity, sizeof(IndexEntry));
+    index->capacity = index->entries != NULL ? capacity : 0;
+    index->count = 0;
+    index->attached = 0;
+    return index->entries != NULL ? 0 : -1;
+}
+
+int indexReserve(IdIndex* index, size_t expected) {
+    size_t capacity = index->capacity;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    return capacity == index->capacity ? 0 : resize(index, capacity);
+}
+
+int indexFind(const IdIndex* index, int id) {
+    if (id == 0 || index->capacity == 0) {
+        return -1;
+    }
+    const IndexEntry* entry = &index->entries[probe(index, id)];
+    return entry->id == id ? entry->slot : -1;
+}
+
+int indexPut(IdIndex* index, int id, int slot) {
+    if (id == 0) {
+        return -1;
+    }
+    // Mantém a tabela no máximo metade cheia
+    if ((index->count + 1) * 2 > index->capacity &&
+        resize(index, index->capacity > 0 ? index->capacity * 2 : 16) < 0) {
+        return -1;
+    }
+
+    IndexEntry* entry = &index->entries[probe(index, id)];
+    if (entry->id == 0) {
+        entry->id = id;
+        index->count++;
+    }
+    entry->slot = slot;
+    return 0;
+}
+
+void indexRemove(IdIndex* index, int id) {
+    if (id == 0 || index->capacity == 0) {
+        return;
+    }
+    size_t mask = index->capacity - 1;
+    size_t hole = probe(index, id);
+    if (index->entries[hole].id != id) {
+        return;
+    }
+
+    // Desloca para trás as entradas seguintes que podem ocupar o buraco
+    // (as que não estão entre o buraco e sua posição inicial)
+    size_t next = (hole + 1) & mask;
+    while (index->entries[next].id != 0) {
+        size_t home = homeSlot(index, index->entries[next].id);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->entries[hole] = index->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->entries[hole].id = 0;
+    index->count--;
+}
+
+void indexAttach(IdIndex* index, IndexEntry* entries, size_t capacity, size_t count) {
+    indexFree(index);
+    index->entries = entries;
+    index->capacity = capacity;
+    index->count = count;
+    index->attached = 1;
+}
+
+void indexFree(IdIndex* index) {
+    if (!index->attached) {
+        free(index->entries);
+    }
+    index->attached = 0;
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
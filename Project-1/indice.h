@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Índice de hash de ID de filme para posição no array de filmes.
+ * - Endereçamento aberto com sondagem linear: as entradas ficam em um único
+ *   vetor, sem nós alocados por inserção, e uma busca costuma tocar uma
+ *   única linha de cache.
+ * - Remoção por deslocamento para trás (backward shift): as entradas
+ *   seguintes do mesmo agrupamento voltam uma posição, então o índice não
+ *   acumula marcas de remoção e as buscas não degradam com o tempo.
+ * - A tabela dobra quando passa de metade cheia.
+ * - A tabela pode vir pronta de uma imagem em memória externa (indexAttach),
+ *   como um arquivo mapeado, e é usada onde está até precisar crescer.
+ ******************************************************************************/
+
+#ifndef INDICE_H
+#define INDICE_H
+
+
+#include <stddef.h>
+
+
+/* Entrada do índice (id 0 marca posição vazia; IDs de filme começam em 1) */
+typedef struct {
+    int id;
+    int slot;   // Posição do filme no array
+} IndexEntry;
+
+typedef struct {
+    IndexEntry* entries;
+    size_t capacity;    // Potência de 2
+    size_t count;
+    int attached;       // entries é de uma imagem externa (não é liberada)
+} IdIndex;
+
+
+/* Inicializa o índice com espaço para ao menos expected IDs (retorna -1 se
+ * faltar memória) */
+int indexInit(IdIndex* index, size_t expected);
+
+/* Cresce a tabela de uma vez para ao menos expected IDs, evitando as
+ * realocações intermediárias de uma carga grande (retorna -1 se faltar
+ * memória) */
+int indexReserve(IdIndex* index, size_t expected);
+
+/* Posição do filme com o ID dado (-1 se não estiver no índice) */
+int indexFind(const IdIndex* index, int id);
+
+/* Insere o ID ou atualiza sua posição (retorna -1 se faltar memória) */
+int indexPut(IdIndex* index, int id, int slot);
+
+/* Remove o ID do índice, se estiver nele */
+void indexRemove(IdIndex* index, int id);
+
+/* Passa a usar como tabela do índice as capacity entradas da imagem, com
+ * count IDs, gravadas de um índice com a mesma função de hash. A imagem
+ * deve continuar mapeada e gravável enquanto o índice a usar; o índice
+ * inicializado antes é liberado. */
+void indexAttach(IdIndex* index, IndexEntry* entries, size_t capacity, size_t count);
+
+/* Libera a memória do índice */
+void indexFree(IdIndex* index);
+
+
+#endif
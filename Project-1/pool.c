@@ -0,0 +1,247 @@
+/******************************************************************************
+ * Implementação do pool de workers com roubo de tarefas (ver pool.h).
+ * - Cada fila é um deque circular protegido por um mutex próprio: o dono
+ *   retira do início (ordem de chegada, para não atrasar requisições
+ *   antigas) e os ladrões retiram do fim, longe do dono.
+ * - Workers sem trabalho dormem em uma variável de condição do pool e só
+ *   são acordados quando há workers ociosos.
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+
+/* Fila de tarefas de um worker (alinhada para não compartilhar linha de
+ * cache com a fila vizinha) */
+typedef struct {
+    pthread_mutex_t lock;
+    Task* tasks;        // Buffer circular de capacity tarefas
+    int head;           // Posição da tarefa mais antiga
+    int count;          // Tarefas na fila (lido sem lock pelos ladrões)
+} __attribute__((aligned(64))) TaskDeque;
+
+/* Argumento de cada thread worker */
+typedef struct {
+    WorkerPool* pool;
+    int index;
+} WorkerArg;
+
+struct WorkerPool {
+    int workerCount;
+    int capacity;               // Capacidade de cada fila
+    TaskDeque* deques;          // Uma fila por worker
+    pthread_t* threads;
+    WorkerArg* args;
+
+    unsigned nextWorker;        // Rodízio de distribuição das tarefas
+    int queued;                 // Tarefas em todas as filas
+    int idle;                   // Workers dormindo
+    int stopping;               // poolDestroy foi chamado
+
+    pthread_mutex_t sleepLock;  // Protege a espera dos workers ociosos
+    pthread_cond_t wakeUp;
+};
+
+
+/* Funções auxiliares internas */
+/* Coloca uma tarefa no fim da fila (retorna -1 se estiver cheia) */
+static int dequePush(TaskDeque* deque, int capacity, Task task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == capacity) {
+        pthread_mutex_unlock(&deque->lock);
+        return -1;
+    }
+    deque->tasks[(deque->head + deque->count) % capacity] = task;
+    __atomic_store_n(&deque->count, deque->count + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+/* Retira a tarefa mais antiga (usado pelo dono da fila) */
+static int dequePopFront(TaskDeque* deque, int capacity, Task* task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == 0) {
+        pthread_mutex_unlock(&deque->lock);
+        return -1;
+    }
+    *task = deque->tasks[deque->head];
+    deque->head = (deque->head + 1) % capacity;
+    __atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+/* Retira a tarefa mais recente (usado pelos ladrões) */
+static int dequePopBack(TaskDeque* deque, int capacity, Task* task) {
+    // Leitura sem lock só para não disputar filas vazias
+    if (__atomic_load_n(&deque->count, __ATOMIC_RELAXED) == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == 0) {
+        pthread_mutex_unlock(&deque->lock);
+        return -1;
+    }
+    __atomic_store_n(&deque->count, deque->count - 1, __ATOMIC_RELAXED);
+    *task = deque->tasks[(deque->head + deque->count) % capacity];
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+/* Busca trabalho na própria fila e, se vazia, rouba das demais */
+static int findTask(WorkerPool* pool, int self, Task* task) {
+    if (dequePopFront(&pool->deques[self], pool->capacity, task) == 0) {
+        return 0;
+    }
+    for (int i = 1; i < pool->workerCount; i++) {
+        int victim = (self + i) % pool->workerCount;
+        if (dequePopBack(&pool->deques[victim], pool->capacity, task) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Laço de cada worker */
+static void* workerLoop(void* arg) {
+    WorkerArg* workerArg = arg;
+    WorkerPool* pool = workerArg->pool;
+    int self = workerArg->index;
+
+    while (1) {
+        Task task;
+        if (findTask(pool, self, &task) == 0) {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+            task.run(task.arg);
+            continue;
+        }
+
+        // Nada a fazer: dorme até alguém submeter uma tarefa. queued é
+        // conferido depois de se declarar ocioso, então nenhum aviso se perde
+        pthread_mutex_lock(&pool->sleepLock);
+        __atomic_add_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 && !pool->stopping) {
+            pthread_cond_wait(&pool->wakeUp, &pool->sleepLock);
+        }
+        __atomic_sub_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+        int done = pool->stopping && __atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0;
+        pthread_mutex_unlock(&pool->sleepLock);
+
+        if (done) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/* Sinaliza o fim aos workers e espera os started primeiros terminarem */
+static void stopWorkers(WorkerPool* pool, int started) {
+    pthread_mutex_lock(&pool->sleepLock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wakeUp);
+    pthread_mutex_unlock(&pool->sleepLock);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+}
+
+/* Libera as filas e o próprio pool (também um pool criado pela metade,
+ * com membros NULL) */
+static void freePool(WorkerPool* pool) {
+    for (int i = 0; pool->deques != NULL && i < pool->workerCount; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->sleepLock);
+    pthread_cond_destroy(&pool->wakeUp);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool->args);
+    free(pool);
+}
+
+
+/* Funções públicas */
+WorkerPool* poolCreate(int workerCount, int queueCapacity) {
+    if (workerCount < 1 || queueCapacity < 1) {
+        return NULL;
+    }
+
+    WorkerPool* pool = calloc(1, sizeof(WorkerPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->workerCount = workerCount;
+    pool->capacity = queueCapacity;
+    pool->deques = aligned_alloc(64, sizeof(TaskDeque) * workerCount);
+    pool->threads = calloc(workerCount, sizeof(pthread_t));
+    pool->args = calloc(workerCount, sizeof(WorkerArg));
+    pthread_mutex_init(&pool->sleepLock, NULL);
+    pthread_cond_init(&pool->wakeUp, NULL);
+
+    int failed = pool->deques == NULL || pool->threads == NULL || pool->args == NULL;
+    for (int i = 0; pool->deques != NULL && i < workerCount; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].tasks = malloc(sizeof(Task) * queueCapacity);
+        pool->deques[i].head = 0;
+        pool->deques[i].count = 0;
+        failed |= pool->deques[i].tasks == NULL;
+    }
+    if (failed) {
+        freePool(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < workerCount; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].index = i;
+        if (pthread_create(&pool->threads[i], NULL, workerLoop, &pool->args[i]) != 0) {
+            // Sem todos os workers o pool não é criado
+            stopWorkers(pool, i);
+            freePool(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+int poolSubmit(WorkerPool* pool, Task task) {
+    // Conta a tarefa antes de publicá-la, para queued nunca ficar negativo
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+    // Tenta a fila da vez e, se cheia, as seguintes
+    unsigned start = __atomic_fetch_add(&pool->nextWorker, 1, __ATOMIC_RELAXED);
+    int pushed = -1;
+    for (int i = 0; i < pool->workerCount && pushed < 0; i++) {
+        TaskDeque* deque = &pool->deques[(start + i) % pool->workerCount];
+        pushed = dequePush(deque, pool->capacity, task);
+    }
+    if (pushed < 0) {
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+        return -1;
+    }
+
+    // Acorda um worker ocioso, se houver
+    if (__atomic_load_n(&pool->idle, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->sleepLock);
+        pthread_cond_signal(&pool->wakeUp);
+        pthread_mutex_unlock(&pool->sleepLock);
+    }
+    return 0;
+}
+
+void poolDestroy(WorkerPool* pool) {
+    stopWorkers(pool, pool->workerCount);
+    freePool(pool);
+}
+
+int poolWorkerCount(const WorkerPool* pool) {
+    return pool->workerCount;
+}
@@ -0,0 +1,38 @@
+/******************************************************************************
+ * Pool fixo de workers com filas por worker e roubo de tarefas
+ * (work stealing).
+ * - Cada worker tem sua própria fila limitada; as tarefas são distribuídas
+ *   em rodízio e um worker sem trabalho rouba tarefas das filas dos outros.
+ * - As filas têm capacidade fixa: quando todas estão cheias, poolSubmit
+ *   recusa a tarefa e quem submeteu decide o que fazer (ex.: executá-la na
+ *   própria thread), o que limita a memória usada sob rajadas.
+ ******************************************************************************/
+
+#ifndef POOL_H
+#define POOL_H
+
+
+/* Tarefa executada por um worker */
+typedef struct {
+    void (*run)(void* arg); // Função a executar
+    void* arg;              // Argumento passado à função
+} Task;
+
+typedef struct WorkerPool WorkerPool;
+
+
+/* Cria o pool com workerCount threads e filas de queueCapacity tarefas
+ * (retorna NULL em caso de erro) */
+WorkerPool* poolCreate(int workerCount, int queueCapacity);
+
+/* Submete uma tarefa (retorna -1 se todas as filas estiverem cheias) */
+int poolSubmit(WorkerPool* pool, Task task);
+
+/* Espera os workers terminarem as tarefas em fila e libera o pool */
+void poolDestroy(WorkerPool* pool);
+
+/* Quantidade de workers do pool */
+int poolWorkerCount(const WorkerPool* pool);
+
+
+#endif
@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Implementação do protocolo binário de frames (ver protocolo.h).
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "protocolo.h"
+
+
+/* Codificação de frames */
+void encodeFrameHeader(char* out, int opcode, uint16_t flags, uint32_t requestId, uint32_t length) {
+    uint16_t netFlags = htons(flags);
+    uint32_t netId = htonl(requestId);
+    uint32_t netLength = htonl(length);
+
+    out[0] = PROTOCOL_VERSION;
+    out[1] = (char)opcode;
+    memcpy(out + 2, &netFlags, sizeof(netFlags));
+    memcpy(out + 4, &netId, sizeof(netId));
+    memcpy(out + 8, &netLength, sizeof(netLength));
+}
+
+void decodeFrameHeader(const char* in, FrameHeader* header) {
+    uint16_t netFlags;
+    uint32_t netId;
+    uint32_t netLength;
+    memcpy(&netFlags, in + 2, sizeof(netFlags));
+    memcpy(&netId, in + 4, sizeof(netId));
+    memcpy(&netLength, in + 8, sizeof(netLength));
+
+    header->version = (uint8_t)in[0];
+    header->opcode = (uint8_t)in[1];
+    header->flags = ntohs(netFlags);
+    header->requestId = ntohl(netId);
+    header->length = ntohl(netLength);
+}
+
+size_t encodeRequest(char* out, size_t capacity, int opcode, uint32_t requestId,
+                     const char* const* fields, int fieldCount) {
+    size_t offset = FRAME_HEADER_SIZE;
+    for (int i = 0; i < fieldCount; i++) {
+        size_t fieldLength = strlen(fields[i]);
+        if (fieldLength > UINT16_MAX || offset + 2 + fieldLength > capacity) {
+            return 0;
+        }
+
+        // Cada campo: 2 bytes de tamanho seguidos dos bytes do campo
+        uint16_t netLength = htons((uint16_t)fieldLength);
+        memcpy(out + offset, &netLength, sizeof(netLength));
+        memcpy(out + offset + 2, fields[i], fieldLength);
+        offset += 2 + fieldLength;
+    }
+
+    if (offset - FRAME_HEADER_SIZE > FRAME_MAX_REQUEST) {
+        return 0;
+    }
+    encodeFrameHeader(out, opcode, 0, requestId, (uint32_t)(offset - FRAME_HEADER_SIZE));
+    return offset;
+}
+
+int decodeFields(const char* payload, uint32_t length, FrameField* fields, int maxFields) {
+    uint32_t offset = 0;
+    int count = 0;
+
+    while (offset < length) {
+        if (count == maxFields || length - offset < 2) {
+            return -1;
+        }
+
+        uint16_t netLength;
+        memcpy(&netLength, payload + offset, sizeof(netLength));
+        uint16_t fieldLength = ntohs(netLength);
+        offset += 2;
+        if (fieldLength > length - offset) {
+            return -1;
+        }
+
+        fields[count].data = payload + offset;
+        fields[count].length = fieldLength;
+        count++;
+        offset += fieldLength;
+    }
+
+    return count;
+}
+
+
+/* Parser incremental */
+void frameParserInit(FrameParser* parser) {
+    memset(parser, 0, sizeof(*parser));
+    parser->maxLength = FRAME_MAX_REQUEST;
+}
+
+int frameParserFeed(FrameParser* parser, const char* data, size_t length) {
+    // Descarta os frames já consumidos antes de acrescentar mais bytes
+    if (parser->consumed > 0) {
+        memmove(parser->buffer, parser->buffer + parser->consumed, parser->length - parser->consumed);
+        parser->length -= parser->consumed;
+        parser->consumed = 0;
+    }
+
+    if (parser->length + length > parser->capacity) {
+        size_t capacity = parser->capacity > 0 ? parser->capacity : 1024;
+        while (capacity < parser->length + length) {
+            capacity *= 2;
+        }
+        char* buffer = realloc(parser->buffer, capacity);
+        if (buffer == NULL) {
+            return -1;
+        }
+        parser->buffer = buffer;
+        parser->capacity = capacity;
+    }
+
+    memcpy(parser->buffer + parser->length, data, length);
+    parser->length += length;
+    return 0;
+}
+
+FrameStatus frameParserNext(FrameParser* parser, FrameHeader* header, const char** payload) {
+    size_t available = parser->length - parser->consumed;
+
+    if (available == 0 && parser->capacity > 0) {
+        // Tudo consumido: conexões ociosas não mantêm buffer alocado
+        frameParserFree(parser);
+        return FRAME_INCOMPLETE;
+    }
+    if (available < FRAME_HEADER_SIZE) {
+        return FRAME_INCOMPLETE;
+    }
+
+    // A versão fica no primeiro byte em todas as versões do protocolo
+    const char* frame = parser->buffer + parser->consumed;
+    if ((uint8_t)frame[0] != PROTOCOL_VERSION) {
+        return FRAME_INVALID;
+    }
+    decodeFrameHeader(frame, header);
+    if (header->length > parser->maxLength) {
+        return FRAME_INVALID;
+    }
+    if (available < FRAME_HEADER_SIZE + header->length) {
+        return FRAME_INCOMPLETE;
+    }
+
+    *payload = frame + FRAME_HEADER_SIZE;
+    parser->consumed += FRAME_HEADER_SIZE + header->length;
+    return FRAME_READY;
+}
+
+void frameParserFree(FrameParser* parser) {
+    uint32_t maxLength = parser->maxLength;
+    free(parser->buffer);
+    frameParserInit(parser);
+    parser->maxLength = maxLength;
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+ * Protocolo binário entre cliente e servidor de filmes.
+ * - Cada requisição e cada resposta é um único frame:
+ *      cabeçalho (12 bytes, inteiros em ordem de rede)
+ *          versão   (1 byte)  - PROTOCOL_VERSION
+ *          opcode   (1 byte)  - opção do menu (0 a 8)
+ *          flags    (2 bytes) - FRAME_FLAG_MORE ou zero
+ *          ID       (4 bytes) - escolhido pelo cliente, repetido na resposta
+ *          tamanho  (4 bytes) - bytes de payload após o cabeçalho
+ *      payload
+ *          requisição: campos, cada um com 2 bytes de tamanho + bytes
+ *          resposta:   texto da resposta
+ * - Como o tamanho vem no cabeçalho, o receptor monta o frame mesmo que o
+ *   TCP junte ou divida segmentos, e uma requisição sai em um único send().
+ * - Pipelining: o cliente pode enviar várias requisições seguidas sem
+ *   esperar respostas. O servidor pode respondê-las fora de ordem, conforme
+ *   cada uma termina; o ID da resposta diz a qual requisição ela pertence.
+ * - Respostas longas (listagens) são enviadas em vários frames com o mesmo
+ *   ID, cada um com parte do texto; todos menos o último levam
+ *   FRAME_FLAG_MORE. O receptor concatena os textos até o frame sem a flag.
+ *   Assim o servidor não precisa montar a listagem inteira antes de enviar.
+ * - Versões: 1 (cabeçalho de 8 bytes, sem ID) e 2 (atual).
+ ******************************************************************************/
+
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define PROTOCOL_VERSION 2              // Versão atual do formato de frame
+#define FRAME_HEADER_SIZE 12            // Tamanho do cabeçalho de frame
+#define FRAME_MAX_REQUEST 65536         // Maior payload de requisição aceito
+#define FRAME_MAX_FIELDS 4              // Máximo de campos em uma requisição
+
+#define FRAME_FLAG_MORE 0x0001          // A resposta continua no próximo frame com o mesmo ID
+
+
+/* Cabeçalho de frame decodificado */
+typedef struct {
+    uint8_t version;
+    uint8_t opcode;
+    uint16_t flags;
+    uint32_t requestId; // ID da requisição (o mesmo na resposta)
+    uint32_t length;    // Tamanho do payload
+} FrameHeader;
+
+/* Campo de uma requisição, apontando para dentro do payload */
+typedef struct {
+    const char* data;
+    uint16_t length;
+} FrameField;
+
+/* Acumula bytes recebidos até formar frames completos (parser incremental
+ * que trata leituras parciais e frames grudados) */
+typedef struct {
+    char* buffer;       // Bytes recebidos e ainda não consumidos
+    size_t length;      // Bytes válidos em buffer
+    size_t capacity;    // Capacidade alocada de buffer
+    size_t consumed;    // Início do próximo frame em buffer
+    uint32_t maxLength; // Maior payload aceito
+} FrameParser;
+
+/* Resultado de frameParserNext */
+typedef enum {
+    FRAME_INCOMPLETE,   // Faltam bytes para o próximo frame
+    FRAME_READY,        // Frame completo disponível
+    FRAME_INVALID       // Versão desconhecida ou tamanho acima do limite
+} FrameStatus;
+
+
+/* Escreve o cabeçalho de frame em out (FRAME_HEADER_SIZE bytes) */
+void encodeFrameHeader(char* out, int opcode, uint16_t flags, uint32_t requestId, uint32_t length);
+
+/* Lê o cabeçalho de frame em in */
+void decodeFrameHeader(const char* in, FrameHeader* header);
+
+/* Monta um frame de requisição com os campos dados em out (retorna o tamanho
+ * do frame ou 0 se não couber em capacity) */
+size_t encodeRequest(char* out, size_t capacity, int opcode, uint32_t requestId,
+                     const char* const* fields, int fieldCount);
+
+/* Separa os campos do payload de uma requisição (retorna a quantidade de
+ * campos ou -1 se o payload estiver malformado) */
+int decodeFields(const char* payload, uint32_t length, FrameField* fields, int maxFields);
+
+/* Inicializa o parser (sem alocar memória), aceitando payloads de até
+ * FRAME_MAX_REQUEST bytes; quem recebe respostas pode aumentar maxLength */
+void frameParserInit(FrameParser* parser);
+
+/* Acrescenta bytes recebidos ao parser (retorna -1 se faltar memória) */
+int frameParserFeed(FrameParser* parser, const char* data, size_t length);
+
+/* Obtém o próximo frame completo. Em FRAME_READY, header e payload ficam
+ * válidos até a próxima chamada de frameParserFeed ou frameParserNext. */
+FrameStatus frameParserNext(FrameParser* parser, FrameHeader* header, const char** payload);
+
+/* Libera a memória do parser (mantém maxLength) */
+void frameParserFree(FrameParser* parser);
+
+
+#endif
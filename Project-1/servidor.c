@@ -1,8 +1,93 @@
 /******************************************************************************
  * Implementação de servidor TCP concorrente para gerenciamento de dados de
  * filmes.
- * - Usa threads para lidar com múltiplos clientes simultâneos.
- * - Armazena dados em um arquivo CSV.
+ * - Modos de atendimento de clientes, escolhidos na inicialização:
+ *      - epoll (padrão): poucas threads de eventos multiplexando todos os
+ *        sockets (epoll edge-triggered), com um parser incremental por
+ *        conexão; as requisições montadas são executadas por um pool fixo de
+ *        workers com roubo de tarefas (pool.c);
+ *      - uring: io_uring com accept e recv multishot, buffers fornecidos ao
+ *        kernel e sends ligados submetidos em lote (usa epoll se o kernel
+ *        não suportar);
+ *      - threads: uma thread por cliente, com recv() bloqueante.
+ * - Com -a N, abre N sockets de escuta SO_REUSEPORT na mesma porta, cada um
+ *   atendido por threads fixadas em uma CPU; -c adiciona SO_INCOMING_CPU
+ *   para manter cada conexão na CPU que recebe seu tráfego. -b define o
+ *   backlog de cada socket (padrão SOMAXCONN).
+ * - Os filmes ficam em um vetor segmentado (armazem.c): páginas de tamanho
+ *   fixo alocadas conforme o catálogo cresce, sem limite baixo de filmes e
+ *   sem mover os já cadastrados. Cada filme ocupa 32 bytes (ID, ano,
+ *   máscara de gêneros e posição das strings); título, diretor e gêneros
+ *   ficam em uma arena só de acréscimos (arena.c), então percorrer o
+ *   catálogo lê poucas linhas de cache.
+ * - Filmes são localizados pelo ID por um índice de hash (indice.c), mantido
+ *   junto com o array; IDs novos vêm de um contador que só cresce, então o
+ *   ID de um filme removido nunca é reutilizado.
+ * - Gêneros são internados em IDs inteiros e cada um guarda um bitmap
+ *   compactado (bitmap.c) com os IDs dos seus filmes (generos.c). A busca
+ *   por gênero compara o gênero inteiro e aceita combinações: "a&b" (filmes
+ *   com os dois) e "a|b" (com qualquer um), com '&' antes de '|'.
+ * - Persistência: cada mutação é anexada a um log de escrita antecipada
+ *   (wal.c) com CRC por registro, em vez de reescrever todo o catálogo. O
+ *   snapshot é uma imagem binária (imagem.c) com registros, strings e
+ *   índices no formato da memória, conferidos por CRC-32C: na
+ *   inicialização ela é mapeada e usada sem conversão (só os bitmaps são
+ *   copiados) e o log é reaplicado; uma thread de compactação grava
+ *   periodicamente uma imagem nova e descarta o log já incorporado. O CSV
+ *   só é importado se ainda não houver imagem, e -x exporta o catálogo
+ *   para CSV; a leitura e a escrita (csv.c) seguem a RFC 4180, com aspas
+ *   nos campos que têm vírgula. A importação divide o arquivo em partes
+ *   lidas em paralelo, uma thread por CPU.
+ * - Commit em grupo: uma thread grava e sincroniza (fdatasync) os registros
+ *   do log em lotes, e cada escrita só é respondida depois que seu lote
+ *   chega ao disco (no modo epoll, sem bloquear o worker: a resposta é
+ *   enviada pela própria thread de gravação; no modo io_uring, sem
+ *   bloquear o anel: a thread de gravação devolve a resposta à thread do
+ *   anel por um eventfd). -g define a janela de um lote em microssegundos (padrão
+ *   0: grava assim que o fsync anterior termina) e -G o limite de bytes que
+ *   fecha o lote antes da janela. Se a gravação de um lote falhar, o
+ *   servidor encerra: as escritas dele já estão na memória, mas não no
+ *   disco.
+ * - O catálogo é protegido por um lock de leitura e escrita com preferência
+ *   às escritas: listagens e consultas executam em paralelo entre si, e
+ *   cadastro, alteração e remoção executam sozinhos. As listagens completas
+ *   e a compactação só usam o lock para fixar um snapshot do catálogo
+ *   (páginas compartilhadas, copiadas na escrita) e o percorrem sem lock;
+ *   cada versão antiga de uma página é liberada com o último snapshot que a
+ *   usa.
+ * - Requisições e respostas trafegam em frames binários com tamanho no
+ *   cabeçalho (protocolo.h), montados por um parser incremental que trata
+ *   leituras parciais.
+ * - Cada frame leva um ID de requisição, repetido na resposta. O cliente pode
+ *   enviar várias requisições sem esperar; no modo epoll com workers elas
+ *   executam em paralelo e as respostas saem conforme terminam, fora de ordem.
+ * - As listagens (4, 5 e 7) não têm tamanho limitado: são geradas em partes
+ *   de cerca de 64 KiB, cada uma em um frame com FRAME_FLAG_MORE exceto a
+ *   última, e só avançam enquanto a saída pendente da conexão está abaixo
+ *   de um limite. A saída de cada conexão é uma fila de blocos enviada com
+ *   sendmsg (vários blocos por chamada), sem recopiar o que ficou pendente.
+ * - Paginação: as listagens aceitam tamanho de página e cursor opcionais
+ *   (depois do gênero, na opção 7). Uma página lista os filmes em ordem de
+ *   ID a partir do seguinte ao cursor e termina com "Próximo cursor: N" se
+ *   houver mais; como o cursor é um ID, remoções entre páginas não fazem
+ *   filmes serem pulados ou repetidos.
+ * - Cache de respostas (cache.c): as listagens completas e as consultas
+ *   por ID ficam guardadas já renderizadas e são enviadas por referência,
+ *   sem tomar o lock do catálogo. Um cadastro acrescenta a linha do filme
+ *   às listagens em cache; alteração e remoção descartam as entradas
+ *   afetadas.
+ * - Trechos grandes das respostas do cache são enviados sem cópia: com
+ *   MSG_ZEROCOPY no modo epoll e IORING_OP_SEND_ZC no modo io_uring. O
+ *   kernel lê os bytes direto do texto do cache, cuja referência só é
+ *   devolvida quando chega a notificação de que o envio terminou. -z
+ *   desativa.
+ * - Estatísticas (estatisticas.c): por opção, requisições, erros, bytes
+ *   recebidos e enviados e histogramas de latência da fila, da espera pelo
+ *   lock do catálogo e da execução; para cada operação que toma o lock do
+ *   catálogo (inclusive a compactação), histogramas da espera e do tempo
+ *   com o lock, e quanto as outras esperaram enquanto ela tinha o lock de
+ *   escrita. São consultadas pela opção 8 e impressas quando o servidor
+ *   recebe SIGUSR1.
  * - Operações:
  *      - cadastrar um novo filme;
  *      - adicionar um novo genêro a um filme;
@@ -10,589 +95,4016 @@
  *      - listar todos títulos dos filmes;
  *      - listar todas informações dos filmes;
  *      - listar informações de um filme;
- *      - listar todos filmes de um gênero.
+ *      - listar todos filmes de um gênero;
+ *      - consultar as estatísticas do servidor.
  * - Compilação:
- *      gcc -o servidor servidor.c -lpthread
+ *      gcc -o servidor servidor.c arena.c armazem.c bitmap.c cache.c csv.c estatisticas.c generos.c histograma.c imagem.c indice.c pool.c protocolo.c wal.c -lpthread
  * - Execução:
- *      ./servidor <porta desejada>
+ *      ./servidor <porta desejada> [-m epoll|uring|threads]
+ *                 [-e threads_de_eventos] [-w workers]
+ *                 [-a sockets_de_escuta] [-b backlog] [-c]
+ *                 [-g janela_de_commit_us] [-G bytes_por_lote] [-z]
+ *      ./servidor -x arquivo.csv
  * - Exemplo de uso:
  *     ./servidor 8000
+ *     ./servidor 8000 -m epoll -e 2 -w 8
+ *     ./servidor 8000 -a 4 -e 4 -b 4096 -c
+ *     ./servidor 8000 -g 2000 -G 65536
+ *     ./servidor -x exportado.csv
  ******************************************************************************/
 
 
+#define _GNU_SOURCE // accept4, EPOLLEXCLUSIVE, pthread_setaffinity_np
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <signal.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/errqueue.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#include "arena.h"
+#include "armazem.h"
+#include "cache.h"
+#include "csv.h"
+#include "estatisticas.h"
+#include "generos.h"
+#include "imagem.h"
+#include "indice.h"
+#include "pool.h"
+#include "protocolo.h"
+#include "wal.h"
+
+
+#ifndef SO_INCOMING_CPU
+#define SO_INCOMING_CPU 49
+#endif
+
+
+#define MAX_MOVIES (1 << 27)        // Máximo de filmes (tamanho do diretório de páginas)
+#define MOVIE_PAGE_SHIFT 10         // Páginas de 2^10 filmes
+#define INITIAL_INDEX_SIZE 1024     // IDs previstos na criação do índice
+#define MAX_STRING_BYTES ((size_t)1 << 36)  // Máximo da arena de strings dos filmes
+#define CSV_FILE_NAME "movies.csv"  // CSV importado se ainda não houver imagem
+#define IMAGE_FILE_NAME "movies.img"    // Imagem binária do catálogo (snapshot)
+#define CATALOG_IMAGE_VERSION 1     // Versão do conteúdo da imagem do catálogo
+#define CSV_NEXT_ID_PREFIX "#nextId="   // Linha do CSV com o próximo ID a gerar
+#define CSV_MOVIE_FIELDS 5              // Campos de um filme no CSV
+#define CSV_CHUNK_MIN_BYTES (4 * 1024 * 1024)   // Menor parte do CSV lida por uma thread
+#define WAL_FILE_NAME "movies.wal"  // Log de mutações posteriores à imagem
+#define WAL_OLD_FILE_NAME "movies.wal.old"  // Log em compactação
+#define COMPACTION_INTERVAL 60      // Segundos entre compactações do log
+#define COMPACTION_BYTES (4 * 1024 * 1024)  // Log que antecipa a compactação
+#define COMMIT_BATCH_BYTES (1024 * 1024)    // Limite padrão de um lote do log
+#define BUFFER_SIZE 1024            // Tamanho em bits do buffer para comunicação
+#define RESPONSE_SIZE (BUFFER_SIZE * 4)                         // Texto de uma resposta curta
+#define RESPONSE_FRAME_SIZE (FRAME_HEADER_SIZE + RESPONSE_SIZE) // Frame de resposta
+#define STREAM_CHUNK_SIZE 65536     // Texto de cada frame de uma listagem (aproximado)
+#define STREAM_PENDING_LIMIT (4 * STREAM_CHUNK_SIZE)    // Saída em espera que pausa uma listagem
+#define OUTPUT_INITIAL_SIZE 4096    // Capacidade inicial de um buffer de saída
+#define MAX_IOVECS 64               // Blocos enviados por chamada de sendmsg
+#define ZEROCOPY_MIN_BYTES 16384    // Menor trecho do cache enviado sem cópia
+#define CACHE_MAX_ENTRIES 4096      // Respostas guardadas no cache
+#define CACHE_MAX_BYTES (64u << 20) // Bytes de respostas guardadas no cache
+#define CACHE_CAPTURE_LIMIT (16u << 20) // Maior listagem guardada ao ser gerada
+#define CACHE_KEY_SIZE 128          // Chave de uma resposta no cache
+#define FIELD_SIZE 200              // Tamanho máximo de cada campo recebido
+#define MAX_EVENTS 256              // Eventos tratados por chamada de epoll_wait
+#define CONNECTION_EVENTS (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET)  // Eventos de uma conexão
+#define WORKER_QUEUE_SIZE 1024      // Capacidade da fila de cada worker do pool
+#define URING_ENTRIES 4096          // Entradas da fila de submissão do io_uring
+#define URING_BUFFERS 4096          // Buffers fornecidos ao kernel (potência de 2)
+#define URING_BUFFER_GROUP 0        // Identificador do grupo de buffers fornecidos
+
+
+/* Estrutura para armazenar informações de filme */
+typedef struct {
+    int id;             // ID (identificador único)
+    char title[100];    // Título
+    char director[100]; // Nome do diretor
+    int year;           // Ano de lançamento
+    char genres[200];   // Gêneros separados por ponto e vírgula, ex: "ação;aventura"
+} Movie;
+
+/* Filme como fica guardado no catálogo: só os campos de tamanho fixo, em
+ * 32 bytes. Título, diretor e gêneros ficam juntos na arena de strings
+ * ("título\0diretor\0gêneros\0"), a partir de strings. */
+typedef struct {
+    int id;                 // ID (identificador único)
+    int year;               // Ano de lançamento
+    uint64_t genreMask;     // Bit g: tem o gênero de ID g (só os primeiros 64)
+    uint64_t strings;       // Posição das strings na arena
+    uint8_t titleLength;    // Tamanho de cada string, sem o '\0'
+    uint8_t directorLength;
+    uint8_t genresLength;
+} MovieRecord;
+
+/* Seções da imagem do catálogo (imagem.h) */
+typedef enum {
+    CATALOG_INFO = 1,   // CatalogInfo
+    CATALOG_RECORDS,    // Páginas de movieList, no formato de storeAttach
+    CATALOG_STRINGS,    // Blocos da arena de strings, no formato de arenaAttach
+    CATALOG_ID_INDEX,   // Tabela de movieIndex
+    CATALOG_MOVIE_IDS,  // movieIds, serializado
+    CATALOG_GENRES      // Por ID: tamanho e nome do gênero, tamanho e bitmap
+} CatalogSection;
+
+/* Seção de informações da imagem do catálogo */
+typedef struct {
+    uint64_t movieCount;
+    uint64_t stringBytes;       // Bytes em uso na arena
+    uint64_t indexCapacity;     // Entradas da tabela de movieIndex
+    int32_t nextId;             // Próximo ID a gerar
+    uint32_t genreCount;
+    uint32_t recordSize;        // sizeof(MovieRecord) de quem gravou
+    uint32_t pageShift;         // MOVIE_PAGE_SHIFT de quem gravou
+} CatalogInfo;
+
+/* Parte do CSV importada por uma thread: os filmes lidos ficam em um lote
+ * próprio, no formato do catálogo, e são juntados ao catálogo em ordem */
+typedef struct {
+    const char* data;
+    size_t length;
+    size_t quotes;          // Aspas do trecho, para achar o início da parte
+    MovieRecord* records;   // Filmes lidos (strings: posição em strings)
+    size_t count;
+    size_t capacity;
+    char* strings;          // "título\0diretor\0gêneros\0" de cada filme
+    size_t stringBytes;
+    int nextId;             // Maior #nextId da parte
+    int failed;             // Faltou memória
+    int threaded;           // Lida por uma thread própria
+    pthread_t thread;
+} CsvChunk;
+
+/* Tipos de registro do log de mutações */
+typedef enum {
+    LOG_PUT_MOVIE = 1,  // Estado completo de um filme (cadastro ou alteração)
+    LOG_REMOVE_MOVIE    // Remoção de um filme pelo ID
+} LogRecordType;
+
+/* Buffer de saída que cresce conforme o texto gerado */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int failed;         // Faltou memória em algum momento
+} OutputBuffer;
+
+/* Listagem (opções 4, 5 e 7) gerada e enviada aos poucos, em frames de
+ * cerca de STREAM_CHUNK_SIZE bytes de texto: a memória usada não depende
+ * do tamanho do catálogo. Uma listagem paginada percorre os filmes em ordem
+ * de ID a partir do cursor. */
+typedef struct ResponseStream {
+    int option;
+    uint32_t requestId;
+    PagedStore snapshot;        // Opções 4 e 5: catálogo fixado na abertura
+    Bitmap matches;             // Opção 7: IDs dos filmes encontrados
+    const Bitmap* ids;          // Listagem em ordem de ID (matches ou movieIds)
+    uint64_t position;          // Próxima posição do snapshot, ou próximo ID
+    int paged;                  // Lista uma só página
+    long pageRemaining;         // Filmes que ainda cabem na página
+    int lastId;                 // Último ID listado (cursor da próxima página)
+    int started;                // Primeira linha do texto já gerada
+    int done;                   // Último frame já gerado
+    OutputBuffer output;        // Frame atual (só o cabeçalho, se body != NULL)
+    CachedText* cached;         // Listagem servida do cache (ou NULL)
+    size_t cachedLength;        // Tamanho do texto em cache na abertura
+    const char* body;           // Texto do frame atual, dentro de cached
+    size_t bodyLength;
+    char cacheKey[CACHE_KEY_SIZE];  // Chave em que a listagem será guardada ("": não guarda)
+    uint64_t cacheGeneration;   // Geração do cache na abertura
+    OutputBuffer capture;       // Texto gerado até aqui, para o cache
+    RequestTiming timing;       // Tempos da abertura e das partes geradas
+    uint64_t bytesIn;           // Frame da requisição (0: listagem não aberta)
+    uint64_t bytesOut;          // Frames gerados até aqui
+    struct ResponseStream* next;    // Próxima listagem pausada da conexão
+} ResponseStream;
+
+/* Requisição de um cliente, decodificada de um frame */
+typedef struct {
+    int option;                                  // Opção (opcode do frame)
+    uint32_t requestId;                          // ID a repetir na resposta
+    int fieldCount;                              // Quantidade de campos recebidos
+    char fields[FRAME_MAX_FIELDS][FIELD_SIZE];   // Campos na ordem de envio
+    uint64_t receivedAt;                         // Chegada do frame completo (statsNow)
+    uint32_t bytes;                              // Tamanho do frame recebido
+} Request;
+
+/* Resultado de extrair uma requisição dos bytes recebidos */
+typedef enum {
+    REQUEST_INCOMPLETE, // Ainda não chegou um frame completo
+    REQUEST_READY,      // Requisição completa, pronta para executar
+    REQUEST_CLOSE,      // Cliente pediu para encerrar a conexão (opção 0)
+    REQUEST_INVALID     // Frame malformado ou de versão desconhecida
+} RequestState;
+
+/* Bloco da saída pendente de uma conexão: bytes próprios em data ou um
+ * trecho de uma resposta do cache */
+typedef struct OutputChunk {
+    struct OutputChunk* next;
+    size_t length;
+    size_t offset;          // Quanto já foi enviado
+    CachedText* text;       // Resposta do cache referenciada (ou NULL)
+    const char* body;       // Trecho de text enviado (ou NULL: data)
+    char data[];
+} OutputChunk;
+
+/* Envio sem cópia (MSG_ZEROCOPY) cujos bytes o kernel ainda pode ler: a
+ * referência ao texto só é devolvida quando chega a notificação id */
+typedef struct ZeroCopySend {
+    struct ZeroCopySend* next;
+    uint32_t id;
+    CachedText* text;
+} ZeroCopySend;
+
+/* Estado de uma conexão no modo epoll */
+typedef struct {
+    int fd;                 // Socket do cliente (não bloqueante)
+    FrameParser parser;     // Bytes recebidos (só a thread de eventos)
+    int epollFd;            // epoll da thread de eventos dona da conexão
+    pthread_mutex_t lock;   // Protege a saída pendente, as listagens, closed e draining
+    OutputChunk* pending;   // Respostas ainda não enviadas, em ordem
+    OutputChunk* pendingTail;
+    size_t pendingBytes;    // Bytes de pending ainda não enviados
+    ResponseStream* streams;    // Listagens pausadas até a saída esvaziar
+    ResponseStream* streamsTail;
+    int zeroCopy;           // Envia trechos grandes com MSG_ZEROCOPY
+    uint32_t zeroCopyNext;  // ID da notificação do próximo envio sem cópia
+    ZeroCopySend* zeroCopyWait; // Envios sem cópia sem notificação, em ordem
+    ZeroCopySend* zeroCopyWaitTail;
+    int closed;             // Conexão encerrada pela thread de eventos
+    int draining;           // O cliente pediu o encerramento: nada mais é lido
+                            // e a conexão fecha quando as respostas saírem
+    int refs;               // Referências: thread de eventos + tarefas no pool
+                            // e respostas esperando o log
+} Connection;
+
+/* Requisição entregue ao pool de workers */
+typedef struct {
+    Connection* conn;
+    Request request;
+} RequestTask;
+
+/* Resposta de uma escrita esperando seu registro chegar ao disco */
+typedef struct {
+    Connection* conn;
+    size_t length;                      // Tamanho do frame
+    char frame[RESPONSE_FRAME_SIZE];
+} DeferredResponse;
+
+/* Tipos de operação submetidas ao io_uring */
+typedef enum {
+    URING_OP_ACCEPT,
+    URING_OP_RECV,
+    URING_OP_SEND,
+    URING_OP_WAKE           // Leitura do eventfd de respostas de escritas
+} UringOpType;
+
+typedef struct UringConnection UringConnection;
+
+/* Operação submetida ao io_uring (identificada pelo user_data da SQE) */
+typedef struct UringOp {
+    UringOpType type;
+    UringConnection* conn;  // Conexão dona da operação (recv/send)
+    struct UringOp* next;   // Próxima resposta na fila de envio
+    const char* buffer;     // Bytes a enviar: data ou um trecho de text (send)
+    size_t length;          // Tamanho de buffer (send)
+    CachedText* text;       // Resposta do cache referenciada (ou NULL)
+    char data[];            // Resposta a enviar (send)
+} UringOp;
+
+/* Estado de uma conexão no modo io_uring */
+struct UringConnection {
+    int fd;                     // Socket do cliente
+    FrameParser parser;         // Bytes recebidos ainda não consumidos
+    UringOp recvOp;             // Operação do recv multishot
+    UringOp* sendQueue;         // Respostas ainda não submetidas
+    UringOp* sendQueueTail;
+    size_t queuedBytes;         // Bytes enfileirados ou em envio
+    ResponseStream* streams;    // Listagens esperando a saída esvaziar
+    ResponseStream* streamsTail;
+    UringConnection* nextDirty; // Próxima conexão com respostas a submeter
+    int dirty;                  // Está na lista de conexões a descarregar
+    int sending;                // Sends submetidos ainda sem completude
+    int zeroCopy;               // Envia trechos grandes com IORING_OP_SEND_ZC
+    int inflight;               // Operações submetidas sem CQE final e
+                                // respostas de escritas esperando o log
+    int closing;                // Encerramento em andamento
+    int draining;               // O cliente pediu o encerramento: nada mais é
+                                // lido e a conexão fecha quando as respostas saírem
+};
+
+/* Anel do io_uring mapeado em memória, com o anel de buffers fornecidos */
+typedef struct {
+    int fd;
+    void* sqPtr;
+    void* cqPtr;
+    size_t sqSize;
+    size_t cqSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned sqEntries;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    unsigned cqEntries;
+    struct io_uring_cqe* cqes;
+    unsigned toSubmit;                  // SQEs preparadas e não submetidas
+    struct io_uring_buf_ring* bufferRing;
+    size_t bufferRingSize;
+    char* bufferBase;                   // Memória dos buffers fornecidos
+    int sendZeroCopy;                   // O kernel tem IORING_OP_SEND_ZC
+    int failed;                         // Submissão falhou: a thread do anel encerra
+} Uring;
+
+/* Estado de cada thread do modo io_uring */
+typedef struct {
+    pthread_t thread;
+    int serverSocket;
+    int cpu;                            // CPU em que a thread é fixada (-1: nenhuma)
+    Uring ring;
+    UringConnection* dirty;             // Conexões com respostas a submeter
+    char frame[RESPONSE_FRAME_SIZE];
+    int wakeFd;                         // eventfd: há respostas de escritas no disco
+    uint64_t wakeValue;                 // Destino da leitura do eventfd
+    UringOp wakeOp;
+    pthread_mutex_t durableLock;        // Protege durable
+    struct UringDeferred* durable;      // Respostas de escritas já no disco
+} UringThread;
+
+/* Resposta de uma escrita no modo io_uring esperando seu registro chegar ao
+ * disco; a thread de gravação a devolve à thread do anel, que a envia */
+typedef struct UringDeferred {
+    UringThread* thread;
+    UringConnection* conn;
+    struct UringDeferred* next;
+    size_t length;                      // Tamanho do frame
+    char frame[RESPONSE_FRAME_SIZE];
+} UringDeferred;
+
+/* Modos de atendimento de clientes */
+typedef enum {
+    MODE_THREADS,   // Uma thread por cliente
+    MODE_EPOLL,     // Reator epoll com poucas threads de eventos
+    MODE_URING      // io_uring com accept/recv multishot e submissão em lote
+} ServerMode;
+
+/* Configuração do servidor definida na inicialização */
+typedef struct {
+    int port;           // Porta de escuta
+    ServerMode mode;    // Modo de atendimento
+    int eventThreads;   // Threads de eventos dos modos epoll e io_uring
+    int workers;        // Workers que executam as requisições no modo epoll
+    int acceptors;      // Sockets de escuta SO_REUSEPORT (1: um só socket)
+    int backlog;        // Fila de conexões pendentes de cada socket
+    int incomingCpu;    // Usa SO_INCOMING_CPU nos sockets de escuta
+    int cpuCount;       // CPUs disponíveis
+    long commitWindow;  // Janela de um lote do log, em microssegundos
+    long commitBytes;   // Bytes que fecham um lote do log antes da janela
+    const char* exportPath; // Exporta o catálogo para este CSV e termina
+    int zeroCopy;       // Envia os trechos grandes do cache sem cópia
+} ServerConfig;
+
+/* Aquisição do lock do catálogo por uma thread (estatísticas) */
+typedef struct {
+    int option;             // Opção em execução (ou STATS_COMPACTION): dona do lock
+    int write;              // Tem o lock de escrita
+    uint64_t waited;        // Espera até obter o lock
+    uint64_t acquiredAt;
+} CatalogLockUse;
+
+/* Thread que aceita conexões de um socket de escuta */
+typedef struct {
+    pthread_t thread;
+    int serverSocket;   // Socket de escuta atendido pela thread
+    int cpu;            // CPU em que a thread é fixada (-1: nenhuma)
+} ListenerThread;
+
+
+/* Variáveis globais */
+PagedStore movieList;          // Filmes (MovieRecord), em páginas que nunca se movem
+StringArena movieStrings;      // Títulos, diretores e gêneros dos filmes
+int movieCount = 0;            // Quantidade de filmes carregados
+
+IdIndex movieIndex;            // ID -> posição em movieList
+int nextMovieId = 1;           // Próximo ID a gerar (nunca diminui)
+GenreIndex genreIndex;         // Gênero -> IDs dos filmes
+Bitmap movieIds;               // IDs cadastrados, em ordem (listagens paginadas)
+ResponseCache responseCache;   // Listagens e consultas já geradas
+MappedImage catalogImage;      // Imagem carregada: as primeiras páginas do catálogo
+
+pthread_rwlock_t movieLock;    // Leituras em paralelo, escritas exclusivas (movieList e índices)
+__thread uint64_t lockWaitNanos;   // Espera pelo lock na requisição em execução pela thread
+__thread CatalogLockUse lockUse;   // Aquisição do lock feita pela thread
+int catalogWriter = -1;        // Opção com o lock de escrita (-1: nenhuma), a quem culpar a espera
+ServerStats serverStats;       // Contadores e latências por opção
+
+Wal* movieLog = NULL;          // Log de mutações (escrito com o lock de escrita)
+pthread_mutex_t compactionLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t compactionWake = PTHREAD_COND_INITIALIZER;  // Log cresceu demais
+
+WorkerPool* workerPool = NULL; // Pool que executa as requisições (modo epoll)
+int zeroCopySends = 1;         // Trechos grandes do cache vão sem cópia (-z desativa)
+
+
+/* Funções auxiliares internas */
+/* Filme na posição index de movieList */
+static inline MovieRecord* movieAt(int index) {
+    return storeAt(&movieList, (size_t)index);
+}
+
+/* Título, diretor e gêneros de um filme, guardados na arena */
+static inline const char* movieTitle(const MovieRecord* record) {
+    return arenaAt(&movieStrings, record->strings);
+}
+
+static inline const char* movieDirector(const MovieRecord* record) {
+    return movieTitle(record) + record->titleLength + 1;
+}
+
+static inline const char* movieGenres(const MovieRecord* record) {
+    return movieDirector(record) + record->directorLength + 1;
+}
+
+/* Bytes das strings de um filme na arena */
+static inline size_t movieStringBytes(const MovieRecord* record) {
+    return (size_t)record->titleLength + record->directorLength + record->genresLength + 3;
+}
+
+/* Toma o lock do catálogo para leitura ou escrita em nome de
+ * lockUse.option, somando a espera ao tempo de lock da requisição em
+ * execução pela thread (estatísticas). Uma espera que começou com o lock
+ * de escrita tomado também é atribuída a quem o tinha. */
+void lockCatalog(int write) {
+    int writer = __atomic_load_n(&catalogWriter, __ATOMIC_RELAXED);
+    uint64_t start = statsNow();
+    if (write) {
+        pthread_rwlock_wrlock(&movieLock);
+        __atomic_store_n(&catalogWriter, lockUse.option, __ATOMIC_RELAXED);
+    } else {
+        pthread_rwlock_rdlock(&movieLock);
+    }
+    lockUse.acquiredAt = statsNow();
+    lockUse.write = write;
+    lockUse.waited = lockUse.acquiredAt - start;
+    lockWaitNanos += lockUse.waited;
+    if (writer >= 0) {
+        statsRecordBlocked(&serverStats, writer, lockUse.waited);
+    }
+}
+
+/* Libera o lock do catálogo e registra a aquisição: espera e tempo com o
+ * lock da opção dona */
+void unlockCatalog() {
+    if (lockUse.write) {
+        __atomic_store_n(&catalogWriter, -1, __ATOMIC_RELAXED);
+    }
+    uint64_t hold = statsNow() - lockUse.acquiredAt;
+    pthread_rwlock_unlock(&movieLock);
+    statsRecordLock(&serverStats, lockUse.option, lockUse.write, lockUse.waited, hold);
+}
+
+/* Garante espaço em out para mais extra bytes (retorna -1 se faltar
+ * memória) */
+int outputReserve(OutputBuffer* out, size_t extra) {
+    if (out->length + extra <= out->capacity) {
+        return 0;
+    }
+    size_t capacity = out->capacity > 0 ? out->capacity : OUTPUT_INITIAL_SIZE;
+    while (capacity < out->length + extra) {
+        capacity *= 2;
+    }
+    char* data = realloc(out->data, capacity);
+    if (data == NULL) {
+        out->failed = 1;
+        return -1;
+    }
+    out->data = data;
+    out->capacity = capacity;
+    return 0;
+}
+
+/* Acrescenta texto formatado ao fim de out (retorna -1 se faltar memória) */
+int outputPrintf(OutputBuffer* out, const char* format, ...) {
+    va_list args;
+    if (outputReserve(out, 512) < 0) {
+        return -1;
+    }
+
+    va_start(args, format);
+    int length = vsnprintf(out->data + out->length, out->capacity - out->length, format, args);
+    va_end(args);
+    if (length < 0) {
+        out->failed = 1;
+        return -1;
+    }
+
+    // Não coube: cresce e formata de novo
+    if ((size_t)length >= out->capacity - out->length) {
+        if (outputReserve(out, (size_t)length + 1) < 0) {
+            return -1;
+        }
+        va_start(args, format);
+        vsnprintf(out->data + out->length, out->capacity - out->length, format, args);
+        va_end(args);
+    }
+    out->length += length;
+    return 0;
+}
+
+void outputFree(OutputBuffer* out) {
+    free(out->data);
+    memset(out, 0, sizeof(*out));
+}
+
+/* Acrescenta a linha de um filme em uma listagem: ID e título na opção 4,
+ * todas as informações nas opções 5 e 7 (retorna -1 se faltar memória) */
+int appendMovieLine(int option, const MovieRecord* record, OutputBuffer* out) {
+    if (option == 4) {
+        return outputPrintf(out, "%d - %s\n", record->id, movieTitle(record));
+    }
+    return outputPrintf(out, "ID: %d | Título: %s | Diretor: %s | Ano: %d | Gêneros: %s\n",
+                        record->id,
+                        movieTitle(record),
+                        movieDirector(record),
+                        record->year,
+                        movieGenres(record));
+}
+
+/* Copia um filme do catálogo para a estrutura completa */
+void readMovie(const MovieRecord* record, Movie* movie) {
+    movie->id = record->id;
+    movie->year = record->year;
+    memcpy(movie->title, movieTitle(record), record->titleLength + 1);
+    memcpy(movie->director, movieDirector(record), record->directorLength + 1);
+    memcpy(movie->genres, movieGenres(record), record->genresLength + 1);
+}
+
+/* Preenche o registro compacto de um filme, acrescentando suas strings à
+ * arena. Os gêneros devem já estar no índice. (retorna -1 se faltar
+ * memória) */
+int writeMovieRecord(const Movie* movie, MovieRecord* record) {
+    size_t lengths[] = { strlen(movie->title), strlen(movie->director), strlen(movie->genres) };
+    char strings[sizeof(movie->title) + sizeof(movie->director) + sizeof(movie->genres)];
+    memcpy(strings, movie->title, lengths[0] + 1);
+    memcpy(strings + lengths[0] + 1, movie->director, lengths[1] + 1);
+    memcpy(strings + lengths[0] + lengths[1] + 2, movie->genres, lengths[2] + 1);
+
+    uint64_t position = arenaAppend(&movieStrings, strings, lengths[0] + lengths[1] + lengths[2] + 3);
+    if (position == ARENA_INVALID) {
+        return -1;
+    }
+    record->id = movie->id;
+    record->year = movie->year;
+    record->genreMask = genreIndexMask(&genreIndex, movie->genres);
+    record->strings = position;
+    record->titleLength = (uint8_t)lengths[0];
+    record->directorLength = (uint8_t)lengths[1];
+    record->genresLength = (uint8_t)lengths[2];
+    return 0;
+}
+
+/* Retorna 1 se o filme tem exatamente o gênero dado. Os gêneros com ID
+ * pequeno são conferidos pela máscara, sem ler as strings. */
+int hasGenre(const MovieRecord* record, const char* genre, size_t length) {
+    int id = genreFind(&genreIndex, genre, length);
+    if (id < 0) {
+        return 0;
+    }
+    if (id < GENRE_MASK_BITS) {
+        return (record->genreMask >> id) & 1;
+    }
+    return genreListContains(movieGenres(record), genre, length);
+}
+
+/* Adiciona um filme ao fim do array e aos índices (retorna -1 se o array
+ * estiver cheio ou faltar memória) */
+int appendMovie(const Movie* movie) {
+    MovieRecord* slot = storePush(&movieList);
+    if (slot == NULL) {
+        return -1;
+    }
+    if (indexPut(&movieIndex, movie->id, movieCount) < 0) {
+        storePop(&movieList);
+        return -1;
+    }
+    if (genreIndexAddMovie(&genreIndex, movie->id, movie->genres) < 0 ||
+        bitmapAdd(&movieIds, (uint32_t)movie->id) < 0 ||
+        writeMovieRecord(movie, slot) < 0) {
+        genreIndexRemoveMovie(&genreIndex, movie->id, movie->genres);
+        bitmapRemove(&movieIds, (uint32_t)movie->id);
+        indexRemove(&movieIndex, movie->id);
+        storePop(&movieList);
+        return -1;
+    }
+    movieCount++;
+    if (movie->id >= nextMovieId) {
+        nextMovieId = movie->id + 1;
+    }
+    return 0;
+}
+
+/* Remove o filme na posição index copiando o último filme do array para a
+ * posição dele, e corrige no índice a posição do filme movido (retorna -1
+ * se faltar memória para copiar uma página em uso por um snapshot) */
+int removeMovieAt(int index) {
+    MovieRecord* record = storeAtForWrite(&movieList, (size_t)index);
+    if (record == NULL) {
+        return -1;
+    }
+    indexRemove(&movieIndex, record->id);
+    bitmapRemove(&movieIds, (uint32_t)record->id);
+    genreIndexRemoveMovie(&genreIndex, record->id, movieGenres(record));
+    arenaDiscard(&movieStrings, movieStringBytes(record));
+    movieCount--;
+    if (index != movieCount) {
+        *record = *movieAt(movieCount);
+        indexPut(&movieIndex, record->id, index);
+    }
+    storePop(&movieList);
+    return 0;
+}
+
+/* Substitui o filme na posição index, atualizando seus gêneros no índice
+ * (retorna -1 se faltar memória) */
+int replaceMovieAt(int index, const Movie* movie) {
+    MovieRecord* current = storeAtForWrite(&movieList, (size_t)index);
+    MovieRecord record;
+    if (current == NULL) {
+        return -1;
+    }
+    genreIndexRemoveMovie(&genreIndex, current->id, movieGenres(current));
+    if (genreIndexAddMovie(&genreIndex, movie->id, movie->genres) < 0 ||
+        writeMovieRecord(movie, &record) < 0) {
+        genreIndexRemoveMovie(&genreIndex, movie->id, movie->genres);
+        genreIndexAddMovie(&genreIndex, current->id, movieGenres(current));
+        return -1;
+    }
+    arenaDiscard(&movieStrings, movieStringBytes(current));
+    *current = record;
+    return 0;
+}
+
+/* Thread de importação: conta as aspas do trecho */
+void* countChunkQuotes(void* arg) {
+    CsvChunk* chunk = arg;
+    const char* end = chunk->data + chunk->length;
+    chunk->quotes = 0;
+    for (const char* c = chunk->data; (c = memchr(c, '"', end - c)) != NULL; c++) {
+        chunk->quotes++;
+    }
+    return NULL;
+}
+
+/* Copia um campo para o lote da parte, cortado em size - 1 bytes, e
+ * devolve seu tamanho */
+static uint8_t copyChunkField(CsvChunk* chunk, const CsvField* field, size_t size) {
+    size_t length = csvFieldCopy(field, chunk->strings + chunk->stringBytes, size);
+    chunk->stringBytes += length + 1;
+    return (uint8_t)length;
+}
+
+/* Thread de importação: lê os filmes da parte para o lote dela. Os campos
+ * de um filme ocupam ao menos os bytes que suas strings ocupam no lote
+ * (vírgulas e quebra de linha no lugar dos '\0'), então strings tem o
+ * tamanho da parte. */
+void* parseChunk(void* arg) {
+    CsvChunk* chunk = arg;
+    chunk->strings = malloc(chunk->length + 1);
+    if (chunk->strings == NULL) {
+        chunk->failed = 1;
+        return NULL;
+    }
+
+    CsvReader reader;
+    CsvField fields[CSV_MOVIE_FIELDS];
+    csvReaderInit(&reader, chunk->data, chunk->length);
+    int count;
+    while ((count = csvNextRecord(&reader, fields, CSV_MOVIE_FIELDS)) > 0) {
+        // Próximo ID a gerar (preserva IDs de filmes já removidos)
+        char number[16];
+        size_t prefixLength = strlen(CSV_NEXT_ID_PREFIX);
+        if (count == 1 && fields[0].length > prefixLength &&
+            memcmp(fields[0].data, CSV_NEXT_ID_PREFIX, prefixLength) == 0) {
+            CsvField value = { fields[0].data + prefixLength, fields[0].length - prefixLength, 0 };
+            csvFieldCopy(&value, number, sizeof(number));
+            int nextId = atoi(number);
+            if (nextId > chunk->nextId) {
+                chunk->nextId = nextId;
+            }
+            continue;
+        }
+
+        // Campos: id, titulo, diretor, ano, generos
+        if (count != CSV_MOVIE_FIELDS) {
+            continue;
+        }
+        if (chunk->count == chunk->capacity) {
+            size_t capacity = chunk->capacity > 0 ? chunk->capacity * 2 : 1024;
+            MovieRecord* records = realloc(chunk->records, sizeof(MovieRecord) * capacity);
+            if (records == NULL) {
+                chunk->failed = 1;
+                return NULL;
+            }
+            chunk->records = records;
+            chunk->capacity = capacity;
+        }
+        MovieRecord* record = &chunk->records[chunk->count++];
+        csvFieldCopy(&fields[0], number, sizeof(number));
+        record->id = atoi(number);
+        csvFieldCopy(&fields[3], number, sizeof(number));
+        record->year = atoi(number);
+        record->genreMask = 0;
+        record->strings = chunk->stringBytes;
+        record->titleLength = copyChunkField(chunk, &fields[1], sizeof(((Movie*)0)->title));
+        record->directorLength = copyChunkField(chunk, &fields[2], sizeof(((Movie*)0)->director));
+        record->genresLength = copyChunkField(chunk, &fields[4], sizeof(((Movie*)0)->genres));
+    }
+    return NULL;
+}
+
+/* Executa a função em uma thread para cada parte (a primeira na thread
+ * atual) e espera todas */
+void runCsvChunks(CsvChunk* chunks, int count, void* (*function)(void*)) {
+    for (int i = 1; i < count; i++) {
+        chunks[i].threaded = pthread_create(&chunks[i].thread, NULL, function, &chunks[i]) == 0;
+        if (!chunks[i].threaded) {
+            // Sem thread nova, a parte é lida aqui mesmo
+            function(&chunks[i]);
+        }
+    }
+    function(&chunks[0]);
+    for (int i = 1; i < count; i++) {
+        if (chunks[i].threaded) {
+            pthread_join(chunks[i].thread, NULL);
+        }
+    }
+}
+
+/* Divide os length bytes do CSV em count partes terminadas em quebras de
+ * linha fora de aspas. As aspas de cada trecho são contadas em paralelo; a
+ * paridade das aspas antes de um trecho diz se ele começa entre aspas, e a
+ * parte começa na primeira quebra de linha fora de aspas dali em diante. */
+void splitCsvChunks(CsvChunk* chunks, int count, const char* data, size_t length) {
+    for (int i = 0; i < count; i++) {
+        size_t start = length / count * i;
+        chunks[i].data = data + start;
+        chunks[i].length = (i == count - 1 ? length : length / count * (i + 1)) - start;
+    }
+    runCsvChunks(chunks, count, countChunkQuotes);
+
+    size_t quotes = chunks[0].quotes;
+    size_t previous = 0;
+    for (int i = 1; i < count; i++) {
+        const char* c = chunks[i].data;
+        int inside = quotes % 2;
+        quotes += chunks[i].quotes;
+        while (c < data + length && (inside || *c != '\n')) {
+            inside ^= *c == '"';
+            c++;
+        }
+        size_t start = c < data + length ? (size_t)(c - data) + 1 : length;
+        if (start < previous) {
+            start = previous;
+        }
+        chunks[i - 1].length = start - previous;
+        chunks[i].data = data + start;
+        previous = start;
+    }
+    chunks[count - 1].length = length - previous;
+}
+
+/* Junta ao catálogo os filmes lidos de uma parte, na ordem do arquivo
+ * (retorna -1 se o catálogo encher ou faltar memória) */
+int mergeCsvChunk(const CsvChunk* chunk) {
+    if (chunk->nextId > nextMovieId) {
+        nextMovieId = chunk->nextId;
+    }
+    for (size_t i = 0; i < chunk->count; i++) {
+        const MovieRecord* record = &chunk->records[i];
+        const char* strings = chunk->strings + record->strings;
+        Movie movie;
+        movie.id = record->id;
+        movie.year = record->year;
+        memcpy(movie.title, strings, record->titleLength + 1);
+        strings += record->titleLength + 1;
+        memcpy(movie.director, strings, record->directorLength + 1);
+        strings += record->directorLength + 1;
+        memcpy(movie.genres, strings, record->genresLength + 1);
+        if (appendMovie(&movie) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Importa os filmes dos length bytes do CSV, divididos em partes lidas em
+ * paralelo por até threads threads, cada uma com um lote próprio. Os lotes
+ * são juntados ao catálogo na ordem do arquivo, então IDs de gêneros e
+ * posições saem como em uma leitura sequencial. */
+void importCsv(const char* data, size_t length, int threads) {
+    // Partes pequenas não compensam uma thread
+    int count = threads;
+    if ((size_t)count > length / CSV_CHUNK_MIN_BYTES) {
+        count = (int)(length / CSV_CHUNK_MIN_BYTES);
+    }
+    if (count < 1) {
+        count = 1;
+    }
+    CsvChunk* chunks = calloc(count, sizeof(CsvChunk));
+    if (chunks == NULL) {
+        perror("Erro ao importar o CSV");
+        return;
+    }
+    splitCsvChunks(chunks, count, data, length);
+    runCsvChunks(chunks, count, parseChunk);
+
+    size_t total = movieCount;
+    for (int i = 0; i < count; i++) {
+        total += chunks[i].count;
+    }
+    int failed = indexReserve(&movieIndex, total) < 0;
+    for (int i = 0; i < count; i++) {
+        failed = failed || chunks[i].failed || mergeCsvChunk(&chunks[i]) < 0;
+        free(chunks[i].records);
+        free(chunks[i].strings);
+    }
+    free(chunks);
+    if (failed) {
+        printf("Limite máximo de filmes atingido ou memória insuficiente!\n");
+    }
+}
+
+/* Carregar filmes do arquivo CSV para o array. O arquivo é mapeado e lido
+ * pelo leitor de csv.c, que aceita campos entre aspas (RFC 4180). */
+void loadMoviesFromCSV(const char* filename, int threads) {
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        // Se não encontra o arquivo, inicializa com zero filmes
+        printf("Arquivo '%s' não encontrado. Inicializando sem filmes registrados.\n", filename);
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        size_t length = (size_t)info.st_size;
+        char* data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, length, MADV_WILLNEED);
+            importCsv(data, length, threads);
+            munmap(data, length);
+        } else {
+            perror("Erro ao mapear o arquivo CSV");
+        }
+    }
+    close(fd);
+    printf("Carregados %d filmes do arquivo '%s'.\n", movieCount, filename);
+}
+
+/* Salvar os filmes dados no arquivo CSV. O arquivo é gravado ao lado,
+ * sincronizado e renomeado por cima do antigo, então uma queda no meio não
+ * deixa um snapshot pela metade (retorna -1 em caso de erro). */
+int saveMoviesToCSV(const char* filename, const PagedStore* movies, int nextId) {
+    // As strings ficam na arena, que só cresce: as posições de um snapshot
+    // de movieList continuam válidas sem movieLock
+    char tempName[256];
+    snprintf(tempName, sizeof(tempName), "%s.tmp", filename);
+    FILE* file = fopen(tempName, "w");
+
+    if (file == NULL) {
+        // Se não consegue abrir o arquivo, não salva nada
+        printf("Erro ao abrir arquivo '%s' para escrita.\n", tempName);
+        return -1;
+    }
+
+    // Salva o próximo ID e as informações de cada filme no formato CSV
+    fprintf(file, CSV_NEXT_ID_PREFIX "%d\n", nextId);
+    for (size_t i = 0; i < movies->count; i++) {
+        const MovieRecord* record = storeAt(movies, i);
+        // Título, diretor e gêneros vão entre aspas se tiverem vírgula
+        fprintf(file, "%d,", record->id);
+        csvWriteField(file, movieTitle(record));
+        putc(',', file);
+        csvWriteField(file, movieDirector(record));
+        fprintf(file, ",%d,", record->year);
+        csvWriteField(file, movieGenres(record));
+        putc('\n', file);
+    }
+
+    if (fflush(file) != 0 || fsync(fileno(file)) < 0) {
+        printf("Erro ao gravar arquivo '%s'.\n", tempName);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    return rename(tempName, filename);
+}
+
+/* Posição que uma string de length bytes recebe em uma arena cujo próximo
+ * byte livre é *end, avançando *end como arenaAppend faria (um acréscimo
+ * nunca cruza dois blocos) */
+static uint64_t placeString(uint64_t* end, size_t length) {
+    if ((*end & (ARENA_CHUNK_SIZE - 1)) + length > ARENA_CHUNK_SIZE) {
+        *end = (*end + ARENA_CHUNK_SIZE - 1) & ~(uint64_t)(ARENA_CHUNK_SIZE - 1);
+    }
+    uint64_t position = *end;
+    *end += length;
+    return position;
+}
+
+/* Grava as seções de registros e de strings da imagem: os registros vão
+ * página a página (a última completa), com a posição das strings em uma
+ * arena compactada, sem os bytes descartados; as strings vão nessas mesmas
+ * posições, com o resto de cada bloco zerado (retorna -1 em caso de erro) */
+int writeCatalogMovies(ImageWriter* writer, const PagedStore* movies) {
+    size_t pageElements = (size_t)1 << MOVIE_PAGE_SHIFT;
+    size_t pageBytes = sizeof(MovieRecord) << MOVIE_PAGE_SHIFT;
+    MovieRecord* page = malloc(pageBytes);
+    if (page == NULL || imageBeginSection(writer, CATALOG_RECORDS) < 0) {
+        free(page);
+        return -1;
+    }
+    uint64_t end = 0;
+    for (size_t first = 0; first < movies->count; first += pageElements) {
+        memset(page, 0, pageBytes);
+        for (size_t i = first; i < movies->count && i < first + pageElements; i++) {
+            MovieRecord* record = &page[i - first];
+            *record = *(const MovieRecord*)storeAt(movies, i);
+            record->strings = placeString(&end, movieStringBytes(record));
+        }
+        if (imageWriteZeros(writer, STORE_PAGE_HEADER_SIZE) < 0 || imageWrite(writer, page, pageBytes) < 0) {
+            free(page);
+            return -1;
+        }
+    }
+    free(page);
+
+    if (imageBeginSection(writer, CATALOG_STRINGS) < 0) {
+        return -1;
+    }
+    end = 0;
+    for (size_t i = 0; i < movies->count; i++) {
+        const MovieRecord* record = storeAt(movies, i);
+        size_t length = movieStringBytes(record);
+        uint64_t position = placeString(&end, length);
+        if (imageWriteZeros(writer, position - imageSectionLength(writer)) < 0 ||
+            imageWrite(writer, movieTitle(record), length) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Grava um bitmap serializado na seção atual, precedido do seu tamanho se
+ * withLength (retorna -1 em caso de erro) */
+int writeImageBitmap(ImageWriter* writer, const Bitmap* bitmap, int withLength) {
+    uint64_t length = bitmapSerializedSize(bitmap);
+    char* serialized = malloc(length);
+    if (serialized == NULL) {
+        return -1;
+    }
+    bitmapSerialize(bitmap, serialized);
+    int status = (withLength && imageWrite(writer, &length, sizeof(length)) < 0) ||
+                 imageWrite(writer, serialized, length) < 0 ? -1 : 0;
+    free(serialized);
+    return status;
+}
+
+/* Grava as seções dos índices da imagem (retorna -1 em caso de erro) */
+int writeCatalogIndexes(ImageWriter* writer, const IdIndex* index, const Bitmap* ids, const GenreIndex* genres) {
+    if (imageBeginSection(writer, CATALOG_ID_INDEX) < 0 ||
+        imageWrite(writer, index->entries, sizeof(IndexEntry) * index->capacity) < 0 ||
+        imageBeginSection(writer, CATALOG_MOVIE_IDS) < 0 || writeImageBitmap(writer, ids, 0) < 0 ||
+        imageBeginSection(writer, CATALOG_GENRES) < 0) {
+        return -1;
+    }
+    for (int id = 0; id < genres->count; id++) {
+        uint32_t nameLength = (uint32_t)strlen(genres->names[id]);
+        if (imageWrite(writer, &nameLength, sizeof(nameLength)) < 0 ||
+            imageWrite(writer, genres->names[id], nameLength) < 0 ||
+            writeImageBitmap(writer, &genres->movies[id], 1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Grava a imagem binária dos filmes dados, com registros, strings e
+ * índices já no formato em que são usados. Os índices são montados aqui, a
+ * partir dos próprios filmes, com os gêneros internados na ordem de
+ * genreNames para manter os IDs das máscaras dos registros. (retorna -1 em
+ * caso de erro) */
+int saveCatalogImage(const char* filename, const PagedStore* movies, int nextId,
+                     char* const* genreNames, int genreCount) {
+    IdIndex index;
+    GenreIndex genres;
+    Bitmap ids;
+    bitmapInit(&ids);
+    if (indexInit(&index, movies->count) < 0) {
+        return -1;
+    }
+    if (genreIndexInit(&genres) < 0) {
+        indexFree(&index);
+        return -1;
+    }
+
+    CatalogInfo info;
+    memset(&info, 0, sizeof(info));
+    info.movieCount = movies->count;
+    info.nextId = nextId;
+    info.genreCount = (uint32_t)genreCount;
+    info.recordSize = sizeof(MovieRecord);
+    info.pageShift = MOVIE_PAGE_SHIFT;
+
+    int failed = 0;
+    for (int id = 0; id < genreCount && !failed; id++) {
+        failed = genreIntern(&genres, genreNames[id], strlen(genreNames[id])) != id;
+    }
+    for (size_t i = 0; i < movies->count && !failed; i++) {
+        const MovieRecord* record = storeAt(movies, i);
+        info.stringBytes += movieStringBytes(record);
+        failed = indexPut(&index, record->id, (int)i) < 0 || bitmapAdd(&ids, (uint32_t)record->id) < 0 ||
+                 genreIndexAddMovie(&genres, record->id, movieGenres(record)) < 0;
+    }
+    info.indexCapacity = index.capacity;
+
+    int status = -1;
+    ImageWriter* writer = failed ? NULL : imageCreate(filename, CATALOG_IMAGE_VERSION);
+    if (writer != NULL) {
+        if (imageBeginSection(writer, CATALOG_INFO) == 0 && imageWrite(writer, &info, sizeof(info)) == 0 &&
+            writeCatalogMovies(writer, movies) == 0 && writeCatalogIndexes(writer, &index, &ids, &genres) == 0) {
+            status = imageCommit(writer);
+        } else {
+            imageAbort(writer);
+        }
+    }
+    if (status < 0) {
+        printf("Erro ao gravar a imagem '%s'.\n", filename);
+    }
+    bitmapFree(&ids);
+    genreIndexFree(&genres);
+    indexFree(&index);
+    return status;
+}
+
+/* Lê um gênero da seção de gêneros da imagem a partir de *offset (retorna
+ * -1 se a seção estiver malformada ou faltar memória) */
+static int loadImageGenre(const char* section, size_t length, size_t* offset, int id) {
+    uint32_t nameLength;
+    uint64_t bitmapLength;
+    if (length - *offset < sizeof(nameLength)) {
+        return -1;
+    }
+    memcpy(&nameLength, section + *offset, sizeof(nameLength));
+    *offset += sizeof(nameLength);
+    if (length - *offset < nameLength || genreIntern(&genreIndex, section + *offset, nameLength) != id) {
+        return -1;
+    }
+    *offset += nameLength;
+    if (length - *offset < sizeof(bitmapLength)) {
+        return -1;
+    }
+    memcpy(&bitmapLength, section + *offset, sizeof(bitmapLength));
+    *offset += sizeof(bitmapLength);
+    if (length - *offset < bitmapLength ||
+        bitmapDeserialize(&genreIndex.movies[id], section + *offset, bitmapLength) < 0) {
+        return -1;
+    }
+    *offset += bitmapLength;
+    return 0;
+}
+
+/* Mapeia a imagem do catálogo e passa a usar seus registros, strings e
+ * índice de IDs onde estão, sem copiá-los; só os bitmaps são copiados
+ * (retorna -1 se o arquivo não existe; uma imagem inválida encerra o
+ * servidor, em vez de recomeçar de um catálogo errado) */
+int loadCatalogImage(const char* filename) {
+    if (imageOpen(&catalogImage, filename) < 0) {
+        if (errno == ENOENT) {
+            return -1;
+        }
+        fprintf(stderr, "Imagem '%s' ilegível ou corrompida: %s\n", filename, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    size_t infoLength, recordsLength, stringsLength, indexLength, idsLength, genresLength;
+    CatalogInfo* info = imageSection(&catalogImage, CATALOG_INFO, &infoLength);
+    char* records = imageSection(&catalogImage, CATALOG_RECORDS, &recordsLength);
+    char* strings = imageSection(&catalogImage, CATALOG_STRINGS, &stringsLength);
+    IndexEntry* entries = imageSection(&catalogImage, CATALOG_ID_INDEX, &indexLength);
+    const char* ids = imageSection(&catalogImage, CATALOG_MOVIE_IDS, &idsLength);
+    const char* genres = imageSection(&catalogImage, CATALOG_GENRES, &genresLength);
+
+    int valid = catalogImage.version == CATALOG_IMAGE_VERSION && info != NULL && infoLength == sizeof(CatalogInfo) &&
+                records != NULL && strings != NULL && entries != NULL && ids != NULL && genres != NULL &&
+                info->recordSize == sizeof(MovieRecord) && info->pageShift == MOVIE_PAGE_SHIFT &&
+                info->movieCount <= MAX_MOVIES && info->nextId > 0;
+    if (valid) {
+        size_t pages = (info->movieCount + ((size_t)1 << MOVIE_PAGE_SHIFT) - 1) >> MOVIE_PAGE_SHIFT;
+        valid = recordsLength == pages * storePageStride(&movieList) &&
+                (info->indexCapacity & (info->indexCapacity - 1)) == 0 &&
+                info->indexCapacity >= 2 * info->movieCount &&
+                indexLength == sizeof(IndexEntry) * info->indexCapacity;
+    }
+    if (valid) {
+        valid = storeAttach(&movieList, records, info->movieCount) == 0 &&
+                arenaAttach(&movieStrings, strings, stringsLength, info->stringBytes) == 0 &&
+                bitmapDeserialize(&movieIds, ids, idsLength) == 0;
+        indexAttach(&movieIndex, entries, info->indexCapacity, info->movieCount);
+    }
+    size_t offset = 0;
+    for (uint32_t id = 0; valid && id < info->genreCount; id++) {
+        valid = loadImageGenre(genres, genresLength, &offset, (int)id) == 0;
+    }
+    if (!valid || offset != genresLength) {
+        fprintf(stderr, "Imagem '%s' com conteúdo inválido.\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    movieCount = (int)info->movieCount;
+    nextMovieId = info->nextId;
+    printf("Carregados %d filmes da imagem '%s'.\n", movieCount, filename);
+    return 0;
+}
+
+/* Serializa um filme como payload de registro do log: ID e ano (4 bytes
+ * cada) seguidos de título, diretor e gêneros (2 bytes de tamanho + bytes).
+ * out deve ter espaço para um Movie inteiro. */
+uint32_t encodeMovieRecord(const Movie* movie, char* out) {
+    uint32_t id = htonl((uint32_t)movie->id);
+    uint32_t year = htonl((uint32_t)movie->year);
+    memcpy(out, &id, 4);
+    memcpy(out + 4, &year, 4);
+
+    uint32_t offset = 8;
+    const char* strings[] = { movie->title, movie->director, movie->genres };
+    for (int i = 0; i < 3; i++) {
+        uint16_t length = (uint16_t)strlen(strings[i]);
+        uint16_t netLength = htons(length);
+        memcpy(out + offset, &netLength, 2);
+        memcpy(out + offset + 2, strings[i], length);
+        offset += 2 + length;
+    }
+    return offset;
+}
+
+/* Lê um filme de um payload do log (retorna -1 se estiver malformado) */
+int decodeMovieRecord(const char* payload, uint32_t length, Movie* movie) {
+    if (length < 8) {
+        return -1;
+    }
+    uint32_t id, year;
+    memcpy(&id, payload, 4);
+    memcpy(&year, payload + 4, 4);
+    movie->id = (int)ntohl(id);
+    movie->year = (int)ntohl(year);
+
+    uint32_t offset = 8;
+    char* strings[] = { movie->title, movie->director, movie->genres };
+    size_t sizes[] = { sizeof(movie->title), sizeof(movie->director), sizeof(movie->genres) };
+    for (int i = 0; i < 3; i++) {
+        uint16_t netLength;
+        if (length - offset < 2) {
+            return -1;
+        }
+        memcpy(&netLength, payload + offset, 2);
+        uint16_t fieldLength = ntohs(netLength);
+        offset += 2;
+        if (fieldLength >= sizes[i] || fieldLength > length - offset) {
+            return -1;
+        }
+        memcpy(strings[i], payload + offset, fieldLength);
+        strings[i][fieldLength] = '\0';
+        offset += fieldLength;
+    }
+    return 0;
+}
+
+/* Gerar um novo ID para um filme */
+int generateNewId() {
+    // O contador fica acima do maior ID já visto, mesmo que o filme tenha
+    // sido removido; appendMovie o avança quando o filme entra no array
+    return nextMovieId;
+}
+
+/* Buscar índice de filme no array pelo ID (retorna -1 se não encontrar) */
+int findMovieIndexById(int id) {
+    return indexFind(&movieIndex, id);
+}
+
+
+/* Anexa ao log o estado completo de um filme, antes de alterá-lo na
+ * memória, e devolve em *lsn a posição a esperar antes de responder
+ * (retorna -1 se não foi possível gravar). Deve ser chamada com o lock de
+ * escrita de movieLock, para o log seguir a ordem das mutações. */
+int logMovie(const Movie* movie, uint64_t* lsn) {
+    char payload[sizeof(Movie) + 8];
+    uint32_t length = encodeMovieRecord(movie, payload);
+    if (walAppend(movieLog, LOG_PUT_MOVIE, payload, length, lsn) < 0) {
+        perror("Erro ao gravar no log");
+        return -1;
+    }
+    if (walSize(movieLog) >= COMPACTION_BYTES) {
+        pthread_cond_signal(&compactionWake);
+    }
+    return 0;
+}
+
+/* Anexa ao log a remoção de um filme. Deve ser chamada com o lock de
+ * escrita de movieLock. */
+int logRemoval(int id, uint64_t* lsn) {
+    uint32_t netId = htonl((uint32_t)id);
+    if (walAppend(movieLog, LOG_REMOVE_MOVIE, &netId, sizeof(netId), lsn) < 0) {
+        perror("Erro ao gravar no log");
+        return -1;
+    }
+    return 0;
+}
+
+/* Reaplica um registro do log sobre movieList. Os registros levam o estado
+ * final de cada filme, então reaplicá-los sobre um snapshot que já os
+ * contém não muda o resultado. */
+void applyLogRecord(uint8_t type, const char* payload, uint32_t length, void* arg) {
+    (void)arg;
+    if (type == LOG_PUT_MOVIE) {
+        Movie movie;
+        if (decodeMovieRecord(payload, length, &movie) < 0) {
+            return;
+        }
+        int index = findMovieIndexById(movie.id);
+        if (index >= 0) {
+            replaceMovieAt(index, &movie);
+        } else {
+            appendMovie(&movie);
+        }
+    } else if (type == LOG_REMOVE_MOVIE && length == 4) {
+        uint32_t netId;
+        memcpy(&netId, payload, 4);
+        int id = (int)ntohl(netId);
+        int index = findMovieIndexById(id);
+        if (index >= 0) {
+            removeMovieAt(index);
+        }
+        // O ID removido não volta a ser gerado
+        if (id >= nextMovieId) {
+            nextMovieId = id + 1;
+        }
+    }
+}
+
+/* Carrega a imagem do catálogo (ou, na primeira vez, importa o CSV) e
+ * reaplica os logs posteriores a ela. Se havia log ou a imagem ainda não
+ * existia, grava uma imagem nova e começa um log vazio. */
+void loadMovies(const ServerConfig* config) {
+    if (storeInit(&movieList, sizeof(MovieRecord), MOVIE_PAGE_SHIFT, MAX_MOVIES) < 0 ||
+        arenaInit(&movieStrings, MAX_STRING_BYTES) < 0 ||
+        indexInit(&movieIndex, INITIAL_INDEX_SIZE) < 0 || genreIndexInit(&genreIndex) < 0 ||
+        cacheInit(&responseCache, CACHE_MAX_ENTRIES, CACHE_MAX_BYTES) < 0) {
+        perror("Erro ao criar o índice de filmes");
+        exit(EXIT_FAILURE);
+    }
+    bitmapInit(&movieIds);
+    int loaded = loadCatalogImage(IMAGE_FILE_NAME) == 0;
+    if (!loaded) {
+        loadMoviesFromCSV(CSV_FILE_NAME, config->cpuCount);
+    }
+
+    // Um log em compactação só sobra se o servidor caiu antes de gravar o
+    // snapshot; ele é anterior ao log atual
+    long records = 0;
+    const char* logs[] = { WAL_OLD_FILE_NAME, WAL_FILE_NAME };
+    for (int i = 0; i < 2; i++) {
+        long replayed = walReplay(logs[i], applyLogRecord, NULL);
+        if (replayed > 0) {
+            records += replayed;
+        }
+    }
+
+    if (records > 0) {
+        printf("Reaplicados %ld registros do log.\n", records);
+    }
+    if (records > 0 || !loaded) {
+        if (saveCatalogImage(IMAGE_FILE_NAME, &movieList, nextMovieId, genreIndex.names, genreIndex.count) == 0) {
+            unlink(WAL_OLD_FILE_NAME);
+            unlink(WAL_FILE_NAME);
+        }
+    }
+
+    movieLog = walOpen(WAL_FILE_NAME, config->commitWindow, config->commitBytes);
+    if (movieLog == NULL) {
+        perror("Erro ao abrir o log");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Grava uma imagem nova do catálogo e descarta o log que ela incorpora. O
+ * log é trocado por um vazio junto com a criação de um snapshot dos filmes,
+ * gravado depois fora do lock. Os nomes dos gêneros não mudam depois de
+ * internados: basta copiar a lista de ponteiros. Basta o lock de leitura:
+ * ele já exclui as escritas, únicas a anexar ao log, sem parar as outras
+ * leituras. */
+void compactMovies() {
+    PagedStore snapshot;
+
+    lockUse.option = STATS_COMPACTION;
+    lockCatalog(0);
+    if (storeSnapshot(&snapshot, &movieList) < 0) {
+        unlockCatalog();
+        return;
+    }
+    int nextId = nextMovieId;
+    int genreCount = genreIndex.count;
+    char** genreNames = malloc(sizeof(char*) * (genreCount > 0 ? genreCount : 1));
+    if (genreNames == NULL) {
+        unlockCatalog();
+        storeFree(&snapshot);
+        return;
+    }
+    memcpy(genreNames, genreIndex.names, sizeof(char*) * genreCount);
+    // Se uma compactação anterior falhou, o log antigo ainda existe e não
+    // pode ser sobrescrito; o snapshot desta já cobre os dois logs. Nos
+    // dois casos, tudo o que está no snapshot precisa estar no disco.
+    int rotated = access(WAL_OLD_FILE_NAME, F_OK) == 0 ? walSync(movieLog) == 0
+                                                        : walRotate(movieLog, WAL_OLD_FILE_NAME) == 0;
+    unlockCatalog();
+
+    if (rotated && saveCatalogImage(IMAGE_FILE_NAME, &snapshot, nextId, genreNames, genreCount) == 0) {
+        unlink(WAL_OLD_FILE_NAME);
+    }
+    free(genreNames);
+    storeFree(&snapshot);
+}
+
+/* Thread de compactação: a cada COMPACTION_INTERVAL segundos, ou antes se o
+ * log passar de COMPACTION_BYTES, incorpora o log a um snapshot novo */
+void* compactionLoop(void* arg) {
+    (void)arg;
+    while (1) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += COMPACTION_INTERVAL;
+
+        pthread_mutex_lock(&compactionLock);
+        pthread_cond_timedwait(&compactionWake, &compactionLock, &deadline);
+        pthread_mutex_unlock(&compactionLock);
+
+        if (walSize(movieLog) > 0) {
+            compactMovies();
+        }
+    }
+    return NULL;
+}
+
+/* Thread de estatísticas: imprime as estatísticas do servidor a cada
+ * SIGUSR1 (ex.: kill -USR1 <pid>), bloqueado nas outras threads */
+void* statsSignalLoop(void* arg) {
+    (void)arg;
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+
+    char text[RESPONSE_SIZE];
+    while (1) {
+        int received;
+        if (sigwait(&signals, &received) == 0) {
+            statsFormat(&serverStats, text, sizeof(text));
+            fputs(text, stdout);
+            fflush(stdout);
+        }
+    }
+    return NULL;
+}
+
+
+/* Cache de respostas */
+/* Monta a chave da resposta de uma opção no cache (argumento: ID ou
+ * gênero) */
+void responseCacheKey(char* key, int option, const char* argument) {
+    snprintf(key, CACHE_KEY_SIZE, "%d:%s", option, argument);
+}
+
+/* Só buscas por um único gênero, escrito exatamente como foi cadastrado,
+ * ficam no cache: são as que uma mudança de filme sabe atualizar */
+int isCacheableGenre(const char* genre) {
+    size_t length = strlen(genre);
+    return length > 0 && strpbrk(genre, "&|") == NULL &&
+           !isspace((unsigned char)genre[0]) && !isspace((unsigned char)genre[length - 1]);
+}
+
+/* Retorna 1 se o gênero [item, item + length) já aparece antes na lista */
+int genreSeenBefore(const char* genres, const char* item, size_t length) {
+    while (genres < item) {
+        const char* separator = strchr(genres, GENRE_SEPARATOR);
+        if ((size_t)(separator - genres) == length && memcmp(genres, item, length) == 0) {
+            return 1;
+        }
+        genres = separator + 1;
+    }
+    return 0;
+}
+
+/* Acrescenta line à busca de cada gênero da lista ou, com line NULL,
+ * descarta essas buscas do cache */
+void updateGenreListings(const char* genres, const char* line, size_t lineLength) {
+    char key[CACHE_KEY_SIZE];
+    char genre[100];    // Como na busca: gêneros maiores nunca são buscados
+    const char* item = genres;
+    while (*item != '\0') {
+        const char* separator = strchr(item, GENRE_SEPARATOR);
+        size_t length = separator != NULL ? (size_t)(separator - item) : strlen(item);
+
+        if (length > 0 && length < sizeof(genre) && !genreSeenBefore(genres, item, length)) {
+            memcpy(genre, item, length);
+            genre[length] = '\0';
+            responseCacheKey(key, 7, genre);
+            if (line != NULL) {
+                cacheAppend(&responseCache, key, line, lineLength);
+            } else {
+                cacheInvalidate(&responseCache, key);
+            }
+        }
+        item += length + (separator != NULL);
+    }
+}
+
+/* Atualiza o cache após o cadastro de um filme. Ele entra no fim do array
+ * e tem o maior ID, então as listagens completas e as dos seus gêneros só
+ * ganham sua linha no fim. Deve ser chamada com o lock de escrita. */
+void cacheMovieAdded(const MovieRecord* record) {
+    OutputBuffer ids = { 0 };
+    OutputBuffer info = { 0 };
+    if (appendMovieLine(4, record, &ids) < 0 || appendMovieLine(5, record, &info) < 0) {
+        // Sem memória para a linha: descarta o que ficaria incompleto
+        cacheInvalidate(&responseCache, "4:");
+        cacheInvalidate(&responseCache, "5:");
+        updateGenreListings(movieGenres(record), NULL, 0);
+    } else {
+        cacheAppend(&responseCache, "4:", ids.data, ids.length);
+        cacheAppend(&responseCache, "5:", info.data, info.length);
+        updateGenreListings(movieGenres(record), info.data, info.length);
+    }
+    outputFree(&ids);
+    outputFree(&info);
+}
+
+/* Descarta do cache as respostas que mostram o filme com o ID e a lista de
+ * gêneros dados (a listagem de títulos só muda se ele for removido). Deve
+ * ser chamada com o lock de escrita. */
+void cacheMovieChanged(int id, const char* genres, int removed) {
+    char key[CACHE_KEY_SIZE];
+    char idText[16];
+    snprintf(idText, sizeof(idText), "%d", id);
+    responseCacheKey(key, 6, idText);
+    cacheInvalidate(&responseCache, key);
+    if (removed) {
+        cacheInvalidate(&responseCache, "4:");
+    }
+    cacheInvalidate(&responseCache, "5:");
+    updateGenreListings(genres, NULL, 0);
+}
+
+
+/* Funções para operações de usuário */
+/* (1) Cadastrar um novo filme */
+void registerMovie(
+    const char* title,
+    const char* director,
+    int year,
+    const char* genres,
+    char* response,
+    uint64_t* lsn
+) {
+    if (movieCount >= MAX_MOVIES) {
+        sprintf(response, "Erro: Limite de filmes atingido!\n");
+        return;
+    }
+
+    // Gera ID para o filme
+    int newId = generateNewId();
+
+    Movie movie;
+    movie.id = newId;
+    strcpy(movie.title, title);
+    strcpy(movie.director, director);
+    movie.year = year;
+    strcpy(movie.genres, genres);
+
+    // Grava no log antes de adicionar o filme ao array
+    if (logMovie(&movie, lsn) < 0) {
+        sprintf(response, "Erro: não foi possível gravar o filme.\n");
+        return;
+    }
+    if (appendMovie(&movie) < 0) {
+        // O cadastro já está no log: uma remoção o desfaz na releitura, e o
+        // ID não volta a ser gerado
+        logRemoval(newId, lsn);
+        nextMovieId = newId + 1;
+        sprintf(response, "Erro: memória insuficiente para o filme.\n");
+        return;
+    }
+    cacheMovieAdded(movieAt(movieCount - 1));
+
+    sprintf(response, "Filme cadastrado com sucesso! ID: %d\n", newId);
+}
+
+/* (2) Adicionar um novo gênero a um filme */
+void addGenreToMovie(int id, const char* newGenre, char* response, uint64_t* lsn) {
+    // Recupera o index do filme no array
+    int index = findMovieIndexById(id);
+
+    if (index == -1) {
+        // Se não encontrar o filme no array, retorna erro
+        sprintf(response, "Erro: Filme com ID %d não encontrado.\n", id);
+        return;
+    }
+
+    // O gênero é um item da lista: não pode conter o separador
+    size_t genreLength = strlen(newGenre);
+    if (genreLength == 0 || strchr(newGenre, GENRE_SEPARATOR) != NULL) {
+        sprintf(response, "Erro: Gênero inválido.\n");
+        return;
+    }
+    if (hasGenre(movieAt(index), newGenre, genreLength)) {
+        sprintf(response, "Filme ID %d já tem o gênero '%s'.\n", id, newGenre);
+        return;
+    }
+
+    // Adiciona o novo gênero ao fim da lista, em uma cópia do filme
+    Movie movie;
+    readMovie(movieAt(index), &movie);
+    size_t length = strlen(movie.genres);
+    if (length + (length > 0) + genreLength >= sizeof(movie.genres)) {
+        sprintf(response, "Erro: Lista de gêneros do filme ID %d está cheia.\n", id);
+        return;
+    }
+    if (length > 0) {
+        // Se já tem algum gênero, adiciona ponto e vírgula antes
+        strcat(movie.genres, ";");
+    }
+    strcat(movie.genres, newGenre);
+
+    // Grava no log antes de alterar o array
+    if (logMovie(&movie, lsn) < 0) {
+        sprintf(response, "Erro: não foi possível gravar o filme.\n");
+        return;
+    }
+    if (replaceMovieAt(index, &movie) < 0) {
+        // O filme não mudou: o log volta ao estado que ficou na memória
+        Movie current;
+        readMovie(movieAt(index), &current);
+        logMovie(&current, lsn);
+        sprintf(response, "Erro: memória insuficiente para o filme.\n");
+        return;
+    }
+    // A lista nova contém os gêneros antigos e o novo
+    cacheMovieChanged(id, movie.genres, 0);
+
+    sprintf(response, "Gênero '%s' adicionado ao filme ID %d.\n", newGenre, id);
+}
+
+/* (3) Remover um filme pelo identificador */
+void removeMovie(int id, char* response, uint64_t* lsn) {
+    // Recupera o index do filme no array
+    int index = findMovieIndexById(id);
+
+    if (index == -1) {
+        // Se não encontrar o filme no array, retorna erro
+        sprintf(response, "Erro: Filme com ID %d não encontrado.\n", id);
+        return;
+    }
+
+    // Grava a remoção no log antes de alterar o array
+    if (logRemoval(id, lsn) < 0) {
+        sprintf(response, "Erro: não foi possível remover o filme.\n");
+        return;
+    }
+
+    // As respostas que mostram o filme saem do cache antes que seus gêneros
+    // sejam descartados
+    cacheMovieChanged(id, movieGenres(movieAt(index)), 1);
+
+    // "Remove" o filme do array copiando o último filme do array para a posição
+    // do filme removido e decrementando o contador de filmes do array
+    if (removeMovieAt(index) < 0) {
+        // O filme continua na memória: regravá-lo no log desfaz a remoção
+        Movie current;
+        readMovie(movieAt(index), &current);
+        logMovie(&current, lsn);
+        sprintf(response, "Erro: memória insuficiente para remover o filme.\n");
+        return;
+    }
+
+    sprintf(response, "Filme com ID %d removido com sucesso.\n", id);
+}
+
+/* Bytes de texto do frame em montagem */
+static inline size_t outputText(const OutputBuffer* out) {
+    return out->length - FRAME_HEADER_SIZE;
+}
+
+/* Parte de uma listagem em ordem de ID em montagem */
+typedef struct {
+    ResponseStream* stream;
+    OutputBuffer* out;
+    int failed;         // Faltou memória
+    int pageFull;       // A página acabou e ainda há filmes depois dela
+} ListChunk;
+
+/* Acrescenta à parte o filme com o ID dado */
+int appendListedMovie(uint32_t id, void* arg) {
+    ListChunk* chunk = arg;
+    ResponseStream* stream = chunk->stream;
+    if (outputText(chunk->out) >= STREAM_CHUNK_SIZE) {
+        // Parte cheia: a próxima recomeça deste ID
+        return 1;
+    }
+
+    // Filmes removidos depois da abertura da listagem são pulados
+    int index = findMovieIndexById((int)id);
+    if (index >= 0) {
+        if (stream->paged && stream->pageRemaining == 0) {
+            chunk->pageFull = 1;
+            return 1;
+        }
+        if (appendMovieLine(stream->option, movieAt(index), chunk->out) < 0) {
+            chunk->failed = 1;
+            return 1;
+        }
+        stream->pageRemaining--;
+        stream->lastId = (int)id;
+    }
+    stream->position = (uint64_t)id + 1;
+    return 0;
+}
+
+/* Gera uma parte da listagem em ordem de ID. Cada parte lê os filmes com o
+ * lock de leitura e recomeça do ID seguinte ao último listado, então
+ * remoções entre as partes (que movem o último filme do array para a posição
+ * do removido) não pulam nem repetem filmes. No fim de uma página com mais
+ * filmes depois dela, acrescenta o cursor da próxima. */
+int listMoviesInIdOrder(ResponseStream* stream, OutputBuffer* out) {
+    ListChunk chunk = { stream, out, 0, 0 };
+    lockCatalog(0);
+    int stopped = bitmapForEachFrom(stream->ids, (uint32_t)stream->position, appendListedMovie, &chunk);
+    unlockCatalog();
+
+    if (chunk.failed) {
+        return 0;
+    }
+    if (chunk.pageFull) {
+        outputPrintf(out, "Próximo cursor: %d\n", stream->lastId);
+        return 0;
+    }
+    return stopped;
+}
+
+/* As listagens (4, 5 e 7) geram uma parte por chamada, de cerca de
+ * STREAM_CHUNK_SIZE bytes, continuando de onde a anterior parou. Retornam 1
+ * se ainda há filmes a listar. */
+
+/* (4) Listar todos os títulos de filmes com seus identificadores, a partir
+ * de um snapshot do catálogo ou, paginada, em ordem de ID */
+int listAllMoviesIds(ResponseStream* stream, OutputBuffer* out) {
+    const PagedStore* movies = &stream->snapshot;
+
+    // Prepara a resposta com os títulos e IDs dos filmes
+    if (!stream->started) {
+        stream->started = 1;
+        if (outputPrintf(out, "Lista de Filmes (ID - Título):\n") < 0) {
+            return 0;
+        }
+    }
+    if (stream->paged) {
+        return listMoviesInIdOrder(stream, out);
+    }
+    while (stream->position < movies->count && outputText(out) < STREAM_CHUNK_SIZE) {
+        if (appendMovieLine(4, storeAt(movies, stream->position++), out) < 0) {
+            return 0;
+        }
+    }
+    return stream->position < movies->count;
+}
+
+/* (5) Listar informações de todos os filmes, a partir de um snapshot do
+ * catálogo ou, paginada, em ordem de ID */
+int listAllMoviesInfo(ResponseStream* stream, OutputBuffer* out) {
+    const PagedStore* movies = &stream->snapshot;
+
+    if (!stream->started) {
+        stream->started = 1;
+        if (outputPrintf(out, "Informações de Todos os Filmes:\n") < 0) {
+            return 0;
+        }
+    }
+    if (stream->paged) {
+        return listMoviesInIdOrder(stream, out);
+    }
+    while (stream->position < movies->count && outputText(out) < STREAM_CHUNK_SIZE) {
+        if (appendMovieLine(5, storeAt(movies, stream->position++), out) < 0) {
+            return 0;
+        }
+    }
+    return stream->position < movies->count;
+}
+
+/* (6) Listar informações de um filme específico (retorna -1 se não o
+ * encontrar) */
+int listMovieById(int id, char* response) {
+    // Recupera o index do filme no array
+    int index = findMovieIndexById(id);
+
+    if (index == -1) {
+        // Se não encontrar o filme no array, retorna erro
+        sprintf(response, "Erro: Filme com ID %d não encontrado.\n", id);
+        return -1;
+    }
+
+    // Prepara a resposta com as informações do filme
+    const MovieRecord* record = movieAt(index);
+    sprintf(response, "Informações do Filme (ID %d):\nTítulo: %s\nDiretor: %s\nAno: %d\nGêneros: %s\n",
+            record->id,
+            movieTitle(record),
+            movieDirector(record),
+            record->year,
+            movieGenres(record));
+    return 0;
+}
+
+/* (7) Listar todos os filmes de um determinado gênero. Os IDs encontrados
+ * foram calculados na abertura da listagem. */
+int listMoviesByGenre(ResponseStream* stream, OutputBuffer* out) {
+    if (!stream->started) {
+        stream->started = 1;
+        if (outputPrintf(out, "Filmes do gênero buscado:\n") < 0) {
+            return 0;
+        }
+    }
+    return listMoviesInIdOrder(stream, out);
+}
+
+
+/* Montagem e execução de requisições */
+/* Copia src para dest, truncando ao tamanho do destino */
+void copyTruncated(char* dest, size_t size, const char* src) {
+    size_t length = strnlen(src, size - 1);
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+}
+
+/* Lê um campo numérico opcional: vazio vale 0 (retorna -1 se não for um
+ * inteiro entre 0 e INT_MAX) */
+int parseOptionalNumber(const char* text, long* value) {
+    *value = 0;
+    if (text[0] == '\0') {
+        return 0;
+    }
+
+    char* end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (errno != 0 || *end != '\0' || parsed < 0 || parsed > INT_MAX) {
+        return -1;
+    }
+    *value = parsed;
+    return 0;
+}
+
+/* Extrai a próxima requisição completa dos bytes acumulados no parser,
+ * cujos últimos bytes chegaram em receivedAt (statsNow). Campos ausentes
+ * ficam vazios e campos longos são truncados. */
+RequestState nextRequest(FrameParser* parser, uint64_t receivedAt, Request* request) {
+    FrameHeader header;
+    const char* payload;
+
+    FrameStatus status = frameParserNext(parser, &header, &payload);
+    if (status == FRAME_INCOMPLETE) {
+        return REQUEST_INCOMPLETE;
+    }
+    if (status == FRAME_INVALID) {
+        statsCountInvalidFrame(&serverStats);
+        return REQUEST_INVALID;
+    }
+
+    request->option = header.opcode;
+    request->requestId = header.requestId;
+    request->receivedAt = receivedAt;
+    request->bytes = FRAME_HEADER_SIZE + header.length;
+    if (request->option == 0) {
+        return REQUEST_CLOSE;
+    }
+
+    FrameField fields[FRAME_MAX_FIELDS];
+    int fieldCount = decodeFields(payload, header.length, fields, FRAME_MAX_FIELDS);
+    if (fieldCount < 0) {
+        statsCountInvalidFrame(&serverStats);
+        return REQUEST_INVALID;
+    }
+
+    request->fieldCount = fieldCount;
+    for (int i = 0; i < FRAME_MAX_FIELDS; i++) {
+        char* field = request->fields[i];
+        int copyLength = 0;
+        if (i < fieldCount) {
+            copyLength = fields[i].length < FIELD_SIZE - 1 ? fields[i].length : FIELD_SIZE - 1;
+            memcpy(field, fields[i].data, copyLength);
+        }
+        field[copyLength] = '\0';
+    }
+
+    return REQUEST_READY;
+}
+
+/* Registra a listagem nas estatísticas e a libera com o que ela fixou */
+void closeResponseStream(ResponseStream* stream) {
+    // Uma listagem que não chegou a ser aberta já foi registrada como
+    // resposta curta
+    if (stream->bytesIn > 0) {
+        statsRecordRequest(&serverStats, stream->option, &stream->timing, stream->bytesIn,
+                           stream->bytesOut, !stream->done);
+    }
+    storeFree(&stream->snapshot);
+    bitmapFree(&stream->matches);
+    outputFree(&stream->output);
+    outputFree(&stream->capture);
+    if (stream->cached != NULL) {
+        cacheRelease(stream->cached);
+    }
+    free(stream);
+}
+
+/* Abre a listagem de uma requisição das opções 4, 5 ou 7. Os campos
+ * opcionais tamanho da página e cursor (depois do gênero, na opção 7)
+ * pedem uma só página, em ordem de ID, a partir do filme seguinte ao
+ * cursor; o cursor é o valor devolvido no fim da página anterior. O lock de
+ * leitura só é usado aqui: para fixar um snapshot do catálogo (4 e 5
+ * completas) ou calcular os IDs dos filmes do gênero (7). Se a resposta
+ * cabe em uma mensagem curta (catálogo vazio, nenhum filme do gênero ou
+ * erro), escreve em response e retorna NULL. */
+ResponseStream* openResponseStream(const Request* request, char* response) {
+    int pageField = request->option == 7 ? 1 : 0;
+    long pageSize, cursor;
+    if (parseOptionalNumber(request->fields[pageField], &pageSize) < 0) {
+        sprintf(response, "Erro: tamanho de página inválido.\n");
+        return NULL;
+    }
+    if (parseOptionalNumber(request->fields[pageField + 1], &cursor) < 0) {
+        sprintf(response, "Erro: cursor inválido.\n");
+        return NULL;
+    }
+
+    ResponseStream* stream = calloc(1, sizeof(ResponseStream));
+    if (stream == NULL) {
+        sprintf(response, "Erro: memória insuficiente para a listagem.\n");
+        return NULL;
+    }
+    stream->option = request->option;
+    stream->requestId = request->requestId;
+    bitmapInit(&stream->matches);
+
+    // Sem tamanho de página, um cursor lista todos os filmes depois dele
+    stream->paged = pageSize > 0 || request->fields[pageField + 1][0] != '\0';
+    stream->pageRemaining = pageSize > 0 ? pageSize : LONG_MAX;
+    if (stream->paged) {
+        stream->position = (uint64_t)cursor + 1;
+        stream->lastId = (int)cursor;
+    }
+
+    char genre[100];
+    copyTruncated(genre, sizeof(genre), request->fields[0]);
+
+    // Listagem completa já gerada: servida do cache, sem o lock do catálogo
+    if (!stream->paged && (request->option != 7 || isCacheableGenre(genre))) {
+        responseCacheKey(stream->cacheKey, request->option, request->option == 7 ? genre : "");
+        stream->cached = cacheAcquire(&responseCache, stream->cacheKey, &stream->cachedLength);
+        if (stream->cached != NULL) {
+            return stream;
+        }
+    }
+
+    lockCatalog(0);
+    int empty = movieCount == 0;
+    int status = 0;
+    if (!empty && request->option == 7) {
+        status = genreIndexQuery(&genreIndex, genre, &stream->matches);
+        stream->ids = &stream->matches;
+    } else if (!empty && stream->paged) {
+        // Lê o conjunto vivo de IDs a cada parte, com o lock de leitura
+        stream->ids = &movieIds;
+    } else if (!empty) {
+        status = storeSnapshot(&stream->snapshot, &movieList);
+    }
+    // A listagem só vai para o cache se nada mudar até ela terminar
+    stream->cacheGeneration = cacheGeneration(&responseCache);
+    unlockCatalog();
+
+    if (empty) {
+        // Se não há filmes cadastrados, retorna mensagem apropriada
+        strcpy(response, "Nenhum filme cadastrado.\n");
+    } else if (status < 0) {
+        sprintf(response, "Erro: memória insuficiente para a listagem.\n");
+    } else if (request->option == 7 && bitmapCardinality(&stream->matches) == 0) {
+        // Se nenhum filme do gênero for encontrado, retorna mensagem
+        // apropriada
+        strcpy(response, "Filmes do gênero buscado:\nNenhum filme encontrado para esse gênero.\n");
+    } else {
+        return stream;
+    }
+    closeResponseStream(stream);
+    return NULL;
+}
+
+/* Acrescenta o texto do frame gerado à cópia que irá para o cache; uma
+ * listagem grande demais deixa de ser copiada */
+void captureStreamText(ResponseStream* stream) {
+    OutputBuffer* capture = &stream->capture;
+    size_t length = outputText(&stream->output);
+    if (stream->output.failed || capture->length + length > CACHE_CAPTURE_LIMIT ||
+        outputReserve(capture, length) < 0) {
+        stream->cacheKey[0] = '\0';
+        outputFree(capture);
+        return;
+    }
+    memcpy(capture->data + capture->length, stream->output.data + FRAME_HEADER_SIZE, length);
+    capture->length += length;
+}
+
+/* Gera o próximo frame da listagem em stream->output (retorna o tamanho do
+ * frame, ou 0 se a listagem já terminou). Todos os frames menos o último
+ * levam FRAME_FLAG_MORE. Numa listagem do cache, stream->output só recebe
+ * o cabeçalho e o texto é o trecho stream->body do texto em cache. */
+size_t nextStreamFrame(ResponseStream* stream) {
+    OutputBuffer* out = &stream->output;
+    if (stream->done || outputReserve(out, FRAME_HEADER_SIZE) < 0) {
+        return 0;
+    }
+    out->length = FRAME_HEADER_SIZE;
+    uint64_t start = statsNow();
+    lockWaitNanos = 0;
+    lockUse.option = stream->option;
+
+    int more;
+    if (stream->cached != NULL) {
+        size_t remaining = stream->cachedLength - stream->position;
+        stream->body = stream->cached->data + stream->position;
+        stream->bodyLength = remaining;
+        if (remaining > STREAM_CHUNK_SIZE) {
+            // Como nas listagens geradas, cada frame termina no fim de uma linha
+            const char* lineEnd = memrchr(stream->body, '\n', STREAM_CHUNK_SIZE);
+            stream->bodyLength = lineEnd != NULL ? (size_t)(lineEnd - stream->body) + 1 : STREAM_CHUNK_SIZE;
+        }
+        stream->position += stream->bodyLength;
+        more = stream->position < stream->cachedLength;
+    } else {
+        if (stream->option == 4) {
+            more = listAllMoviesIds(stream, out);
+        } else if (stream->option == 5) {
+            more = listAllMoviesInfo(stream, out);
+        } else {
+            more = listMoviesByGenre(stream, out);
+        }
+
+        // Uma listagem completa gerada sem erros vai para o cache
+        if (stream->cacheKey[0] != '\0') {
+            captureStreamText(stream);
+        }
+        if (!more && stream->cacheKey[0] != '\0') {
+            cacheStore(&responseCache, stream->cacheKey, stream->capture.data,
+                       stream->capture.length, stream->cacheGeneration);
+            outputFree(&stream->capture);
+        }
+    }
+
+    stream->done = !more;
+    encodeFrameHeader(out->data, stream->option, more ? FRAME_FLAG_MORE : 0,
+                      stream->requestId, (uint32_t)(outputText(out) + stream->bodyLength));
+    stream->timing.lockWait += lockWaitNanos;
+    stream->timing.execution += statsNow() - start - lockWaitNanos;
+    stream->bytesOut += out->length + stream->bodyLength;
+    return out->length + stream->bodyLength;
+}
+
+/* Executa uma requisição completa, escrevendo a resposta em response. Uma
+ * escrita devolve em *lsn a posição do seu registro no log, que precisa
+ * chegar ao disco antes da resposta ser enviada (0: nada a esperar). Uma
+ * listagem devolve em *stream a resposta a gerar em partes (NULL: a
+ * resposta está em response). */
+void executeRequest(const Request* request, char* response, uint64_t* lsn, ResponseStream** stream) {
+    const char (*fields)[FIELD_SIZE] = request->fields;
+    *lsn = 0;
+    *stream = NULL;
+    response[0] = '\0';
+
+    switch (request->option) {
+        case 1: {
+            // (1) Cadastrar um novo filme
+            char title[100], director[100];
+            copyTruncated(title, sizeof(title), fields[0]);
+            copyTruncated(director, sizeof(director), fields[1]);
+            int year = atoi(fields[2]);
+
+            // Registra o filme com o lock de escrita
+            lockCatalog(1);
+            registerMovie(title, director, year, fields[3], response, lsn);
+            unlockCatalog();
+        } break;
+
+        case 2: {
+            // (2) Adicionar um novo gênero a um filme
+            int id = atoi(fields[0]);
+            char newGenre[100];
+            copyTruncated(newGenre, sizeof(newGenre), fields[1]);
+
+            // Adiciona gênero ao filme com o lock de escrita
+            lockCatalog(1);
+            addGenreToMovie(id, newGenre, response, lsn);
+            unlockCatalog();
+        } break;
+
+        case 3: {
+            // (3) Remover um filme pelo identificador
+            int id = atoi(fields[0]);
+
+            // Remove filme do array com o lock de escrita
+            lockCatalog(1);
+            removeMovie(id, response, lsn);
+            unlockCatalog();
+        } break;
+
+        case 4:
+        case 5: {
+            // (4) Listar todos os títulos de filmes com seus identificadores
+            // ou (5) listar informações de todos os filmes, em partes
+            *stream = openResponseStream(request, response);
+        } break;
+
+        case 6: {
+            // (6) Listar informações de um filme específico
+            int id = atoi(fields[0]);
+            char key[CACHE_KEY_SIZE];
+            char idText[16];
+            snprintf(idText, sizeof(idText), "%d", id);
+            responseCacheKey(key, 6, idText);
+
+            // Resposta já gerada: copiada do cache, sem o lock do catálogo
+            size_t length;
+            CachedText* text = cacheAcquire(&responseCache, key, &length);
+            if (text != NULL) {
+                memcpy(response, text->data, length);
+                response[length] = '\0';
+                cacheRelease(text);
+                break;
+            }
+
+            // Lista as informações do filme com o lock de leitura e guarda a
+            // resposta (nenhuma escrita muda o cache enquanto o lock está
+            // com esta leitura)
+            lockCatalog(0);
+            if (listMovieById(id, response) == 0) {
+                cacheStore(&responseCache, key, response, strlen(response), cacheGeneration(&responseCache));
+            }
+            unlockCatalog();
+        } break;
+
+        case 7: {
+            // (7) Listar todos os filmes de um determinado gênero, em partes
+            *stream = openResponseStream(request, response);
+        } break;
+
+        case 8: {
+            // (8) Estatísticas do servidor, sem o lock do catálogo
+            statsFormat(&serverStats, response, RESPONSE_SIZE);
+        } break;
+
+        default:
+            // Opção inválida
+            sprintf(response, "Opção inválida.\n");
+            break;
+    }
+}
+
+/* Completa o frame de resposta cujo texto já está em frame +
+ * FRAME_HEADER_SIZE (retorna o tamanho do frame) */
+size_t encodeResponseFrame(int option, uint32_t requestId, char* frame) {
+    size_t length = strlen(frame + FRAME_HEADER_SIZE);
+    encodeFrameHeader(frame, option, 0, requestId, (uint32_t)length);
+    return FRAME_HEADER_SIZE + length;
+}
+
+/* Encerra o servidor quando a gravação do log falha. As escritas do lote
+ * perdido já estão no catálogo em memória: continuar serviria, e a
+ * compactação gravaria na imagem, alterações que não estão no log. Sem
+ * resposta, o cliente não sabe se a escrita ficou; ao reiniciar, o
+ * catálogo volta ao que a imagem e o log têm. */
+void stopOnLogFailure() {
+    fprintf(stderr, "Erro: o log não chegou ao disco; encerrando o servidor.\n");
+    _exit(EXIT_FAILURE);
+}
+
+/* Executa a requisição e monta o frame de resposta em frame, que deve ter
+ * RESPONSE_FRAME_SIZE bytes (retorna o tamanho do frame). Com lsn NULL,
+ * espera a escrita chegar ao disco; senão devolve em *lsn o que esperar
+ * antes de enviar a resposta. Uma listagem é devolvida em *stream, e então
+ * nenhum frame é montado (retorna 0). */
+size_t executeRequestFrame(const Request* request, char* frame, uint64_t* lsn, ResponseStream** stream) {
+    char* response = frame + FRAME_HEADER_SIZE;
+    uint64_t writeLsn;
+    RequestTiming timing;
+    uint64_t start = statsNow();
+    timing.queueing = start > request->receivedAt ? start - request->receivedAt : 0;
+    lockWaitNanos = 0;
+    lockUse.option = request->option;
+    executeRequest(request, response, &writeLsn, stream);
+    timing.lockWait = lockWaitNanos;
+    timing.execution = statsNow() - start - lockWaitNanos;
+    if (*stream != NULL) {
+        // Registrada ao terminar, com o tempo de cada parte
+        (*stream)->timing = timing;
+        (*stream)->bytesIn = request->bytes;
+        return 0;
+    }
+
+    if (lsn != NULL) {
+        *lsn = writeLsn;
+    } else if (writeLsn > 0 && walWaitDurable(movieLog, writeLsn) < 0) {
+        stopOnLogFailure();
+    }
+    size_t length = encodeResponseFrame(request->option, request->requestId, frame);
+    int failed = strncmp(response, "Erro", 4) == 0 || request->option < 1 || request->option > STATS_MAX_OPTION;
+    statsRecordRequest(&serverStats, request->option, &timing, request->bytes, length, failed);
+    return length;
+}
+
+
+/* Sockets de escuta */
+/* Cria um socket de escuta na porta. Com reusePort, vários sockets dividem
+ * a mesma porta e o kernel distribui as conexões entre eles; incomingCpu
+ * (>= 0) pede ao kernel conexões que chegaram por essa CPU. */
+int createListenSocket(int port, int backlog, int reusePort, int incomingCpu) {
+    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (serverSocket < 0) {
+        perror("Erro ao criar socket");
+        return -1;
+    }
+
+    int one = 1;
+    if (reusePort && setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        perror("Erro no SO_REUSEPORT");
+        close(serverSocket);
+        return -1;
+    }
+    if (incomingCpu >= 0 &&
+        setsockopt(serverSocket, SOL_SOCKET, SO_INCOMING_CPU, &incomingCpu, sizeof(incomingCpu)) < 0) {
+        // Só uma preferência: segue sem a afinidade
+        perror("Aviso: SO_INCOMING_CPU");
+    }
+
+    // Configura endereço do servidor
+    struct sockaddr_in serverAddr;
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    serverAddr.sin_port = htons(port);
+
+    // Faz bind
+    if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+        perror("Erro no bind");
+        close(serverSocket);
+        return -1;
+    }
+
+    // Escuta
+    if (listen(serverSocket, backlog) < 0) {
+        perror("Erro no listen");
+        close(serverSocket);
+        return -1;
+    }
+
+    return serverSocket;
+}
+
+/* Fixa a thread atual em uma CPU (cpu < 0 não fixa) */
+void pinThreadToCpu(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (result != 0) {
+        fprintf(stderr, "Aviso: não foi possível fixar a thread na CPU %d: %s\n", cpu, strerror(result));
+    }
+}
+
+/* Desliga o algoritmo de Nagle no socket de um cliente: com pipelining, as
+ * respostas saem em vários sends pequenos e não devem esperar o ACK */
+void setNoDelay(int clientSocket) {
+    int one = 1;
+    setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/* CPU da i-ésima thread de aceitação (-1 se as threads não são fixadas) */
+int cpuForThread(const ServerConfig* config, int index) {
+    if (config->acceptors <= 1) {
+        return -1;
+    }
+    return index % config->cpuCount;
+}
+
+
+/* Modo thread por cliente */
+/* Envia todo o buffer por um socket bloqueante, com flags extras do send
+ * (retorna -1 em caso de erro) */
+int sendAll(int clientSocket, const char* data, size_t length, int flags) {
+    while (length > 0) {
+        ssize_t sent = send(clientSocket, data, length, MSG_NOSIGNAL | flags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+/* Trata cada cliente em uma thread, com recv() bloqueante */
+void* handleClient(void* arg) {
+    int clientSocket = *((int*)arg);
+    free(arg); // Liberar memória alocada para o socket do cliente
+
+    char buffer[BUFFER_SIZE];
+    char frame[RESPONSE_FRAME_SIZE]; // para respostas mais extensas
+    FrameParser parser;
+    frameParserInit(&parser);
+    Request request;
+    int connected = 1;
+
+    while (connected) {
+        // Lê o que chegar; um recv pode trazer parte de um frame ou vários
+        int bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
+        if (bytesRead <= 0) {
+            // Cliente desconectou ou ocorreu erro
+            printf("Cliente desconectado.\n");
+            break;
+        }
+        if (frameParserFeed(&parser, buffer, bytesRead) < 0) {
+            break;
+        }
+
+        RequestState state;
+        uint64_t receivedAt = statsNow();
+        while (connected && (state = nextRequest(&parser, receivedAt, &request)) != REQUEST_INCOMPLETE) {
+            if (state == REQUEST_CLOSE) {
+                // (0) Cliente deseja encerrar
+                printf("Cliente solicitou encerrar conexão.\n");
+                connected = 0;
+            } else if (state == REQUEST_INVALID) {
+                printf("Frame inválido recebido, encerrando conexão.\n");
+                connected = 0;
+            } else {
+                // Executa a requisição e envia a resposta ao cliente
+                ResponseStream* stream;
+                size_t length = executeRequestFrame(&request, frame, NULL, &stream);
+                if (stream == NULL) {
+                    connected = sendAll(clientSocket, frame, length, 0) == 0;
+                    continue;
+                }
+
+                // Listagem: um frame por vez, cada um enviado antes de gerar
+                // o próximo (o texto de uma listagem do cache sai direto
+                // dele, logo após o cabeçalho)
+                while (connected && nextStreamFrame(stream) > 0) {
+                    int more = stream->bodyLength > 0 ? MSG_MORE : 0;
+                    connected = sendAll(clientSocket, stream->output.data, stream->output.length, more) == 0 &&
+                                (stream->bodyLength == 0 ||
+                                 sendAll(clientSocket, stream->body, stream->bodyLength, 0) == 0);
+                }
+                closeResponseStream(stream);
+            }
+        }
+    }
+
+    // Fecha o socket do cliente
+    frameParserFree(&parser);
+    close(clientSocket);
+    pthread_exit(NULL);
+}
+
+/* Loop de uma thread de aceitação do modo thread por cliente */
+void* acceptLoop(void* arg) {
+    ListenerThread* listener = arg;
+    int serverSocket = listener->serverSocket;
+    struct sockaddr_in clientAddr;
+    socklen_t addrSize;
+
+    pinThreadToCpu(listener->cpu);
+
+    while (1) {
+        addrSize = sizeof(clientAddr);
+        int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &addrSize);
+        if (clientSocket < 0) {
+            perror("Erro no accept");
+            continue;
+        }
+
+        printf("Cliente conectado.\n");
+        setNoDelay(clientSocket);
+
+        // Cria thread para atender o cliente
+        pthread_t threadId;
+        int* newSocket = malloc(sizeof(int));
+        *newSocket = clientSocket;
+
+        if (pthread_create(&threadId, NULL, handleClient, (void*)newSocket) != 0) {
+            perror("Erro ao criar thread");
+            free(newSocket);
+            close(clientSocket);
+            continue;
+        }
+
+        pthread_detach(threadId);
+    }
+
+    return NULL;
+}
+
+/* Inicia uma thread de aceitação por socket de escuta e aguarda seu término */
+void runThreadPerClient(const ServerConfig* config, const int* listenSockets) {
+    ListenerThread* threads = calloc(config->acceptors, sizeof(ListenerThread));
+    for (int i = 0; i < config->acceptors; i++) {
+        threads[i].serverSocket = listenSockets[i];
+        threads[i].cpu = cpuForThread(config, i);
+        if (pthread_create(&threads[i].thread, NULL, acceptLoop, &threads[i]) != 0) {
+            perror("Erro ao criar thread de aceitação");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("Modo thread por cliente com %d thread(s) de aceitação.\n", config->acceptors);
+
+    for (int i = 0; i < config->acceptors; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    free(threads);
+}
+
+
+/* Modo reator epoll */
+/* Permite manter dezenas de milhares de sockets abertos */
+void raiseFileLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/* Libera um bloco da saída pendente */
+void freeChunk(OutputChunk* chunk) {
+    if (chunk->text != NULL) {
+        cacheRelease(chunk->text);
+    }
+    free(chunk);
+}
+
+/* Bloco que envia um trecho de uma resposta do cache, sem copiá-lo (retorna
+ * NULL se faltar memória) */
+OutputChunk* cachedChunk(CachedText* text, const char* body, size_t length) {
+    OutputChunk* chunk = malloc(sizeof(OutputChunk));
+    if (chunk == NULL) {
+        return NULL;
+    }
+    cacheRetain(text);
+    chunk->next = NULL;
+    chunk->length = length;
+    chunk->offset = 0;
+    chunk->text = text;
+    chunk->body = body;
+    return chunk;
+}
+
+/* Faz a thread de eventos olhar a conexão de novo: EPOLL_CTL_MOD reavalia o
+ * socket e, se ele aceita escrita, gera um EPOLLOUT mesmo em edge-triggered */
+void wakeConnection(Connection* conn) {
+    struct epoll_event event;
+    event.events = CONNECTION_EVENTS;
+    event.data.ptr = conn;
+    epoll_ctl(conn->epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+/* Solta uma referência da conexão; a última fecha o socket e libera o
+ * estado (o fd só é fechado quando nenhum worker pode mais usá-lo). Se o
+ * cliente pediu o encerramento e só resta a referência da thread de
+ * eventos, acorda-a para fechar a conexão depois de enviar o que falta; o
+ * lock impede que ela feche antes do aviso. */
+void releaseConnection(Connection* conn) {
+    pthread_mutex_lock(&conn->lock);
+    int refs = __atomic_sub_fetch(&conn->refs, 1, __ATOMIC_ACQ_REL);
+    if (refs == 1 && conn->draining) {
+        wakeConnection(conn);
+    }
+    pthread_mutex_unlock(&conn->lock);
+    if (refs == 0) {
+        if (conn->zeroCopyWait != NULL) {
+            // O kernel ainda pode ler textos que serão liberados: fechar com
+            // RST descarta a fila de envio em vez de enviá-los depois
+            struct linger abort = {1, 0};
+            setsockopt(conn->fd, SOL_SOCKET, SO_LINGER, &abort, sizeof(abort));
+        }
+        close(conn->fd);
+        while (conn->zeroCopyWait != NULL) {
+            ZeroCopySend* send = conn->zeroCopyWait;
+            conn->zeroCopyWait = send->next;
+            cacheRelease(send->text);
+            free(send);
+        }
+        while (conn->pending != NULL) {
+            OutputChunk* chunk = conn->pending;
+            conn->pending = chunk->next;
+            freeChunk(chunk);
+        }
+        while (conn->streams != NULL) {
+            ResponseStream* stream = conn->streams;
+            conn->streams = stream->next;
+            closeResponseStream(stream);
+        }
+        frameParserFree(&conn->parser);
+        pthread_mutex_destroy(&conn->lock);
+        free(conn);
+    }
+}
+
+/* Encerra a conexão pela thread de eventos */
+void closeConnection(int epollFd, Connection* conn) {
+    pthread_mutex_lock(&conn->lock);
+    conn->closed = 1;
+    pthread_mutex_unlock(&conn->lock);
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+    releaseConnection(conn);
+}
+
+/* Começa o encerramento pedido pelo cliente (opção 0): nada mais é lido,
+ * mas as requisições já recebidas terminam e suas respostas são enviadas */
+void drainConnection(Connection* conn) {
+    pthread_mutex_lock(&conn->lock);
+    conn->draining = 1;
+    pthread_mutex_unlock(&conn->lock);
+}
+
+/* A conexão em encerramento já enviou todas as respostas: só resta a
+ * referência da thread de eventos e não há saída pendente nem listagens */
+int connectionDrained(Connection* conn) {
+    pthread_mutex_lock(&conn->lock);
+    int drained = conn->draining && __atomic_load_n(&conn->refs, __ATOMIC_ACQUIRE) == 1 &&
+                  conn->pending == NULL && conn->streams == NULL;
+    pthread_mutex_unlock(&conn->lock);
+    return drained;
+}
+
+/* Um bloco vai sem cópia se for um trecho grande do cache: o texto tem
+ * referência própria e não muda, então o kernel pode lê-lo depois do
+ * sendmsg retornar */
+static inline int isZeroCopyChunk(const Connection* conn, const OutputChunk* chunk) {
+    return conn->zeroCopy && chunk->text != NULL && chunk->length >= ZEROCOPY_MIN_BYTES;
+}
+
+/* Guarda em send uma referência ao texto até chegar a notificação do envio
+ * sem cópia que acabou de ser feito. Deve ser chamada com conn->lock. */
+void waitZeroCopy(Connection* conn, ZeroCopySend* send, CachedText* text) {
+    cacheRetain(text);
+    send->next = NULL;
+    send->id = conn->zeroCopyNext++;
+    send->text = text;
+    if (conn->zeroCopyWaitTail != NULL) {
+        conn->zeroCopyWaitTail->next = send;
+    } else {
+        conn->zeroCopyWait = send;
+    }
+    conn->zeroCopyWaitTail = send;
+}
+
+/* Devolve as referências dos envios sem cópia com ID em [first, last].
+ * Deve ser chamada com conn->lock. */
+void completeZeroCopy(Connection* conn, uint32_t first, uint32_t last) {
+    ZeroCopySend** link = &conn->zeroCopyWait;
+    conn->zeroCopyWaitTail = NULL;
+    while (*link != NULL) {
+        ZeroCopySend* send = *link;
+        if (send->id - first <= last - first) {
+            *link = send->next;
+            cacheRelease(send->text);
+            free(send);
+        } else {
+            conn->zeroCopyWaitTail = send;
+            link = &send->next;
+        }
+    }
+}
+
+/* Lê as notificações de envios sem cópia da fila de erros do socket, que o
+ * epoll sinaliza com EPOLLERR (retorna -1 se o socket tem um erro de
+ * verdade) */
+int reapZeroCopy(Connection* conn) {
+    pthread_mutex_lock(&conn->lock);
+    while (1) {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        if (recvmsg(conn->fd, &message, MSG_ERRQUEUE) < 0) {
+            if (errno == EINTR) continue;
+            break; // fila vazia
+        }
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            struct sock_extended_err error;
+            memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+            if (error.ee_origin == SO_EE_ORIGIN_ZEROCOPY && error.ee_errno == 0) {
+                completeZeroCopy(conn, error.ee_info, error.ee_data);
+                if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    // O kernel acabou copiando (loopback, placa sem
+                    // scatter-gather): as notificações só custariam
+                    conn->zeroCopy = 0;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&conn->lock);
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Envia o que houver de resposta pendente (retorna -1 em caso de erro),
+ * juntando vários blocos em cada sendmsg. Trechos grandes do cache vão
+ * sozinhos, com MSG_ZEROCOPY. Deve ser chamada com conn->lock. */
+int flushConnection(Connection* conn) {
+    while (conn->pending != NULL) {
+        struct iovec iov[MAX_IOVECS];
+        int count = 0;
+        // O registro da notificação é alocado antes: depois do sendmsg, o
+        // texto não pode mais ficar sem referência
+        ZeroCopySend* send = NULL;
+        int zeroCopy = isZeroCopyChunk(conn, conn->pending) &&
+                       (send = malloc(sizeof(ZeroCopySend))) != NULL;
+        for (OutputChunk* chunk = conn->pending; chunk != NULL && count < MAX_IOVECS; chunk = chunk->next) {
+            if (count > 0 && (zeroCopy || isZeroCopyChunk(conn, chunk))) {
+                break;
+            }
+            const char* data = chunk->body != NULL ? chunk->body : chunk->data;
+            iov[count].iov_base = (char*)data + chunk->offset;
+            iov[count].iov_len = chunk->length - chunk->offset;
+            count++;
+        }
+
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(conn->fd, &message, MSG_NOSIGNAL | (zeroCopy ? MSG_ZEROCOPY : 0));
+        if (sent < 0 && zeroCopy && errno == ENOBUFS) {
+            // Limite de memória de notificações do socket: envia copiando
+            zeroCopy = 0;
+            sent = sendmsg(conn->fd, &message, MSG_NOSIGNAL);
+        }
+        if (sent < 0 || !zeroCopy) {
+            free(send);
+        } else {
+            waitZeroCopy(conn, send, conn->pending->text);
+        }
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0; // espera EPOLLOUT
+            return -1;
+        }
+
+        // Libera os blocos enviados por inteiro
+        conn->pendingBytes -= sent;
+        while (sent > 0) {
+            OutputChunk* chunk = conn->pending;
+            size_t remaining = chunk->length - chunk->offset;
+            if ((size_t)sent < remaining) {
+                chunk->offset += sent;
+                break;
+            }
+            sent -= remaining;
+            conn->pending = chunk->next;
+            freeChunk(chunk);
+        }
+        if (conn->pending == NULL) {
+            conn->pendingTail = NULL;
+        }
+    }
+    return 0;
+}
+
+/* Acrescenta um bloco ao fim da saída pendente. Deve ser chamada com
+ * conn->lock. */
+void appendChunk(Connection* conn, OutputChunk* chunk) {
+    if (conn->pendingTail != NULL) {
+        conn->pendingTail->next = chunk;
+    } else {
+        conn->pending = chunk;
+    }
+    conn->pendingTail = chunk;
+    conn->pendingBytes += chunk->length;
+}
+
+/* Enfileira uma resposta, seguida de body (um bloco do cache, ou NULL), e
+ * tenta enviá-la imediatamente. Deve ser chamada com conn->lock. */
+int queueResponse(Connection* conn, const char* response, size_t length, OutputChunk* body) {
+    OutputChunk* chunk = malloc(sizeof(OutputChunk) + length);
+    if (chunk == NULL) {
+        if (body != NULL) {
+            freeChunk(body);
+        }
+        return -1;
+    }
+    chunk->next = NULL;
+    chunk->length = length;
+    chunk->offset = 0;
+    chunk->text = NULL;
+    chunk->body = NULL;
+    memcpy(chunk->data, response, length);
+
+    appendChunk(conn, chunk);
+    if (body != NULL) {
+        appendChunk(conn, body);
+    }
+    return flushConnection(conn);
+}
+
+/* Entrega uma resposta à conexão, vinda da thread de eventos ou de um
+ * worker. O que não couber no socket fica pendente até o EPOLLOUT. Retorna
+ * -1 se a conexão foi encerrada. */
+int sendConnectionResponse(Connection* conn, const char* response, size_t length, OutputChunk* body) {
+    int status = 0;
+    pthread_mutex_lock(&conn->lock);
+    if (conn->closed) {
+        if (body != NULL) {
+            freeChunk(body);
+        }
+        status = -1;
+    } else if (queueResponse(conn, response, length, body) < 0) {
+        // Falha no envio: o shutdown faz a thread de eventos fechar a conexão
+        shutdown(conn->fd, SHUT_RDWR);
+        status = -1;
+    }
+    pthread_mutex_unlock(&conn->lock);
+    return status;
+}
+
+/* Gera e entrega os frames de uma listagem enquanto a saída pendente da
+ * conexão estiver abaixo de STREAM_PENDING_LIMIT. Acima do limite, a
+ * listagem fica pausada na conexão até o EPOLLOUT esvaziar a saída: um
+ * cliente lento não faz o servidor acumular o catálogo inteiro. */
+void pumpStream(Connection* conn, ResponseStream* stream) {
+    while (1) {
+        pthread_mutex_lock(&conn->lock);
+        if (conn->closed) {
+            pthread_mutex_unlock(&conn->lock);
+            break;
+        }
+        if (conn->pendingBytes > STREAM_PENDING_LIMIT) {
+            // Ainda há saída pendente, então um EPOLLOUT vai retomá-la
+            stream->next = NULL;
+            if (conn->streamsTail != NULL) {
+                conn->streamsTail->next = stream;
+            } else {
+                conn->streams = stream;
+            }
+            conn->streamsTail = stream;
+            pthread_mutex_unlock(&conn->lock);
+            return;
+        }
+        pthread_mutex_unlock(&conn->lock);
+
+        // O frame é gerado fora do lock da conexão
+        if (nextStreamFrame(stream) == 0) {
+            break;
+        }
+        OutputChunk* body = NULL;
+        if (stream->bodyLength > 0 &&
+            (body = cachedChunk(stream->cached, stream->body, stream->bodyLength)) == NULL) {
+            break;
+        }
+        if (sendConnectionResponse(conn, stream->output.data, stream->output.length, body) < 0) {
+            break;
+        }
+    }
+    // Uma listagem interrompida por falta de memória deixaria o cliente
+    // esperando o último frame
+    if (!stream->done) {
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+    closeResponseStream(stream);
+}
+
+/* Retoma as listagens pausadas depois que a saída pendente baixou do limite
+ * (chamada pela thread de eventos) */
+void resumeStreams(Connection* conn) {
+    pthread_mutex_lock(&conn->lock);
+    ResponseStream* stream = NULL;
+    if (conn->pendingBytes <= STREAM_PENDING_LIMIT) {
+        stream = conn->streams;
+        conn->streams = NULL;
+        conn->streamsTail = NULL;
+    }
+    pthread_mutex_unlock(&conn->lock);
+
+    while (stream != NULL) {
+        ResponseStream* next = stream->next;
+        pumpStream(conn, stream);
+        stream = next;
+    }
+}
+
+/* Envia a resposta de uma escrita quando seu lote do log chega ao disco
+ * (chamada pela thread de gravação do log) */
+void sendDeferredResponse(void* arg, int status) {
+    DeferredResponse* deferred = arg;
+    if (status < 0) {
+        stopOnLogFailure();
+    }
+    sendConnectionResponse(deferred->conn, deferred->frame, deferred->length, NULL);
+    releaseConnection(deferred->conn);
+    free(deferred);
+}
+
+/* Executa uma requisição e entrega sua resposta. A resposta de uma escrita
+ * fica com o log até seu lote chegar ao disco, sem bloquear a thread: outras
+ * requisições seguem executando e entram no mesmo lote. */
+void runRequest(Connection* conn, const Request* request, char* frame) {
+    uint64_t lsn;
+    ResponseStream* stream;
+    size_t length = executeRequestFrame(request, frame, &lsn, &stream);
+    if (stream != NULL) {
+        pumpStream(conn, stream);
+        return;
+    }
+    if (lsn == 0) {
+        sendConnectionResponse(conn, frame, length, NULL);
+        return;
+    }
+
+    DeferredResponse* deferred = malloc(sizeof(DeferredResponse));
+    if (deferred == NULL) {
+        if (walWaitDurable(movieLog, lsn) < 0) {
+            stopOnLogFailure();
+        }
+        sendConnectionResponse(conn, frame, length, NULL);
+        return;
+    }
+
+    // A resposta pendente segura uma referência da conexão
+    __atomic_add_fetch(&conn->refs, 1, __ATOMIC_ACQ_REL);
+    deferred->conn = conn;
+    deferred->length = length;
+    memcpy(deferred->frame, frame, length);
+    walOnDurable(movieLog, lsn, sendDeferredResponse, deferred);
+}
+
+/* Tarefa do pool: executa uma requisição e entrega sua resposta. Cada
+ * requisição é uma tarefa independente, então requisições da mesma conexão
+ * executam em paralelo e a resposta de cada uma sai assim que fica pronta;
+ * o ID no frame diz ao cliente a qual requisição ela pertence. */
+void executeRequestTask(void* arg) {
+    RequestTask* task = arg;
+    char frame[RESPONSE_FRAME_SIZE];
+
+    runRequest(task->conn, &task->request, frame);
+    releaseConnection(task->conn);
+    free(task);
+}
+
+/* Despacha uma requisição completa para o pool de workers ou, sem pool (ou
+ * com todas as filas cheias), executa na própria thread de eventos */
+void dispatchRequest(Connection* conn, const Request* request, char* frame) {
+    RequestTask* task = workerPool != NULL ? malloc(sizeof(RequestTask)) : NULL;
+    if (task != NULL) {
+        task->conn = conn;
+        task->request = *request;
+
+        // A tarefa segura uma referência até entregar a resposta
+        __atomic_add_fetch(&conn->refs, 1, __ATOMIC_ACQ_REL);
+        Task poolTask = { executeRequestTask, task };
+        if (poolSubmit(workerPool, poolTask) == 0) {
+            return;
+        }
+        __atomic_sub_fetch(&conn->refs, 1, __ATOMIC_ACQ_REL);
+        free(task);
+    }
+
+    runRequest(conn, request, frame);
+}
+
+/* Lê tudo o que estiver disponível no socket (edge-triggered) e despacha as
+ * requisições completas. Retorna -1 se a conexão deve ser fechada e 1 se o
+ * cliente pediu o encerramento (o que vier depois do pedido é ignorado). */
+int readConnection(Connection* conn, char* buffer, char* frame) {
+    while (1) {
+        ssize_t bytesRead = recv(conn->fd, buffer, BUFFER_SIZE, 0);
+        if (bytesRead == 0) {
+            printf("Cliente desconectado.\n");
+            return -1;
+        }
+        if (bytesRead < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0; // socket drenado
+            printf("Cliente desconectado.\n");
+            return -1;
+        }
+
+        if (frameParserFeed(&conn->parser, buffer, bytesRead) < 0) {
+            return -1;
+        }
+
+        Request request;
+        RequestState state;
+        uint64_t receivedAt = statsNow();
+        while ((state = nextRequest(&conn->parser, receivedAt, &request)) != REQUEST_INCOMPLETE) {
+            if (state == REQUEST_CLOSE) {
+                printf("Cliente solicitou encerrar conexão.\n");
+                return 1;
+            }
+            if (state == REQUEST_INVALID) {
+                printf("Frame inválido recebido, encerrando conexão.\n");
+                return -1;
+            }
+            dispatchRequest(conn, &request, frame);
+        }
+    }
+}
+
+/* Aceita todas as conexões pendentes e as registra no epoll da thread */
+void acceptConnections(int epollFd, int serverSocket) {
+    while (1) {
+        int clientSocket = accept4(serverSocket, NULL, NULL, SOCK_NONBLOCK);
+        if (clientSocket < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Erro no accept");
+            }
+            return;
+        }
+
+        Connection* conn = calloc(1, sizeof(Connection));
+        if (conn == NULL) {
+            close(clientSocket);
+            continue;
+        }
+        setNoDelay(clientSocket);
+        conn->fd = clientSocket;
+        conn->epollFd = epollFd;
+        conn->refs = 1;
+        if (zeroCopySends) {
+            int one = 1;
+            conn->zeroCopy = setsockopt(clientSocket, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+        }
+        pthread_mutex_init(&conn->lock, NULL);
+        frameParserInit(&conn->parser);
+
+        struct epoll_event event;
+        event.events = CONNECTION_EVENTS;
+        event.data.ptr = conn;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, clientSocket, &event) < 0) {
+            perror("Erro no epoll_ctl");
+            releaseConnection(conn);
+            continue;
+        }
+
+        printf("Cliente conectado.\n");
+    }
+}
+
+/* Thread de eventos: multiplexa suas conexões em uma instância própria de
+ * epoll. Threads que compartilham um socket de escuta usam EPOLLEXCLUSIVE
+ * para não acordarem todas a cada conexão nova; com um socket SO_REUSEPORT
+ * por thread, cada uma só aceita as conexões que o kernel lhe entrega. */
+void* eventLoop(void* arg) {
+    ListenerThread* listener = arg;
+    int serverSocket = listener->serverSocket;
+
+    pinThreadToCpu(listener->cpu);
+
+    int epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        perror("Erro no epoll_create1");
+        return NULL;
+    }
+
+    // Registra o socket de escuta (data.ptr NULL identifica o listener)
+    struct epoll_event listenEvent;
+    listenEvent.events = EPOLLIN | EPOLLEXCLUSIVE;
+    listenEvent.data.ptr = NULL;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, serverSocket, &listenEvent) < 0) {
+        perror("Erro no epoll_ctl");
+        close(epollFd);
+        return NULL;
+    }
+
+    // Buffers compartilhados por todas as conexões da thread
+    char buffer[BUFFER_SIZE];
+    char frame[RESPONSE_FRAME_SIZE];
+    struct epoll_event events[MAX_EVENTS];
+
+    while (1) {
+        int ready = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("Erro no epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            Connection* conn = events[i].data.ptr;
+            if (conn == NULL) {
+                acceptConnections(epollFd, serverSocket);
+                continue;
+            }
+
+            uint32_t flags = events[i].events;
+            int failed = 0;
+            if (flags & EPOLLERR) {
+                // EPOLLERR também avisa que envios sem cópia terminaram
+                failed = reapZeroCopy(conn) < 0;
+            }
+            if (!failed && (flags & EPOLLOUT)) {
+                pthread_mutex_lock(&conn->lock);
+                if (conn->pending != NULL) {
+                    failed = flushConnection(conn) < 0;
+                }
+                int paused = conn->streams != NULL;
+                pthread_mutex_unlock(&conn->lock);
+                if (!failed && paused) {
+                    resumeStreams(conn);
+                }
+            }
+            if (!failed && !conn->draining && (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                int status = readConnection(conn, buffer, frame);
+                failed = status < 0;
+                if (status > 0) {
+                    drainConnection(conn);
+                }
+            }
+            // Encerramento pedido pelo cliente: fecha quando a última
+            // resposta tiver saído (o worker que solta a penúltima
+            // referência acorda a thread)
+            if (!failed && conn->draining && connectionDrained(conn)) {
+                failed = 1;
+            }
+            if (failed) {
+                closeConnection(epollFd, conn);
+            }
+        }
+    }
+
+    close(epollFd);
+    return NULL;
+}
+
+/* Inicia as threads de eventos do modo epoll e aguarda seu término. A
+ * thread i atende o socket de escuta i % acceptors. */
+void runEventLoops(const ServerConfig* config, const int* listenSockets) {
+    int threadCount = config->eventThreads;
+    int workerCount = config->workers;
+
+    // Os sockets de escuta precisam ser não bloqueantes para o accept em laço
+    for (int i = 0; i < config->acceptors; i++) {
+        int flags = fcntl(listenSockets[i], F_GETFL, 0);
+        fcntl(listenSockets[i], F_SETFL, flags | O_NONBLOCK);
+    }
+
+    raiseFileLimit();
+
+    // Pool fixo que executa as requisições montadas pelas threads de eventos
+    if (workerCount > 0) {
+        workerPool = poolCreate(workerCount, WORKER_QUEUE_SIZE);
+        if (workerPool == NULL) {
+            perror("Erro ao criar pool de workers");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ListenerThread* threads = calloc(threadCount, sizeof(ListenerThread));
+    for (int i = 0; i < threadCount; i++) {
+        threads[i].serverSocket = listenSockets[i % config->acceptors];
+        threads[i].cpu = cpuForThread(config, i);
+        if (pthread_create(&threads[i].thread, NULL, eventLoop, &threads[i]) != 0) {
+            perror("Erro ao criar thread de eventos");
+            exit(EXIT_FAILURE);
+        }
+    }
 
+    printf("Modo epoll com %d thread(s) de eventos e %d worker(s).\n", threadCount, workerCount);
 
-#define MAX_MOVIES 1000             // Máximo de filmes no sistema
-#define CSV_FILE_NAME "movies.csv"  // Nome do arquivo CSV para armazenar filmes
-#define BUFFER_SIZE 1024            // Tamanho em bits do buffer para comunicação
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    free(threads);
 
+    if (workerPool != NULL) {
+        poolDestroy(workerPool);
+        workerPool = NULL;
+    }
+}
 
-/* Estrutura para armazenar informações de filme */
-typedef struct {
-    int id;             // ID (identificador único)
-    char title[100];    // Título
-    char director[100]; // Nome do diretor
-    int year;           // Ano de lançamento
-    char genres[200];   // Gêneros separados por ponto e vírgula, ex: "ação;aventura"
-} Movie;
 
+/* Modo io_uring */
+/* Chamadas de sistema do io_uring (sem depender da liburing) */
+int uringSetup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
 
-/* Variáveis globais */
-Movie movieList[MAX_MOVIES];   // Array estático para filmes
-int movieCount = 0;            // Quantidade de filmes carregados
+int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
 
-pthread_mutex_t movieMutex;    // Mutex para proteger acesso à movieList
+int uringRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+/* Libera o anel e os buffers fornecidos */
+void uringDestroy(Uring* ring) {
+    if (ring->bufferBase != NULL) {
+        free(ring->bufferBase);
+    }
+    if (ring->bufferRing != NULL) {
+        munmap(ring->bufferRing, ring->bufferRingSize);
+    }
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->cqPtr != NULL && ring->cqPtr != ring->sqPtr) {
+        munmap(ring->cqPtr, ring->cqSize);
+    }
+    if (ring->sqPtr != NULL) {
+        munmap(ring->sqPtr, ring->sqSize);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+}
 
+/* Devolve um buffer ao anel de buffers fornecidos */
+void uringRecycleBuffer(Uring* ring, unsigned short bufferId) {
+    unsigned short tail = ring->bufferRing->tail;
+    struct io_uring_buf* buf = &ring->bufferRing->bufs[tail & (URING_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(ring->bufferBase + (size_t)bufferId * BUFFER_SIZE);
+    buf->len = BUFFER_SIZE;
+    buf->bid = bufferId;
+    __atomic_store_n(&ring->bufferRing->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
 
-/* Funções auxiliares internas */
-/* Carregar filmes do arquivo CSV para o array */
-void loadMoviesFromCSV(const char* filename) {
-    FILE* file = fopen(filename, "r");
+/* Cria o anel, mapeia as filas e registra o anel de buffers fornecidos usado
+ * pelos recv (retorna -1 se o kernel não suportar) */
+int uringInit(Uring* ring) {
+    memset(ring, 0, sizeof(*ring));
 
-    if (file == NULL) {
-        // Se não encontra o arquivo, inicializa com zero filmes
-        printf("Arquivo '%s' não encontrado. Inicializando sem filmes registrados.\n", filename);
-        return;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_COOP_TASKRUN;
+    ring->fd = uringSetup(URING_ENTRIES, &params);
+    if (ring->fd < 0 && errno == EINVAL) {
+        // Kernels mais antigos não conhecem essas flags
+        memset(&params, 0, sizeof(params));
+        ring->fd = uringSetup(URING_ENTRIES, &params);
+    }
+    if (ring->fd < 0) {
+        return -1;
     }
 
-    char line[512];
-    while (fgets(line, sizeof(line), file)) {
-        // Substitue newline do final por null, se existir
-        char* newlinePos = strchr(line, '\n');
-        if (newlinePos) {
-            *newlinePos = '\0';
-        }
-
-        // Dividir linha em tokens (CSV): id, titulo, diretor, ano, generos
-        // ID
-        char* token = strtok(line, ",");
-        if (!token) continue;
-        int id = atoi(token);
-
-        // Título
-        token = strtok(NULL, ",");
-        if (!token) continue;
-        char title[100];
-        strcpy(title, token);
-
-        // Nome do diretor
-        token = strtok(NULL, ",");
-        if (!token) continue;
-        char director[100];
-        strcpy(director, token);
-
-        // Ano de lançamento
-        token = strtok(NULL, ",");
-        if (!token) continue;
-        int year = atoi(token);
-
-        // Gêneros
-        token = strtok(NULL, ",");
-        if (!token) continue;
-        char genres[200];
-        strcpy(genres, token);
-
-        // Adicionar ao array de filmes
-        movieList[movieCount].id = id;
-        strcpy(movieList[movieCount].title, title);
-        strcpy(movieList[movieCount].director, director);
-        movieList[movieCount].year = year;
-        strcpy(movieList[movieCount].genres, genres);
-        movieCount++;
-
-        if (movieCount >= MAX_MOVIES) {
-            printf("Limite máximo de filmes atingido!\n");
-            break;
+    // Mapeia a fila de submissão, a de completude e o vetor de SQEs
+    ring->sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqSize > ring->sqSize) {
+            ring->sqSize = ring->cqSize;
         }
+        ring->cqSize = ring->sqSize;
     }
 
-    fclose(file);
-    printf("Carregados %d filmes do arquivo '%s'.\n", movieCount, filename);
-}
+    ring->sqPtr = mmap(NULL, ring->sqSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqPtr == MAP_FAILED) {
+        ring->sqPtr = NULL;
+        uringDestroy(ring);
+        return -1;
+    }
 
-/* Salvar todos os filmes do array no arquivo CSV */
-void saveMoviesToCSV(const char* filename) {
-    FILE* file = fopen(filename, "w");
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqPtr = ring->sqPtr;
+    } else {
+        ring->cqPtr = mmap(NULL, ring->cqSize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cqPtr == MAP_FAILED) {
+            ring->cqPtr = NULL;
+            uringDestroy(ring);
+            return -1;
+        }
+    }
 
-    if (file == NULL) {
-        // Se não consegue abrir o arquivo, não salva nada
-        printf("Erro ao abrir arquivo '%s' para escrita.\n", filename);
-        return;
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        uringDestroy(ring);
+        return -1;
+    }
+
+    char* sq = ring->sqPtr;
+    ring->sqHead = (unsigned*)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sqEntries = *(unsigned*)(sq + params.sq_off.ring_entries);
+    ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+
+    char* cq = ring->cqPtr;
+    ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqEntries = *(unsigned*)(cq + params.cq_off.ring_entries);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // Anel de buffers fornecidos: o kernel escolhe um buffer livre a cada
+    // recv, sem precisar de um buffer fixo por conexão
+    ring->bufferRingSize = URING_BUFFERS * sizeof(struct io_uring_buf);
+    ring->bufferRing = mmap(NULL, ring->bufferRingSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->bufferRing == MAP_FAILED) {
+        ring->bufferRing = NULL;
+        uringDestroy(ring);
+        return -1;
+    }
+    ring->bufferBase = malloc((size_t)URING_BUFFERS * BUFFER_SIZE);
+    if (ring->bufferBase == NULL) {
+        uringDestroy(ring);
+        return -1;
     }
 
-    // Salva as informações de cada filme no formato CSV
-    for (int i = 0; i < movieCount; i++) {
-        fprintf(file, "%d,%s,%s,%d,%s\n",
-                movieList[i].id,
-                movieList[i].title,
-                movieList[i].director,
-                movieList[i].year,
-                movieList[i].genres);
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->bufferRing;
+    reg.ring_entries = URING_BUFFERS;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (uringRegister(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        uringDestroy(ring);
+        return -1;
     }
 
-    fclose(file);
+    for (unsigned short i = 0; i < URING_BUFFERS; i++) {
+        uringRecycleBuffer(ring, i);
+    }
+
+    // Envio sem cópia, se o kernel tiver (6.0 ou mais novo)
+    size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, probeSize);
+    if (probe != NULL && uringRegister(ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        ring->sendZeroCopy = zeroCopySends && probe->last_op >= IORING_OP_SEND_ZC &&
+                             (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return 0;
 }
 
-/* Gerar um novo ID para um filme */
-int generateNewId() {
-    // Gera um novo ID somando 1 ao maior ID existente
-    int maxId = 0;
-    for (int i = 0; i < movieCount; i++) {
-        if (movieList[i].id > maxId) {
-            maxId = movieList[i].id;
+/* Submete as SQEs preparadas e, opcionalmente, espera uma completude */
+int uringSubmit(Uring* ring, unsigned waitFor) {
+    while (1) {
+        int result = uringEnter(ring->fd, ring->toSubmit, waitFor,
+                                waitFor > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if (result >= 0) {
+            ring->toSubmit -= result;
+            return result;
+        }
+        if (errno != EINTR) {
+            return -1;
         }
     }
-    return maxId + 1;
 }
 
-/* Buscar índice de filme no array pelo ID (retorna -1 se não encontrar) */
-int findMovieIndexById(int id) {
-    for (int i = 0; i < movieCount; i++) {
-        if (movieList[i].id == id) {
-            return i;
+/* Entradas livres na fila de submissão */
+static inline unsigned uringSqFree(const Uring* ring) {
+    return ring->sqEntries - (*ring->sqTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE));
+}
+
+/* Obtém uma SQE livre, submetendo as anteriores se a fila estiver cheia.
+ * Se o kernel recusar a submissão porque reteve completudes que não
+ * couberam na fila de completude (EBUSY/EAGAIN), pede que ele as passe
+ * para o espaço já liberado pelo laço do anel. Se nada mudar, ou com
+ * outro erro, o anel falha: retorna NULL e a thread encerra na volta
+ * seguinte do laço. */
+struct io_uring_sqe* uringGetSqe(Uring* ring) {
+    unsigned tail = *ring->sqTail;
+    while (uringSqFree(ring) == 0) {
+        if (ring->failed) {
+            return NULL;
         }
+        if (uringSubmit(ring, 0) >= 0) {
+            continue;
+        }
+        unsigned cqTail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        if ((errno == EBUSY || errno == EAGAIN) && cqTail - *ring->cqHead < ring->cqEntries) {
+            uringEnter(ring->fd, 0, 0, IORING_ENTER_GETEVENTS);
+            if (__atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE) != cqTail) {
+                continue;
+            }
+        }
+        perror("Erro ao submeter ao io_uring");
+        ring->failed = 1;
+        return NULL;
     }
-    return -1;
+
+    unsigned index = tail & ring->sqMask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->toSubmit++;
+    return sqe;
 }
 
+/* Arma o accept multishot: uma SQE gera uma CQE por conexão aceita */
+void uringArmAccept(Uring* ring, int serverSocket, UringOp* acceptOp) {
+    struct io_uring_sqe* sqe = uringGetSqe(ring);
+    if (sqe == NULL) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = serverSocket;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = (uint64_t)(uintptr_t)acceptOp;
+}
 
-/* Funções para operações de usuário */
-/* (1) Cadastrar um novo filme */
-void registerMovie(
-    const char* title,
-    const char* director,
-    int year,
-    const char* genres,
-    char* response
-) {
-    if (movieCount >= MAX_MOVIES) {
-        sprintf(response, "Erro: Limite de filmes atingido!\n");
+/* Arma o recv multishot da conexão usando os buffers fornecidos */
+void uringArmRecv(Uring* ring, UringConnection* conn) {
+    struct io_uring_sqe* sqe = uringGetSqe(ring);
+    if (sqe == NULL) {
         return;
     }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = (uint64_t)(uintptr_t)&conn->recvOp;
+    conn->inflight++;
+}
 
-    // Gera ID para o filme
-    int newId = generateNewId();
+/* Libera um send e a referência ao cache que ele segura */
+void uringFreeSend(UringOp* op) {
+    if (op->text != NULL) {
+        cacheRelease(op->text);
+    }
+    free(op);
+}
 
-    // Adiciona o filme ao array estático
-    movieList[movieCount].id = newId;
-    strcpy(movieList[movieCount].title, title);
-    strcpy(movieList[movieCount].director, director);
-    movieList[movieCount].year = year;
-    strcpy(movieList[movieCount].genres, genres);
+/* Inicia o encerramento da conexão: shutdown() faz o recv multishot terminar
+ * e o socket só é fechado quando não houver operações pendentes */
+void uringCloseConnection(UringConnection* conn) {
+    if (!conn->closing) {
+        conn->closing = 1;
+        shutdown(conn->fd, SHUT_RDWR);
+    }
 
-    movieCount++;
+    // Descarta respostas ainda não submetidas
+    while (conn->sendQueue != NULL) {
+        UringOp* op = conn->sendQueue;
+        conn->sendQueue = op->next;
+        uringFreeSend(op);
+    }
+    conn->sendQueueTail = NULL;
 
-    // Salva os dados atualizados no arquivo CSV
-    saveMoviesToCSV(CSV_FILE_NAME);
+    // E listagens ainda não terminadas
+    while (conn->streams != NULL) {
+        ResponseStream* stream = conn->streams;
+        conn->streams = stream->next;
+        closeResponseStream(stream);
+    }
+    conn->streamsTail = NULL;
 
-    sprintf(response, "Filme cadastrado com sucesso! ID: %d\n", newId);
+    // Na lista de conexões a descarregar, quem libera é uringFlushResponses
+    if (conn->inflight == 0 && !conn->dirty) {
+        close(conn->fd);
+        frameParserFree(&conn->parser);
+        free(conn);
+    }
 }
 
-/* (2) Adicionar um novo gênero a um filme */
-void addGenreToMovie(int id, const char* newGenre, char* response) {
-    // Recupera o index do filme no array
-    int index = findMovieIndexById(id);
-
-    if (index == -1) {
-        // Se não encontrar o filme no array, retorna erro
-        sprintf(response, "Erro: Filme com ID %d não encontrado.\n", id);
-        return;
+/* Fecha a conexão cujo cliente pediu o encerramento quando não restar nada
+ * a enviar nem operações pendentes (depois dela, conn pode ter sido
+ * liberada) */
+void uringFinishDraining(UringConnection* conn) {
+    if (conn->draining && !conn->closing && conn->inflight == 0 &&
+        conn->sendQueue == NULL && conn->streams == NULL) {
+        uringCloseConnection(conn);
     }
+}
 
-    // Adiciona o novo gênero ao filme
-    if (strlen(movieList[index].genres) > 0) {
-        // Se já tem algum gênero, adiciona ponto e vírgula antes
-        strcat(movieList[index].genres, ";");
-    } 
-    strcpy(movieList[index].genres, newGenre);
+/* Marca a conexão para ser descarregada ao fim do lote */
+void uringMarkDirty(UringThread* thread, UringConnection* conn) {
+    if (!conn->dirty) {
+        conn->dirty = 1;
+        conn->nextDirty = thread->dirty;
+        thread->dirty = conn;
+    }
+}
 
-    // Salva os dados atualizados no arquivo CSV
-    saveMoviesToCSV(CSV_FILE_NAME);
+/* Coloca um send na fila de envio da conexão; as filas são submetidas
+ * todas juntas ao fim do lote de completudes */
+void uringEnqueueSend(UringThread* thread, UringConnection* conn, UringOp* op) {
+    op->type = URING_OP_SEND;
+    op->conn = conn;
+    op->next = NULL;
+    conn->queuedBytes += op->length;
 
-    sprintf(response, "Gênero '%s' adicionado ao filme ID %d.\n", newGenre, id);
+    if (conn->sendQueue == NULL) {
+        conn->sendQueue = op;
+    } else {
+        conn->sendQueueTail->next = op;
+    }
+    conn->sendQueueTail = op;
+    uringMarkDirty(thread, conn);
 }
 
-/* (3) Remover um filme pelo identificador */
-void removeMovie(int id, char* response) {
-    // Recupera o index do filme no array
-    int index = findMovieIndexById(id);
+/* Encerra a conexão que perdeu uma resposta por falta de memória: o
+ * cliente ficaria esperando por ela, ou receberia uma listagem cortada.
+ * Marcada para descarregar, a conexão só é liberada ao fim do lote, então
+ * quem chamou ainda pode usá-la. */
+void uringFailConnection(UringThread* thread, UringConnection* conn) {
+    uringMarkDirty(thread, conn);
+    uringCloseConnection(conn);
+}
 
-    if (index == -1) {
-        // Se não encontrar o filme no array, retorna erro
-        sprintf(response, "Erro: Filme com ID %d não encontrado.\n", id);
-        return;
+/* Enfileira uma cópia da resposta (retorna -1 e encerra a conexão se faltar
+ * memória) */
+int uringQueueResponse(UringThread* thread, UringConnection* conn,
+                       const char* response, size_t length) {
+    UringOp* op = malloc(sizeof(UringOp) + length);
+    if (op == NULL) {
+        uringFailConnection(thread, conn);
+        return -1;
     }
+    memcpy(op->data, response, length);
+    op->buffer = op->data;
+    op->length = length;
+    op->text = NULL;
+    uringEnqueueSend(thread, conn, op);
+    return 0;
+}
 
-    // "Remove" o filme do array copiando o último filme do array para a posição
-    // do filme removido e decrementando o contador de filmes do array
-    movieList[index] = movieList[movieCount - 1];
-    movieCount--;
+/* Enfileira um trecho de uma resposta do cache, enviado sem cópia (retorna
+ * -1 e encerra a conexão se faltar memória) */
+int uringQueueCached(UringThread* thread, UringConnection* conn,
+                     CachedText* text, const char* body, size_t length) {
+    UringOp* op = malloc(sizeof(UringOp));
+    if (op == NULL) {
+        uringFailConnection(thread, conn);
+        return -1;
+    }
+    cacheRetain(text);
+    op->buffer = body;
+    op->length = length;
+    op->text = text;
+    uringEnqueueSend(thread, conn, op);
+    return 0;
+}
 
-    // Salva os dados atualizados no arquivo CSV
-    saveMoviesToCSV(CSV_FILE_NAME);
+/* Gera frames das listagens da conexão, uma por vez e em ordem, enquanto
+ * os bytes enfileirados ou em envio estiverem abaixo de
+ * STREAM_PENDING_LIMIT; as completudes dos sends retomam o resto */
+void uringPumpStreams(UringThread* thread, UringConnection* conn) {
+    while (conn->streams != NULL && !conn->closing && conn->queuedBytes <= STREAM_PENDING_LIMIT) {
+        ResponseStream* stream = conn->streams;
+        if (nextStreamFrame(stream) == 0) {
+            if (!stream->done) {
+                // Interrompida por falta de memória: encerra a conexão
+                shutdown(conn->fd, SHUT_RDWR);
+            }
+            conn->streams = stream->next;
+            if (conn->streams == NULL) {
+                conn->streamsTail = NULL;
+            }
+            closeResponseStream(stream);
+            continue;
+        }
+        // Se faltar memória, a conexão foi encerrada e a listagem liberada
+        if (uringQueueResponse(thread, conn, stream->output.data, stream->output.length) < 0 ||
+            (stream->bodyLength > 0 &&
+             uringQueueCached(thread, conn, stream->cached, stream->body, stream->bodyLength) < 0)) {
+            return;
+        }
+    }
+}
 
-    sprintf(response, "Filme com ID %d removido com sucesso.\n", id);
+/* Um send vai sem cópia se for um trecho grande do cache. O kernel manda uma
+ * segunda completude (IORING_CQE_F_NOTIF) quando deixa de ler os bytes, mas
+ * um send cancelado no meio de uma cadeia pode tê-la sem que a primeira
+ * traga IORING_CQE_F_MORE; por isso um send sem cópia só vai no início de
+ * uma cadeia, que nunca é cancelado. */
+static inline int uringIsZeroCopy(const UringConnection* conn, const UringOp* op) {
+    return conn->zeroCopy && op->text != NULL && op->length >= ZEROCOPY_MIN_BYTES;
 }
 
-/* (4) Listar todos os títulos de filmes com seus identificadores */
-void listAllMoviesIds(char* response) {
-    if (movieCount == 0) {
-        // Se não há filmes cadastrados, retorna mensagem apropriada
-        strcat(response, "Nenhum filme cadastrado.\n");
-        return;
-    }
+/* Submete as respostas enfileiradas de cada conexão como uma cadeia de sends
+ * ligados (IOSQE_IO_LINK), que o kernel executa em ordem. Cadeias de lotes
+ * diferentes não têm ordem entre si, então uma conexão só recebe uma cadeia
+ * nova quando a anterior termina. */
+void uringFlushResponses(UringThread* thread) {
+    while (thread->dirty != NULL) {
+        UringConnection* conn = thread->dirty;
+        thread->dirty = conn->nextDirty;
+        conn->nextDirty = NULL;
+        conn->dirty = 0;
+        if (conn->closing) {
+            uringCloseConnection(conn);
+            continue;
+        }
+        if (conn->sending > 0) {
+            continue; // a completude do último send remarca a conexão
+        }
 
-    // Prepara a resposta com os títulos e IDs dos filmes
-    strcpy(response, "Lista de Filmes (ID - Título):\n");
-    char temp[256];
-    for (int i = 0; i < movieCount; i++) {
-        sprintf(temp, "%d - %s\n", movieList[i].id, movieList[i].title);
-        strcat(response, temp);
+        while (conn->sendQueue != NULL) {
+            UringOp* op = conn->sendQueue;
+            if (conn->sending > 0 && uringIsZeroCopy(conn, op)) {
+                break; // começa a próxima cadeia
+            }
+            struct io_uring_sqe* sqe = uringGetSqe(&thread->ring);
+            if (sqe == NULL) {
+                return; // o anel falhou
+            }
+            conn->sendQueue = op->next;
+
+            if (uringIsZeroCopy(conn, op)) {
+                sqe->opcode = IORING_OP_SEND_ZC;
+                sqe->ioprio = IORING_SEND_ZC_REPORT_USAGE;
+            } else {
+                sqe->opcode = IORING_OP_SEND;
+            }
+            sqe->fd = conn->fd;
+            sqe->addr = (uint64_t)(uintptr_t)op->buffer;
+            sqe->len = op->length;
+            sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+            sqe->user_data = (uint64_t)(uintptr_t)op;
+            conn->inflight++;
+            conn->sending++;
+            if (conn->sendQueue != NULL && !uringIsZeroCopy(conn, conn->sendQueue)) {
+                if (uringSqFree(&thread->ring) == 0) {
+                    // Se uringGetSqe submetesse no meio, a cadeia seria
+                    // dividida e as partes sairiam sem ordem: o resto vai
+                    // quando esta terminar
+                    break;
+                }
+                sqe->flags = IOSQE_IO_LINK;
+            }
+        }
+        if (conn->sendQueue == NULL) {
+            conn->sendQueueTail = NULL;
+        }
     }
 }
 
-/* (5) Listar informações de todos os filmes */
-void listAllMoviesInfo(char* response) {
-    if (movieCount == 0) {
-        // Se não há filmes cadastrados, retorna mensagem apropriada
-        strcat(response, "Nenhum filme cadastrado.\n");
+/* Arma a leitura do eventfd pelo qual a thread de gravação do log avisa
+ * que há respostas de escritas prontas */
+void uringArmWake(UringThread* thread) {
+    struct io_uring_sqe* sqe = uringGetSqe(&thread->ring);
+    if (sqe == NULL) {
         return;
     }
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = thread->wakeFd;
+    sqe->addr = (uint64_t)(uintptr_t)&thread->wakeValue;
+    sqe->len = sizeof(thread->wakeValue);
+    sqe->user_data = (uint64_t)(uintptr_t)&thread->wakeOp;
+}
+
+/* Devolve à thread do anel a resposta de uma escrita cujo lote do log
+ * chegou ao disco (chamada pela thread de gravação do log) */
+void uringDeliverDurable(void* arg, int status) {
+    UringDeferred* deferred = arg;
+    if (status < 0) {
+        stopOnLogFailure();
+    }
+    UringThread* thread = deferred->thread;
+    pthread_mutex_lock(&thread->durableLock);
+    deferred->next = thread->durable;
+    thread->durable = deferred;
+    pthread_mutex_unlock(&thread->durableLock);
 
-    char temp[512];
-    strcpy(response, "Informações de Todos os Filmes:\n");
-    for (int i = 0; i < movieCount; i++) {
-        sprintf(temp, "ID: %d | Título: %s | Diretor: %s | Ano: %d | Gêneros: %s\n",
-                movieList[i].id,
-                movieList[i].title,
-                movieList[i].director,
-                movieList[i].year,
-                movieList[i].genres);
-        strcat(response, temp);
+    uint64_t one = 1;
+    if (write(thread->wakeFd, &one, sizeof(one)) < 0) {
+        perror("Erro ao acordar a thread do io_uring");
     }
 }
 
-/* (6) Listar informações de um filme específico */
-void listMovieById(int id, char* response) {
-    // Recupera o index do filme no array
-    int index = findMovieIndexById(id);
+/* Enfileira as respostas de escritas que chegaram ao disco, na ordem em
+ * que chegaram, e rearma a leitura do eventfd */
+void uringHandleDurable(UringThread* thread) {
+    pthread_mutex_lock(&thread->durableLock);
+    UringDeferred* list = thread->durable;
+    thread->durable = NULL;
+    pthread_mutex_unlock(&thread->durableLock);
 
-    if (index == -1) {
-        // Se não encontrar o filme no array, retorna erro
-        sprintf(response, "Erro: Filme com ID %d não encontrado.\n", id);
+    UringDeferred* ordered = NULL;
+    while (list != NULL) {
+        UringDeferred* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+    while (ordered != NULL) {
+        UringDeferred* deferred = ordered;
+        ordered = deferred->next;
+        UringConnection* conn = deferred->conn;
+        conn->inflight--;
+        if (conn->closing) {
+            uringCloseConnection(conn);
+        } else {
+            uringQueueResponse(thread, conn, deferred->frame, deferred->length);
+        }
+        free(deferred);
+    }
+    uringArmWake(thread);
+}
+
+/* Entrega a resposta de uma escrita (montada em thread->frame) quando seu
+ * lote do log chegar ao disco, sem bloquear o anel: as outras requisições
+ * seguem executando e entram no mesmo lote */
+void uringDeferResponse(UringThread* thread, UringConnection* conn, size_t length, uint64_t lsn) {
+    UringDeferred* deferred = malloc(sizeof(UringDeferred));
+    if (deferred == NULL) {
+        if (walWaitDurable(movieLog, lsn) < 0) {
+            stopOnLogFailure();
+        }
+        uringQueueResponse(thread, conn, thread->frame, length);
         return;
     }
 
-    // Prepara a resposta com as informações do filme
-    sprintf(response, "Informações do Filme (ID %d):\nTítulo: %s\nDiretor: %s\nAno: %d\nGêneros: %s\n",
-            movieList[index].id,
-            movieList[index].title,
-            movieList[index].director,
-            movieList[index].year,
-            movieList[index].genres);
+    // A resposta pendente conta como operação da conexão, que não é
+    // liberada antes dela
+    conn->inflight++;
+    deferred->thread = thread;
+    deferred->conn = conn;
+    deferred->length = length;
+    memcpy(deferred->frame, thread->frame, length);
+    walOnDurable(movieLog, lsn, uringDeliverDurable, deferred);
 }
 
-/* (7) Listar todos os filmes de um determinado gênero */
-void listMoviesByGenre(const char* genre, char* response) {
-    if (movieCount == 0) {
-        // Se não há filmes cadastrados, retorna mensagem apropriada
-        strcat(response, "Nenhum filme cadastrado.\n");
-        return;
+/* Trata a completude de um recv multishot */
+void uringHandleRecv(UringThread* thread, UringConnection* conn, struct io_uring_cqe* cqe) {
+    int more = cqe->flags & IORING_CQE_F_MORE;
+    if (!more) {
+        conn->inflight--;
     }
 
-    char temp[512];
-    int foundCount = 0;
+    if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+        unsigned short bufferId = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        char* data = thread->ring.bufferBase + (size_t)bufferId * BUFFER_SIZE;
+
+        int failed = frameParserFeed(&conn->parser, data, cqe->res) < 0;
+        uringRecycleBuffer(&thread->ring, bufferId);
 
-    // Prepara a resposta com os filmes do gênero solicitado
-    strcpy(response, "Filmes do gênero buscado:\n");
-    for (int i = 0; i < movieCount; i++) {
-        // Verifica se o gênero está presente em movieList[i].genres
-        if (strstr(movieList[i].genres, genre) != NULL) {
-            // Se o gênero for encontrado, adiciona as informações do filme à
-            // resposta
-            sprintf(temp, "ID: %d | Título: %s | Diretor: %s | Ano: %d | Gêneros: %s\n",
-                    movieList[i].id,
-                    movieList[i].title,
-                    movieList[i].director,
-                    movieList[i].year,
-                    movieList[i].genres);
-            strcat(response, temp);
-            foundCount++;
+        Request request;
+        RequestState state;
+        uint64_t receivedAt = statsNow();
+        while (!failed && !conn->closing && !conn->draining &&
+               (state = nextRequest(&conn->parser, receivedAt, &request)) != REQUEST_INCOMPLETE) {
+            if (state == REQUEST_CLOSE) {
+                // As requisições anteriores ainda terminam e são respondidas;
+                // o shutdown só encerra o recv multishot
+                printf("Cliente solicitou encerrar conexão.\n");
+                conn->draining = 1;
+                shutdown(conn->fd, SHUT_RD);
+            } else if (state == REQUEST_INVALID) {
+                printf("Frame inválido recebido, encerrando conexão.\n");
+                failed = 1;
+            } else {
+                ResponseStream* stream;
+                uint64_t lsn;
+                size_t length = executeRequestFrame(&request, thread->frame, &lsn, &stream);
+                if (stream == NULL) {
+                    if (lsn > 0) {
+                        uringDeferResponse(thread, conn, length, lsn);
+                    } else {
+                        uringQueueResponse(thread, conn, thread->frame, length);
+                    }
+                    continue;
+                }
+
+                // Listagem: entra na fila da conexão e gera o que couber
+                stream->next = NULL;
+                if (conn->streamsTail != NULL) {
+                    conn->streamsTail->next = stream;
+                } else {
+                    conn->streams = stream;
+                }
+                conn->streamsTail = stream;
+                uringPumpStreams(thread, conn);
+            }
+        }
+        if (failed) {
+            uringCloseConnection(conn);
+            return;
         }
+    } else if (cqe->res == -ENOBUFS) {
+        // Sem buffers livres no momento: basta rearmar o recv
+    } else if (conn->draining) {
+        // Fim do recv depois do pedido de encerramento
+        uringFinishDraining(conn);
+        return;
+    } else {
+        // Cliente desconectou (0) ou ocorreu erro
+        if (!conn->closing) {
+            printf("Cliente desconectado.\n");
+        }
+        uringCloseConnection(conn);
+        return;
     }
 
-    if (foundCount == 0) {
-        // Se nenhum filme do gênero for encontrado, adiciona mensagem
-        // apropriada
-        strcat(response, "Nenhum filme encontrado para esse gênero.\n");
+    if (conn->closing) {
+        uringCloseConnection(conn);
+    } else if (!more && conn->draining) {
+        uringFinishDraining(conn);
+    } else if (!more) {
+        uringArmRecv(&thread->ring, conn);
     }
 }
 
+/* Thread do modo io_uring: um anel próprio com accept multishot, recv com
+ * buffers fornecidos e sends ligados, submetidos em lote a cada volta */
+void* uringLoop(void* arg) {
+    UringThread* thread = arg;
+    Uring* ring = &thread->ring;
 
-/* Função de tratamento de cliente */
-/* Trata cada cliente em uma thread */
-void* handleClient(void* arg) {
-    int clientSocket = *((int*)arg);
-    free(arg); // Liberar memória alocada para o socket do cliente
+    pinThreadToCpu(thread->cpu);
 
-    char buffer[BUFFER_SIZE];
-    char response[BUFFER_SIZE * 4]; // para respostas mais extensas
+    UringOp acceptOp;
+    memset(&acceptOp, 0, sizeof(acceptOp));
+    acceptOp.type = URING_OP_ACCEPT;
+    uringArmAccept(ring, thread->serverSocket, &acceptOp);
+    thread->wakeOp.type = URING_OP_WAKE;
+    uringArmWake(thread);
 
     while (1) {
-        // Zera buffers
-        memset(buffer, 0, sizeof(buffer));
-        memset(response, 0, sizeof(response));
-
-        // Lê a opção do cliente (0 a 7)
-        int bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
-        if (bytesRead <= 0) {
-            // Cliente desconectou ou ocorreu erro
-            printf("Cliente desconectado.\n");
-            break;
+        // Descarrega as respostas do lote anterior, submete tudo e espera
+        uringFlushResponses(thread);
+        if (ring->failed) {
+            break; // informado por uringGetSqe
         }
-        int option = atoi(buffer);
-
-        // (0) Encerrar conexão
-        if (option == 0) {
-            // Cliente deseja encerrar
-            printf("Cliente solicitou encerrar conexão.\n");
+        if (uringSubmit(ring, 1) < 0) {
+            perror("Erro no io_uring_enter");
             break;
         }
 
-        // Tratamento das demais opções
-        switch (option) {
-            case 1: {
-                // (1) Cadastrar um novo filme
-                // Recebe título
-                char title[100];
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                strcpy(title, buffer);
-
-                // Recebe diretor
-                char director[100];
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                strcpy(director, buffer);
-
-                // Recebe ano
-                int year;
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                year = atoi(buffer);
-
-                // Recebe gêneros
-                char genres[200];
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                strcpy(genres, buffer);
-
-                // Registra o filme protegendo com mutex
-                pthread_mutex_lock(&movieMutex);
-                registerMovie(title, director, year, genres, response);
-                pthread_mutex_unlock(&movieMutex);
-
-                // Envia resposta ao cliente
-                send(clientSocket, response, strlen(response), 0);
-            } break;
-
-            case 2: {
-                // (2) Adicionar um novo gênero a um filme
-                // Recebe ID
-                int id;
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                id = atoi(buffer);
-
-                // Recebe novo gênero
-                char newGenre[100];
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                strcpy(newGenre, buffer);
-
-                // Adiciona gênero ao filme protegendo com mutex
-                pthread_mutex_lock(&movieMutex);
-                addGenreToMovie(id, newGenre, response);
-                pthread_mutex_unlock(&movieMutex);
-
-                // Envia resposta ao cliente
-                send(clientSocket, response, strlen(response), 0);
-            } break;
-
-            case 3: {
-                // (3) Remover um filme pelo identificador
-                // Recebe ID
-                int id;
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                id = atoi(buffer);
-
-                // Remove filme do array protegendo com mutex
-                pthread_mutex_lock(&movieMutex);
-                removeMovie(id, response);
-                pthread_mutex_unlock(&movieMutex);
-
-                // Envia resposta ao cliente
-                send(clientSocket, response, strlen(response), 0);
-            } break;
-
-            case 4: {
-                // (4) Listar todos os títulos de filmes com seus
-                // identificadores
-                // Lista os títulos e identificadores de todos os filmes
-                // protegendo com mutex
-                pthread_mutex_lock(&movieMutex);
-                listAllMoviesIds(response);
-                pthread_mutex_unlock(&movieMutex);
-
-                // Envia resposta ao cliente
-                send(clientSocket, response, strlen(response), 0);
-            } break;
-
-            case 5: {
-                // (5) Listar informações de todos os filmes
-                // Lista as informações de todos os filmes protegendo com mutex
-                pthread_mutex_lock(&movieMutex);
-                listAllMoviesInfo(response);
-                pthread_mutex_unlock(&movieMutex);
-
-                // Envia resposta ao cliente
-                send(clientSocket, response, strlen(response), 0);
-            } break;
-
-            case 6: {
-                // (6) Listar informações de um filme específico
-                // Recebe ID
-                int id;
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                id = atoi(buffer);
-
-                // Lista as informações do filme protegendo com mutex
-                pthread_mutex_lock(&movieMutex);
-                listMovieById(id, response);
-                pthread_mutex_unlock(&movieMutex);
-
-                // Envia resposta ao cliente
-                send(clientSocket, response, strlen(response), 0);
-            } break;
-
-            case 7: {
-                // (7) Listar todos os filmes de um determinado gênero
-                // Recebe gênero
-                char genre[100];
-                memset(buffer, 0, sizeof(buffer));
-                recv(clientSocket, buffer, sizeof(buffer), 0);
-                strcpy(genre, buffer);
-
-                // Lista os filmes do gênero protegendo com mutex
-                pthread_mutex_lock(&movieMutex);
-                listMoviesByGenre(genre, response);
-                pthread_mutex_unlock(&movieMutex);
-
-                // Envia resposta ao cliente
-                send(clientSocket, response, strlen(response), 0);
-            } break;
+        // Cada completude é copiada e sua posição devolvida ao kernel antes
+        // de tratá-la, para que haja espaço se uringGetSqe precisar que o
+        // kernel entregue completudes retidas
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            struct io_uring_cqe current = ring->cqes[head & ring->cqMask];
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            struct io_uring_cqe* cqe = &current;
+            UringOp* op = (UringOp*)(uintptr_t)cqe->user_data;
 
-            default:
-                // Opção inválida
-                // Envia mensagem de erro ao cliente
-                sprintf(response, "Opção inválida.\n");
-                send(clientSocket, response, strlen(response), 0);
-                break;
+            switch (op->type) {
+                case URING_OP_ACCEPT: {
+                    if (cqe->res >= 0) {
+                        UringConnection* conn = calloc(1, sizeof(UringConnection));
+                        if (conn == NULL) {
+                            close(cqe->res);
+                        } else {
+                            setNoDelay(cqe->res);
+                            conn->fd = cqe->res;
+                            conn->zeroCopy = ring->sendZeroCopy;
+                            conn->recvOp.type = URING_OP_RECV;
+                            conn->recvOp.conn = conn;
+                            frameParserInit(&conn->parser);
+                            uringArmRecv(ring, conn);
+                            printf("Cliente conectado.\n");
+                        }
+                    }
+                    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                        uringArmAccept(ring, thread->serverSocket, &acceptOp);
+                    }
+                } break;
+
+                case URING_OP_RECV:
+                    uringHandleRecv(thread, op->conn, cqe);
+                    break;
+
+                case URING_OP_WAKE:
+                    uringHandleDurable(thread);
+                    break;
+
+                case URING_OP_SEND: {
+                    UringConnection* conn = op->conn;
+                    if (cqe->flags & IORING_CQE_F_NOTIF) {
+                        // O kernel não lê mais o trecho do envio sem cópia. Se
+                        // acabou copiando (loopback, placa sem scatter-gather),
+                        // a conexão volta aos sends comuns.
+                        if ((uint32_t)cqe->res & IORING_NOTIF_USAGE_ZC_COPIED) {
+                            conn->zeroCopy = 0;
+                        }
+                        uringFreeSend(op);
+                        conn->inflight--;
+                        if (conn->closing) {
+                            uringCloseConnection(conn);
+                        } else {
+                            uringFinishDraining(conn);
+                        }
+                        break;
+                    }
+
+                    // Envio concluído (ou cancelado porque um anterior da
+                    // cadeia falhou): libera o buffer da resposta, ou espera
+                    // a notificação de um envio sem cópia
+                    conn->queuedBytes -= op->length;
+                    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                        uringFreeSend(op);
+                        conn->inflight--;
+                    }
+                    conn->sending--;
+                    if (cqe->res < 0 || conn->closing) {
+                        uringCloseConnection(conn);
+                        break;
+                    }
+                    uringPumpStreams(thread, conn);
+                    if (conn->sending == 0 && conn->sendQueue != NULL) {
+                        uringMarkDirty(thread, conn);
+                    }
+                    uringFinishDraining(conn);
+                } break;
+            }
         }
     }
 
-    // Fecha o socket do cliente
-    close(clientSocket);
-    pthread_exit(NULL);
+    uringDestroy(ring);
+    close(thread->wakeFd);
+    return NULL;
 }
 
-
-/* Função principal do servidor */
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        // Caso não tenha porta informada, exibe mensagem de ajuda
-        printf("Uso: %s <porta>\n", argv[0]);
-        exit(EXIT_FAILURE);
+/* Inicia as threads do modo io_uring (retorna -1 se o kernel não suportar,
+ * para que o servidor use o modo epoll). A thread i atende o socket de
+ * escuta i % acceptors. */
+int runUringLoops(const ServerConfig* config, const int* listenSockets) {
+    int threadCount = config->eventThreads;
+    UringThread* threads = calloc(threadCount, sizeof(UringThread));
+    for (int i = 0; i < threadCount; i++) {
+        if (uringInit(&threads[i].ring) < 0) {
+            perror("io_uring indisponível");
+            for (int j = 0; j < i; j++) {
+                uringDestroy(&threads[j].ring);
+                close(threads[j].wakeFd);
+            }
+            free(threads);
+            return -1;
+        }
+        threads[i].wakeFd = eventfd(0, EFD_CLOEXEC);
+        if (threads[i].wakeFd < 0) {
+            perror("Erro ao criar eventfd");
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_init(&threads[i].durableLock, NULL);
+        threads[i].serverSocket = listenSockets[i % config->acceptors];
+        threads[i].cpu = cpuForThread(config, i);
     }
 
-    int port = atoi(argv[1]);
-    int serverSocket, clientSocket;
-    struct sockaddr_in serverAddr, clientAddr;
-    socklen_t addrSize;
+    raiseFileLimit();
 
-    // Inicializa mutex
-    pthread_mutex_init(&movieMutex, NULL);
+    for (int i = 0; i < threadCount; i++) {
+        if (pthread_create(&threads[i].thread, NULL, uringLoop, &threads[i]) != 0) {
+            perror("Erro ao criar thread do io_uring");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    // Carrega filmes do arquivo CSV
-    loadMoviesFromCSV(CSV_FILE_NAME);
+    printf("Modo io_uring com %d thread(s) de eventos.\n", threadCount);
 
-    // Cria socket
-    serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket < 0) {
-        perror("Erro ao criar socket");
-        exit(EXIT_FAILURE);
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(threads[i].thread, NULL);
     }
+    free(threads);
+    return 0;
+}
 
-    // Configura endereço do servidor
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = INADDR_ANY;
-    serverAddr.sin_port = htons(port);
 
-    // Faz bind
-    if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-        perror("Erro no bind");
-        close(serverSocket);
-        exit(EXIT_FAILURE);
+/* Função principal do servidor (fora do benchmark_servidor.c, que inclui
+ * este arquivo com SERVIDOR_SEM_MAIN) */
+#ifndef SERVIDOR_SEM_MAIN
+void printUsage(const char* program) {
+    printf("Uso: %s <porta> [-m epoll|uring|threads] [-e threads_de_eventos] [-w workers]\n"
+           "       [-a sockets_de_escuta] [-b backlog] [-c]\n"
+           "       [-g janela_de_commit_us] [-G bytes_por_lote] [-z]\n"
+           "   ou: %s -x arquivo.csv\n", program, program);
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    config.mode = MODE_EPOLL;
+    config.cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+    config.eventThreads = config.cpuCount;
+    config.workers = config.cpuCount;
+    config.acceptors = 1;
+    config.backlog = SOMAXCONN;
+    config.incomingCpu = 0;
+    config.commitWindow = 0;
+    config.commitBytes = COMMIT_BATCH_BYTES;
+    config.zeroCopy = 1;
+    config.exportPath = NULL;
+
+    // Lê as opções de linha de comando
+    int opt;
+    while ((opt = getopt(argc, argv, "m:e:w:a:b:cg:G:zx:")) != -1) {
+        switch (opt) {
+            case 'm':
+                if (strcmp(optarg, "threads") == 0) {
+                    config.mode = MODE_THREADS;
+                } else if (strcmp(optarg, "epoll") == 0) {
+                    config.mode = MODE_EPOLL;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    config.mode = MODE_URING;
+                } else {
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'e':
+                config.eventThreads = atoi(optarg);
+                break;
+            case 'w':
+                config.workers = atoi(optarg);
+                break;
+            case 'a':
+                config.acceptors = atoi(optarg);
+                break;
+            case 'b':
+                config.backlog = atoi(optarg);
+                break;
+            case 'c':
+                config.incomingCpu = 1;
+                break;
+            case 'g':
+                config.commitWindow = atol(optarg);
+                break;
+            case 'G':
+                config.commitBytes = atol(optarg);
+                break;
+            case 'z':
+                config.zeroCopy = 0;
+                break;
+            case 'x':
+                config.exportPath = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
     }
 
-    // Escuta
-    if (listen(serverSocket, 5) < 0) {
-        perror("Erro no listen");
-        close(serverSocket);
+    if (config.exportPath != NULL) {
+        // Só exporta o catálogo (imagem e log) para CSV
+        loadMovies(&config);
+        if (saveMoviesToCSV(config.exportPath, &movieList, nextMovieId) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        printf("Catálogo exportado para '%s'.\n", config.exportPath);
+        return 0;
+    }
+    if (optind >= argc) {
+        // Caso não tenha porta informada, exibe mensagem de ajuda
+        printUsage(argv[0]);
         exit(EXIT_FAILURE);
     }
+    if (config.eventThreads < 1) {
+        config.eventThreads = 1;
+    }
+    if (config.workers < 0) {
+        config.workers = 0;
+    }
+    if (config.acceptors < 1) {
+        config.acceptors = 1;
+    }
+    if (config.mode != MODE_THREADS && config.eventThreads < config.acceptors) {
+        // Cada socket de escuta precisa de ao menos uma thread de eventos
+        config.eventThreads = config.acceptors;
+    }
+    if (config.backlog < 1) {
+        config.backlog = SOMAXCONN;
+    }
+    if (config.commitWindow < 0) {
+        config.commitWindow = 0;
+    }
+    if (config.commitBytes < 1) {
+        config.commitBytes = COMMIT_BATCH_BYTES;
+    }
 
-    printf("Servidor iniciado na porta %d. Aguardando conexões...\n", port);
+    config.port = atoi(argv[optind]);
+    zeroCopySends = config.zeroCopy;
 
-    // Loop para aceitar conexões
-    while (1) {
-        addrSize = sizeof(clientAddr);
-        clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &addrSize);
-        if (clientSocket < 0) {
-            perror("Erro no accept");
-            continue;
-        }
+    // Inicializa o lock do catálogo dando preferência às escritas, para que
+    // o fluxo contínuo de leituras não as adie indefinidamente
+    pthread_rwlockattr_t lockAttr;
+    pthread_rwlockattr_init(&lockAttr);
+    pthread_rwlockattr_setkind_np(&lockAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&movieLock, &lockAttr);
+    pthread_rwlockattr_destroy(&lockAttr);
 
-        printf("Cliente conectado.\n");
+    // SIGUSR1 imprime as estatísticas: bloqueado antes de criar qualquer
+    // outra thread (todas herdam a máscara) e esperado só pela thread de
+    // estatísticas
+    statsInit(&serverStats);
+    sigset_t statsSignals;
+    sigemptyset(&statsSignals);
+    sigaddset(&statsSignals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &statsSignals, NULL);
+    pthread_t statsThread;
+    if (pthread_create(&statsThread, NULL, statsSignalLoop, NULL) != 0) {
+        perror("Erro ao criar thread de estatísticas");
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(statsThread);
 
-        // Cria thread para atender o cliente
-        pthread_t threadId;
-        int* newSocket = malloc(sizeof(int));
-        *newSocket = clientSocket;
+    // Carrega filmes da imagem e do log, e inicia a compactação
+    loadMovies(&config);
+    pthread_t compactionThread;
+    if (pthread_create(&compactionThread, NULL, compactionLoop, NULL) != 0) {
+        perror("Erro ao criar thread de compactação");
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(compactionThread);
 
-        if (pthread_create(&threadId, NULL, handleClient, (void*)newSocket) != 0) {
-            perror("Erro ao criar thread");
+    // Cria os sockets de escuta: com mais de um, cada um tem SO_REUSEPORT e
+    // o kernel distribui as conexões entre eles
+    int* listenSockets = malloc(sizeof(int) * config.acceptors);
+    for (int i = 0; i < config.acceptors; i++) {
+        int incomingCpu = config.incomingCpu ? cpuForThread(&config, i) : -1;
+        listenSockets[i] = createListenSocket(config.port, config.backlog,
+                                              config.acceptors > 1, incomingCpu);
+        if (listenSockets[i] < 0) {
+            exit(EXIT_FAILURE);
         }
+    }
 
-        pthread_detach(threadId);
+    printf("Servidor iniciado na porta %d. Aguardando conexões...\n", config.port);
+
+    // Atende conexões no modo escolhido
+    if (config.mode == MODE_URING && runUringLoops(&config, listenSockets) < 0) {
+        printf("Usando o modo epoll.\n");
+        config.mode = MODE_EPOLL;
+    }
+    if (config.mode == MODE_EPOLL) {
+        runEventLoops(&config, listenSockets);
+    } else if (config.mode == MODE_THREADS) {
+        runThreadPerClient(&config, listenSockets);
     }
 
-    // Fecha o socket do servidor
-    close(serverSocket);
-    // Destrói o mutex
-    pthread_mutex_destroy(&movieMutex);
+    // Fecha os sockets do servidor
+    for (int i = 0; i < config.acceptors; i++) {
+        close(listenSockets[i]);
+    }
+    free(listenSockets);
+    // Destrói o lock do catálogo
+    pthread_rwlock_destroy(&movieLock);
 
     return 0;
 }
-
+#endif
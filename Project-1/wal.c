@@ -0,0 +1,464 @@
+/******************************************************************************
+ * Implementação do log de escrita antecipada (ver wal.h).
+ ******************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "wal.h"
+
+
+/* Função a chamar quando o log chegar ao disco até lsn */
+typedef struct DurableWaiter {
+    uint64_t lsn;
+    WalDurableFn fn;
+    void* arg;
+    struct DurableWaiter* next;
+} DurableWaiter;
+
+struct Wal {
+    int fd;             // Arquivo aberto com O_APPEND
+    char* path;         // Caminho do arquivo atual
+    size_t size;        // Bytes no arquivo, incluindo o lote pendente
+
+    pthread_mutex_t lock;       // Protege os campos abaixo
+    pthread_cond_t work;        // Há registros a gravar (ou pedido de parada)
+    pthread_cond_t durable;     // Um lote chegou ao disco
+    char* batch;                // Registros enfileirados e não gravados
+    size_t batchLength;
+    size_t batchCapacity;
+    struct timespec batchStart; // Quando o primeiro registro do lote chegou
+    uint64_t appendedLsn;       // Fim do último registro enfileirado
+    uint64_t durableLsn;        // Fim do último registro no disco
+    long windowMicros;          // Janela de tempo de um lote
+    size_t batchBytes;          // Limite de bytes de um lote
+    int flushing;               // A thread de gravação está escrevendo
+    int urgent;                 // Gravar o lote sem esperar a janela
+    int failed;                 // Uma gravação falhou: o log não aceita mais registros
+    int stopping;               // walClose foi chamado
+    DurableWaiter* waiters;     // Funções registradas por walOnDurable
+    pthread_t flusher;
+};
+
+
+/* CRC-32 (polinômio refletido 0xEDB88320, o mesmo do zlib) */
+static uint32_t crcTable[256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+static void buildCrcTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        crcTable[i] = crc;
+    }
+}
+
+/* Continua o cálculo de um CRC-32 (comece com crc = 0) */
+static uint32_t crc32Update(uint32_t crc, const void* data, size_t length) {
+    pthread_once(&crcTableOnce, buildCrcTable);
+
+    const unsigned char* bytes = data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* CRC de um registro: cobre o tipo e o payload */
+static uint32_t recordCrc(uint8_t type, const void* payload, uint32_t length) {
+    return crc32Update(crc32Update(0, &type, 1), payload, length);
+}
+
+/* Sincroniza o diretório de path, para que a criação ou a troca de nome
+ * do arquivo também sobreviva a uma queda */
+static void syncDirectory(const char* path) {
+    char directory[256];
+    const char* slash = strrchr(path, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else {
+        size_t length = slash - path;
+        if (length == 0 || length >= sizeof(directory)) {
+            length = length == 0 ? 1 : sizeof(directory) - 1;
+        }
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/* Abre o arquivo do log para acréscimos, guardando seu tamanho atual */
+static int openLogFile(Wal* wal) {
+    wal->fd = open(wal->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (wal->fd < 0) {
+        return -1;
+    }
+    syncDirectory(wal->path);
+
+    struct stat info;
+    wal->size = fstat(wal->fd, &info) == 0 ? (size_t)info.st_size : 0;
+    return 0;
+}
+
+/* Escreve data inteiro no arquivo e sincroniza (retorna -1 em caso de erro) */
+static int writeDurably(int fd, const char* data, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t result = write(fd, data + written, length - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        written += result;
+    }
+    return fdatasync(fd);
+}
+
+/* Diferença a - b em microssegundos */
+static long elapsedMicros(const struct timespec* a, const struct timespec* b) {
+    return (a->tv_sec - b->tv_sec) * 1000000L + (a->tv_nsec - b->tv_nsec) / 1000;
+}
+
+/* Separa as funções registradas que já podem ser chamadas (log no disco
+ * até seu lsn, ou falha na gravação). Deve ser chamada com wal->lock. */
+static DurableWaiter* takeReadyWaiters(Wal* wal) {
+    DurableWaiter* ready = NULL;
+    DurableWaiter** link = &wal->waiters;
+    while (*link != NULL) {
+        DurableWaiter* waiter = *link;
+        if (wal->failed || waiter->lsn <= wal->durableLsn) {
+            *link = waiter->next;
+            waiter->next = ready;
+            ready = waiter;
+        } else {
+            link = &waiter->next;
+        }
+    }
+    return ready;
+}
+
+/* Pede a gravação imediata do lote e espera o log estar todo no disco (ou
+ * a gravação falhar). Deve ser chamada com wal->lock. */
+static void waitFlushed(Wal* wal) {
+    wal->urgent = 1;
+    pthread_cond_signal(&wal->work);
+    while ((wal->batchLength > 0 || wal->flushing) && !wal->failed) {
+        pthread_cond_wait(&wal->durable, &wal->lock);
+    }
+}
+
+/* Chama e libera as funções separadas por takeReadyWaiters, fora do lock */
+static void runWaiters(DurableWaiter* ready, int status) {
+    while (ready != NULL) {
+        DurableWaiter* waiter = ready;
+        ready = waiter->next;
+        waiter->fn(waiter->arg, status);
+        free(waiter);
+    }
+}
+
+/* Thread de gravação: espera o lote fechar (janela ou limite de bytes),
+ * troca-o por um buffer vazio e o grava fora do lock, de modo que novos
+ * registros se acumulam no próximo lote durante o fsync */
+static void* flusherLoop(void* arg) {
+    Wal* wal = arg;
+    char* spare = NULL;
+    size_t spareCapacity = 0;
+
+    pthread_mutex_lock(&wal->lock);
+    while (1) {
+        while (wal->batchLength == 0 && !wal->stopping) {
+            pthread_cond_wait(&wal->work, &wal->lock);
+        }
+        if (wal->batchLength == 0) {
+            break; // parada sem nada pendente
+        }
+
+        // Espera a janela do lote, a menos que ele já esteja cheio
+        while (wal->windowMicros > 0 && !wal->urgent && !wal->stopping &&
+               wal->batchLength < wal->batchBytes) {
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            long remaining = wal->windowMicros - elapsedMicros(&now, &wal->batchStart);
+            if (remaining <= 0) {
+                break;
+            }
+            struct timespec deadline = wal->batchStart;
+            deadline.tv_sec += wal->windowMicros / 1000000;
+            deadline.tv_nsec += (wal->windowMicros % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&wal->work, &wal->lock, &deadline);
+        }
+
+        // Fecha o lote: os próximos registros vão para o buffer reserva
+        char* batch = wal->batch;
+        size_t capacity = wal->batchCapacity;
+        size_t length = wal->batchLength;
+        uint64_t batchLsn = wal->appendedLsn;
+        wal->batch = spare;
+        wal->batchCapacity = spareCapacity;
+        wal->batchLength = 0;
+        wal->urgent = 0;
+        wal->flushing = 1;
+        int fd = wal->fd;
+        pthread_mutex_unlock(&wal->lock);
+
+        int result = writeDurably(fd, batch, length);
+
+        pthread_mutex_lock(&wal->lock);
+        spare = batch;
+        spareCapacity = capacity;
+        wal->flushing = 0;
+        if (result < 0) {
+            perror("Erro ao gravar o log");
+            wal->failed = 1;
+        } else {
+            wal->durableLsn = batchLsn;
+        }
+        pthread_cond_broadcast(&wal->durable);
+
+        DurableWaiter* ready = takeReadyWaiters(wal);
+        int status = wal->failed ? -1 : 0;
+        if (ready != NULL) {
+            pthread_mutex_unlock(&wal->lock);
+            runWaiters(ready, status);
+            pthread_mutex_lock(&wal->lock);
+        }
+    }
+    pthread_mutex_unlock(&wal->lock);
+
+    free(spare);
+    return NULL;
+}
+
+
+/* Funções públicas */
+Wal* walOpen(const char* path, long windowMicros, size_t batchBytes) {
+    Wal* wal = calloc(1, sizeof(Wal));
+    if (wal == NULL) {
+        return NULL;
+    }
+    wal->path = strdup(path);
+    if (wal->path == NULL || openLogFile(wal) < 0) {
+        free(wal->path);
+        free(wal);
+        return NULL;
+    }
+    wal->windowMicros = windowMicros > 0 ? windowMicros : 0;
+    wal->batchBytes = batchBytes > 0 ? batchBytes : 1;
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->work, NULL);
+    pthread_cond_init(&wal->durable, NULL);
+
+    if (pthread_create(&wal->flusher, NULL, flusherLoop, wal) != 0) {
+        pthread_mutex_destroy(&wal->lock);
+        pthread_cond_destroy(&wal->work);
+        pthread_cond_destroy(&wal->durable);
+        close(wal->fd);
+        free(wal->path);
+        free(wal);
+        return NULL;
+    }
+    return wal;
+}
+
+int walAppend(Wal* wal, uint8_t type, const void* payload, uint32_t length, uint64_t* lsn) {
+    if (length > WAL_MAX_RECORD) {
+        return -1;
+    }
+
+    uint32_t netLength = htonl(length);
+    uint32_t netCrc = htonl(recordCrc(type, payload, length));
+    size_t total = WAL_RECORD_HEADER_SIZE + length;
+
+    pthread_mutex_lock(&wal->lock);
+    if (wal->failed) {
+        pthread_mutex_unlock(&wal->lock);
+        return -1;
+    }
+    if (wal->batchLength + total > wal->batchCapacity) {
+        size_t capacity = wal->batchCapacity > 0 ? wal->batchCapacity : 4096;
+        while (capacity < wal->batchLength + total) {
+            capacity *= 2;
+        }
+        char* batch = realloc(wal->batch, capacity);
+        if (batch == NULL) {
+            pthread_mutex_unlock(&wal->lock);
+            return -1;
+        }
+        wal->batch = batch;
+        wal->batchCapacity = capacity;
+    }
+
+    // Cabeçalho e payload seguidos no lote; o lote sai em um único write
+    char* record = wal->batch + wal->batchLength;
+    memcpy(record, &netLength, 4);
+    memcpy(record + 4, &netCrc, 4);
+    record[8] = (char)type;
+    memcpy(record + WAL_RECORD_HEADER_SIZE, payload, length);
+
+    if (wal->batchLength == 0) {
+        clock_gettime(CLOCK_REALTIME, &wal->batchStart);
+    }
+    wal->batchLength += total;
+    wal->size += total;
+    wal->appendedLsn += total;
+    *lsn = wal->appendedLsn;
+
+    // Acorda a thread de gravação no primeiro registro do lote ou quando ele
+    // enche; no meio da janela ela ainda está esperando
+    if (wal->batchLength == total || wal->batchLength >= wal->batchBytes) {
+        pthread_cond_signal(&wal->work);
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return 0;
+}
+
+int walWaitDurable(Wal* wal, uint64_t lsn) {
+    pthread_mutex_lock(&wal->lock);
+    while (wal->durableLsn < lsn && !wal->failed) {
+        pthread_cond_wait(&wal->durable, &wal->lock);
+    }
+    int result = wal->durableLsn >= lsn ? 0 : -1;
+    pthread_mutex_unlock(&wal->lock);
+    return result;
+}
+
+void walOnDurable(Wal* wal, uint64_t lsn, WalDurableFn fn, void* arg) {
+    DurableWaiter* waiter = malloc(sizeof(DurableWaiter));
+
+    pthread_mutex_lock(&wal->lock);
+    if (waiter != NULL && wal->durableLsn < lsn && !wal->failed) {
+        waiter->lsn = lsn;
+        waiter->fn = fn;
+        waiter->arg = arg;
+        waiter->next = wal->waiters;
+        wal->waiters = waiter;
+        pthread_mutex_unlock(&wal->lock);
+        return;
+    }
+    pthread_mutex_unlock(&wal->lock);
+    free(waiter);
+
+    // Já no disco, ou sem memória para registrar: espera aqui mesmo
+    fn(arg, walWaitDurable(wal, lsn));
+}
+
+size_t walSize(Wal* wal) {
+    pthread_mutex_lock(&wal->lock);
+    size_t size = wal->size;
+    pthread_mutex_unlock(&wal->lock);
+    return size;
+}
+
+int walSync(Wal* wal) {
+    pthread_mutex_lock(&wal->lock);
+    waitFlushed(wal);
+    int result = wal->failed ? -1 : 0;
+    pthread_mutex_unlock(&wal->lock);
+    return result;
+}
+
+int walRotate(Wal* wal, const char* oldPath) {
+    // Grava o lote pendente no arquivo atual antes de trocá-lo
+    pthread_mutex_lock(&wal->lock);
+    waitFlushed(wal);
+
+    int result = -1;
+    if (!wal->failed && rename(wal->path, oldPath) == 0) {
+        // O descritor antigo ainda aponta para o arquivo renomeado
+        int oldFd = wal->fd;
+        size_t oldSize = wal->size;
+        if (openLogFile(wal) < 0) {
+            // Sem arquivo novo, continua anexando ao antigo no caminho original
+            wal->fd = oldFd;
+            wal->size = oldSize;
+            rename(oldPath, wal->path);
+        } else {
+            close(oldFd);
+            result = 0;
+        }
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return result;
+}
+
+void walClose(Wal* wal) {
+    pthread_mutex_lock(&wal->lock);
+    wal->stopping = 1;
+    pthread_cond_signal(&wal->work);
+    pthread_mutex_unlock(&wal->lock);
+    pthread_join(wal->flusher, NULL);
+
+    pthread_mutex_destroy(&wal->lock);
+    pthread_cond_destroy(&wal->work);
+    pthread_cond_destroy(&wal->durable);
+    close(wal->fd);
+    free(wal->batch);
+    free(wal->path);
+    free(wal);
+}
+
+long walReplay(const char* path, WalReplayFn fn, void* arg) {
+    FILE* file = fopen(path, "r+b");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char* payload = malloc(WAL_MAX_RECORD);
+    long records = 0;
+    long validEnd = 0;
+    char header[WAL_RECORD_HEADER_SIZE];
+
+    while (payload != NULL && fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        uint32_t netLength, netCrc;
+        memcpy(&netLength, header, 4);
+        memcpy(&netCrc, header + 4, 4);
+        uint32_t length = ntohl(netLength);
+        uint8_t type = (uint8_t)header[8];
+
+        if (length > WAL_MAX_RECORD ||
+            fread(payload, 1, length, file) != length ||
+            recordCrc(type, payload, length) != ntohl(netCrc)) {
+            break;
+        }
+
+        fn(type, payload, length, arg);
+        records++;
+        validEnd += WAL_RECORD_HEADER_SIZE + length;
+    }
+
+    // Descarta o resto de uma escrita interrompida
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    if (payload != NULL && fileSize > validEnd) {
+        printf("Log '%s': %ld bytes inválidos no fim descartados.\n", path, fileSize - validEnd);
+        if (ftruncate(fileno(file), validEnd) < 0) {
+            perror("Erro ao truncar o log");
+        }
+    }
+
+    free(payload);
+    fclose(file);
+    return records;
+}
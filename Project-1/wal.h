@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Log de escrita antecipada (write-ahead log) só de acréscimos.
+ * - Cada mutação vira um registro anexado ao fim do arquivo, em vez de
+ *   reescrever o catálogo inteiro: o custo de uma escrita é O(1).
+ * - Formato de cada registro (inteiros em ordem de rede):
+ *          tamanho  (4 bytes) - bytes de payload
+ *          CRC-32   (4 bytes) - do tipo e do payload
+ *          tipo     (1 byte)  - definido por quem usa o log
+ *          payload
+ * - Na leitura (walReplay), um registro incompleto ou com CRC errado marca o
+ *   fim do log: é o resto de uma escrita interrompida, e o arquivo é
+ *   truncado nesse ponto para que os próximos registros fiquem legíveis.
+ * - Commit em grupo: walAppend só enfileira o registro e devolve sua
+ *   posição no log (LSN). Uma thread de gravação escreve e sincroniza
+ *   (fdatasync) os registros em lotes, quando a janela de tempo expira ou o
+ *   lote atinge o limite de bytes. walWaitDurable espera o lote de um
+ *   registro chegar ao disco; walOnDurable registra uma função chamada
+ *   pela thread de gravação quando isso acontecer, sem bloquear quem
+ *   escreveu. Assim várias escritas dividem um fsync.
+ * - A compactação fica a cargo de quem usa o log: walRotate troca o arquivo
+ *   por um vazio, e o antigo pode ser apagado depois que um snapshot com
+ *   seu conteúdo estiver gravado.
+ ******************************************************************************/
+
+#ifndef WAL_H
+#define WAL_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define WAL_RECORD_HEADER_SIZE 9        // Tamanho do cabeçalho de registro
+#define WAL_MAX_RECORD 65536            // Maior payload de registro aceito
+
+
+typedef struct Wal Wal;
+
+/* Função chamada quando um registro chega ao disco (status 0) ou quando a
+ * gravação falha (status -1) */
+typedef void (*WalDurableFn)(void* arg, int status);
+
+/* Função chamada para cada registro válido durante a leitura do log */
+typedef void (*WalReplayFn)(uint8_t type, const char* payload, uint32_t length, void* arg);
+
+
+/* Abre (ou cria) o log em path para acréscimos e inicia sua thread de
+ * gravação. Um lote é gravado windowMicros depois do seu primeiro registro
+ * (0: assim que a gravação anterior terminar) ou ao atingir batchBytes.
+ * Retorna NULL em caso de erro. */
+Wal* walOpen(const char* path, long windowMicros, size_t batchBytes);
+
+/* Enfileira um registro no lote atual e devolve em *lsn a posição do fim
+ * do registro no log (retorna -1 em caso de erro, ou se uma gravação
+ * anterior falhou) */
+int walAppend(Wal* wal, uint8_t type, const void* payload, uint32_t length, uint64_t* lsn);
+
+/* Espera até o log estar no disco pelo menos até lsn (retorna -1 se a
+ * gravação falhou) */
+int walWaitDurable(Wal* wal, uint64_t lsn);
+
+/* Chama fn(arg, status) quando o log estiver no disco até lsn: na própria
+ * thread se já estiver, senão na thread de gravação (fn não deve bloquear) */
+void walOnDurable(Wal* wal, uint64_t lsn, WalDurableFn fn, void* arg);
+
+/* Grava o que estiver pendente e espera chegar ao disco (retorna -1 se a
+ * gravação falhou) */
+int walSync(Wal* wal);
+
+/* Bytes no arquivo atual do log, incluindo os ainda não gravados */
+size_t walSize(Wal* wal);
+
+/* Grava o que estiver pendente, renomeia o arquivo atual para oldPath e
+ * continua em um arquivo novo e vazio no caminho original (retorna -1 em
+ * caso de erro) */
+int walRotate(Wal* wal, const char* oldPath);
+
+/* Grava o que estiver pendente, encerra a thread de gravação e fecha o log */
+void walClose(Wal* wal);
+
+/* Lê o log em path, chamando fn para cada registro válido, em ordem.
+ * Retorna a quantidade de registros lidos, ou -1 se o arquivo não existir. */
+long walReplay(const char* path, WalReplayFn fn, void* arg);
+
+
+#endif